@@ -4,6 +4,10 @@
 #define ERROR_READER_EOF 1
 #define ERROR_WRITER_EOF 2
 
+// Buffer is full, but operation needs more room. For example
+// line does not fit into buffered reader.
+#define ERROR_BUFFER_FULL 8
+
 /*
 Describes result returned by any read-like operation.
 */
@@ -32,11 +36,40 @@ typedef struct {
 
 typedef RetRead (*BagFuncRead)(void*, span_u8);
 
+typedef RetRead (*BagFuncReadVec)(void*, span_str);
+
+/*
+Describes result of borrowing reader internal memory.
+*/
+typedef struct {
+    // Next unconsumed data. Not empty if error code is 0.
+    span_u8 data;
+
+    ErrorCode code;
+} RetBorrow;
+
+typedef RetBorrow (*BagFuncFillBuf)(void*);
+
+typedef void (*BagFuncConsume)(void*, uint);
+
 typedef struct {
     uint type_id;
 
     /* Method table */
     BagFuncRead read;
+
+    // Scatter read into several buffers in order. Optional, nil if
+    // underlying type has no native support for it.
+    BagFuncReadVec read_vec;
+
+    // Exposes next data inside reader memory without copying it.
+    // Optional, nil if reader does not hold data in memory. Borrowed
+    // data stays valid until consume method is called.
+    BagFuncFillBuf fill_buf;
+
+    // Marks given number of borrowed bytes as read. Present
+    // if and only if fill_buf method is present.
+    BagFuncConsume consume;
 } BagReaderTab;
 
 typedef struct {
@@ -51,11 +84,17 @@ typedef struct {
 
 typedef RetWrite (*BagFuncWrite)(void*, span_u8);
 
+typedef RetWrite (*BagFuncWriteVec)(void*, span_str);
+
 typedef struct {
     uint type_id;
 
     /* Method table */
     BagFuncWrite write;
+
+    // Gather write from several buffers in order. Optional, nil if
+    // underlying type has no native support for it.
+    BagFuncWriteVec write_vec;
 } BagWriterTab;
 
 typedef struct {
@@ -86,8 +125,91 @@ typedef struct {
     ErrorCode code;
 } RetCopy;
 
+/*/doc
+
+Writes entire span into a given writer. Stops early only on error.
+*/
+static RetWrite
+bag_write_all(Writer writer, span_u8 s) {
+    RetWrite ret = {};
+    while (ret.count < s.len) {
+        RetWrite w = writer.tab->write(cast(void*, writer.obj), span_u8_slice_tail(s, ret.count));
+        ret.count += w.count;
+        if (w.code != 0) {
+            ret.code = w.code;
+            return ret;
+        }
+    }
+    return ret;
+}
+
+// Borrowed spans shorter than this are gathered into intermediate buffer,
+// so that readers which lend small pieces do not cost a write per piece.
+#define BAG_COPY_BORROW_MIN_SIZE (1 << 12)
+
+/*/doc
+
+Copies borrowed reader memory directly into writer. Small borrowed spans
+are gathered into intermediate buffer and written together.
+*/
+static RetCopy
+bag_copy_borrow(Writer writer, Reader reader) {
+    RetCopy ret = {};
+    void* obj = cast(void*, reader.obj);
+
+    u8 array_buf[1 << 14];
+    uint pos = 0;
+    while (true) {
+        RetBorrow b = reader.tab->fill_buf(obj);
+        if (b.data.len == 0) {
+            RetWrite w = bag_write_all(writer, make_span_u8(array_buf, pos));
+            ret.count += w.count;
+            if (w.code != 0) {
+                ret.code = w.code;
+            } else if (b.code != ERROR_READER_EOF) {
+                ret.code = b.code;
+            }
+            return ret;
+        }
+
+        if (pos == 0 && b.data.len >= BAG_COPY_BORROW_MIN_SIZE) {
+            RetWrite w = writer.tab->write(cast(void*, writer.obj), b.data);
+            reader.tab->consume(obj, w.count);
+            ret.count += w.count;
+            if (w.code != 0) {
+                ret.code = w.code;
+                return ret;
+            }
+            continue;
+        }
+
+        const uint n = min_uint(array_len(array_buf) - pos, b.data.len);
+        unsafe_copy(array_buf + pos, b.data.ptr, n);
+        reader.tab->consume(obj, n);
+        pos += n;
+        if (pos == array_len(array_buf)) {
+            RetWrite w = bag_write_all(writer, make_span_u8(array_buf, pos));
+            ret.count += w.count;
+            if (w.code != 0) {
+                ret.code = w.code;
+                return ret;
+            }
+            pos = 0;
+        }
+    }
+}
+
+/*/doc
+
+Copies all data from reader into writer. Readers which lend large spans
+of memory are copied from directly, others through intermediate buffer.
+*/
 static RetCopy
 bag_copy(Writer writer, Reader reader) {
+    if (reader.tab->fill_buf != nil) {
+        return bag_copy_borrow(writer, reader);
+    }
+
     RetCopy ret = {};
 
     u8 array_buf[1 << 14];
@@ -107,7 +229,7 @@ bag_copy(Writer writer, Reader reader) {
             continue;
         }
 
-        RetWrite w = writer.tab->write(cast(void*, writer.obj), span_u8_slice_head(buf, r.count));
+        RetWrite w = bag_write_all(writer, span_u8_slice_head(buf, r.count));
         ret.count += w.count;
         if (w.code != 0) {
             ret.code = w.code;
@@ -119,9 +241,126 @@ bag_copy(Writer writer, Reader reader) {
     }
 }
 
+/*/doc
+
+Reads into several buffers in order. Uses vectored method of reader
+if it has one, otherwise fills buffers one by one and stops after
+first short read.
+*/
+static RetRead
+bag_read_vec(Reader reader, span_str bufs) {
+    if (reader.tab->read_vec != nil) {
+        return reader.tab->read_vec(cast(void*, reader.obj), bufs);
+    }
+
+    RetRead ret = {};
+    for (uint i = 0; i < bufs.len; i += 1) {
+        RetRead r = reader.tab->read(cast(void*, reader.obj), bufs.ptr[i]);
+        ret.count += r.count;
+        if (r.code != 0) {
+            // report end of stream only if nothing was read
+            if (r.code != ERROR_READER_EOF || ret.count == 0) {
+                ret.code = r.code;
+            }
+            return ret;
+        }
+        if (r.count < bufs.ptr[i].len) {
+            return ret;
+        }
+    }
+    return ret;
+}
+
+/*/doc
+
+Writes several buffers in order. Uses vectored method of writer if it
+has one, otherwise writes buffers one by one. Like a single write it
+may stop early and report number of written bytes.
+*/
+static RetWrite
+bag_write_vec(Writer writer, span_str bufs) {
+    if (writer.tab->write_vec != nil) {
+        return writer.tab->write_vec(cast(void*, writer.obj), bufs);
+    }
+
+    RetWrite ret = {};
+    for (uint i = 0; i < bufs.len; i += 1) {
+        RetWrite w = bag_write_all(writer, bufs.ptr[i]);
+        ret.count += w.count;
+        if (w.code != 0) {
+            ret.code = w.code;
+            return ret;
+        }
+    }
+    return ret;
+}
+
+/*/doc
+
+Writes all buffers, retrying after partial writes. Elements of {bufs}
+are modified in the process: fully written ones become empty, partially
+written one is advanced past written bytes.
+*/
+static RetWrite
+bag_write_vec_all(Writer writer, span_str bufs) {
+    RetWrite ret = {};
+    uint i = 0;
+    while (i < bufs.len) {
+        RetWrite w = bag_write_vec(writer, make_span_str(bufs.ptr + i, bufs.len - i));
+        ret.count += w.count;
+        if (w.code != 0) {
+            ret.code = w.code;
+            return ret;
+        }
+
+        uint n = w.count;
+        while (i < bufs.len && n >= bufs.ptr[i].len) {
+            n -= bufs.ptr[i].len;
+            bufs.ptr[i].len = 0;
+            i += 1;
+        }
+        if (n != 0) {
+            bufs.ptr[i] = str_slice_tail(bufs.ptr[i], n);
+        }
+    }
+    return ret;
+}
+
+static void
+init_cap_buffer(CapBuffer* buf, span_u8 s) {
+    buf->ptr = s.ptr;
+    buf->pos = 0;
+    buf->cap = s.len;
+}
+
+// Returns stored bytes.
+static span_u8
+cap_buffer_head(CapBuffer* buf) {
+    return make_span_u8(buf->ptr, buf->pos);
+}
+
+static void
+cap_buffer_reset(CapBuffer* buf) {
+    buf->pos = 0;
+}
+
+/*/doc
+
+Appends bytes to buffer. When there is not enough room, writes as many
+bytes as fit and returns ERROR_WRITER_EOF.
+*/
 static RetWrite
 cap_buffer_write(CapBuffer* buf, span_u8 s) {
-    RetWrite ret = {}; // TODO: implement this
+    RetWrite ret = {};
+    const uint n = min_uint(buf->cap - buf->pos, s.len);
+    if (n != 0) {
+        unsafe_copy(buf->ptr + buf->pos, s.ptr, n);
+        buf->pos += n;
+    }
+    ret.count = n;
+    if (n < s.len) {
+        ret.code = ERROR_WRITER_EOF;
+    }
     return ret;
 }
 
@@ -190,9 +429,87 @@ lines_reader_read(LinesReader *r, span_u8 s) {
     return ret;
 }
 
+// Number of lines passed to single vectored write.
+#define LINES_READER_WRITE_BATCH 64
+
+/*/doc
+
+Writes all remaining lines into writer with newline after each line.
+Lines are not copied: each line and newline become separate buffers of
+vectored write. On error reader stays at the start of failed batch.
+*/
+static RetWrite
+lines_reader_write_to(LinesReader* r, Writer w) {
+    str iov[2 * LINES_READER_WRITE_BATCH];
+    RetWrite ret = {};
+    while (r->i < r->lines.len) {
+        const uint k = min_uint(r->lines.len - r->i, LINES_READER_WRITE_BATCH);
+        for (uint i = 0; i < k; i += 1) {
+            str line = r->lines.ptr[r->i + i];
+            if (i == 0) {
+                line = str_slice_tail(line, min_uint(r->j, line.len));
+            }
+            iov[2 * i] = line;
+            iov[2 * i + 1] = ss("\n");
+        }
+
+        RetWrite b = bag_write_vec_all(w, make_span_str(iov, 2 * k));
+        ret.count += b.count;
+        if (b.code != 0) {
+            ret.code = b.code;
+            return ret;
+        }
+        r->i += k;
+        r->j = 0;
+    }
+    return ret;
+}
+
+/*/doc
+
+Borrows rest of current line or newline after it. Newline is
+borrowed from static string.
+*/
+static RetBorrow
+lines_reader_fill_buf(LinesReader* r) {
+    RetBorrow ret = {};
+    if (r->i >= r->lines.len) {
+        ret.code = ERROR_READER_EOF;
+        return ret;
+    }
+
+    str line = r->lines.ptr[r->i];
+    if (r->j < line.len) {
+        ret.data = str_slice_tail(line, r->j);
+    } else {
+        ret.data = ss("\n");
+    }
+    return ret;
+}
+
+static void
+lines_reader_consume(LinesReader* r, uint n) {
+    if (n == 0) {
+        return;
+    }
+
+    str line = r->lines.ptr[r->i];
+    if (r->j < line.len) {
+        must(n <= line.len - r->j);
+        r->j += n;
+        return;
+    }
+
+    must(n == 1);
+    r->j = 0;
+    r->i += 1;
+}
+
 const BagReaderTab lines_reader_reader_tab = {
     .type_id = 5,
     .read = cast(BagFuncRead, lines_reader_read),
+    .fill_buf = cast(BagFuncFillBuf, lines_reader_fill_buf),
+    .consume = cast(BagFuncConsume, lines_reader_consume),
 };
 
 static Reader
@@ -204,3 +521,487 @@ bag_lines_reader(LinesReader* lr) {
     r.tab = &lines_reader_reader_tab;
     return r;
 }
+
+/*/doc
+
+Reads data from memory, for example from file mapped with {os_map_file(...)}.
+Consumers which borrow reader memory do not copy data at all.
+*/
+typedef struct {
+    span_u8 data;
+
+    // Number of bytes already read.
+    uint pos;
+} MemReader;
+
+static void
+init_mem_reader(MemReader* r, span_u8 data) {
+    r->data = data;
+    r->pos = 0;
+}
+
+static RetRead
+mem_reader_read(MemReader* r, span_u8 s) {
+    RetRead ret = {};
+    if (r->pos == r->data.len) {
+        ret.code = ERROR_READER_EOF;
+        return ret;
+    }
+
+    const uint n = min_uint(s.len, r->data.len - r->pos);
+    if (n != 0) {
+        unsafe_copy(s.ptr, r->data.ptr + r->pos, n);
+    }
+    r->pos += n;
+    ret.count = n;
+    return ret;
+}
+
+static RetBorrow
+mem_reader_fill_buf(MemReader* r) {
+    RetBorrow ret = {};
+    if (r->pos == r->data.len) {
+        ret.code = ERROR_READER_EOF;
+        return ret;
+    }
+    ret.data = span_u8_slice_tail(r->data, r->pos);
+    return ret;
+}
+
+static void
+mem_reader_consume(MemReader* r, uint n) {
+    must(n <= r->data.len - r->pos);
+    r->pos += n;
+}
+
+const BagReaderTab mem_reader_bag_reader_tab = {
+    .type_id = 10,
+    .read = cast(BagFuncRead, mem_reader_read),
+    .fill_buf = cast(BagFuncFillBuf, mem_reader_fill_buf),
+    .consume = cast(BagFuncConsume, mem_reader_consume),
+};
+
+static Reader
+bag_mem_reader(MemReader* r) {
+    must(r != nil);
+
+    Reader reader = {};
+    reader.obj = cast(uint, r);
+    reader.tab = &mem_reader_bag_reader_tab;
+    return reader;
+}
+
+/*/doc
+
+Reader which reads from underlying reader in large chunks and lets
+caller inspect buffered data before consuming it. Buffer memory is
+provided by caller.
+
+Related:
+    +init_buf_reader(...)
+    .buf_reader_peek(...)
+    .buf_reader_consume(...)
+    .buf_reader_read_until(...)
+    .buf_reader_read_line(...)
+    .bag_buf_reader(...)
+*/
+typedef struct {
+    Reader reader;
+
+    // Array pointer to buffer memory.
+    u8* ptr;
+
+    // Buffer capacity.
+    uint cap;
+
+    // Position of first unconsumed byte.
+    uint pos;
+
+    // Number of bytes stored in buffer, including consumed ones.
+    uint end;
+
+    // First error returned by underlying reader, including ERROR_READER_EOF.
+    // Reported to caller after buffered data is consumed.
+    ErrorCode code;
+
+    // Number of bytes borrowed from underlying reader memory and returned
+    // to caller. They are consumed on next call, so that returned slice
+    // stays valid until then.
+    uint borrowed;
+} BufReader;
+
+static void
+init_buf_reader(BufReader* r, Reader reader, span_u8 buf) {
+    must(buf.len != 0);
+
+    r->reader = reader;
+    r->ptr = buf.ptr;
+    r->cap = buf.len;
+    r->pos = 0;
+    r->end = 0;
+    r->code = 0;
+    r->borrowed = 0;
+}
+
+// Returns buffered unconsumed bytes.
+static span_u8
+buf_reader_head(BufReader* r) {
+    return make_span_u8(r->ptr + r->pos, r->end - r->pos);
+}
+
+// Consumes bytes borrowed from underlying reader by previous call.
+static void
+buf_reader_settle(BufReader* r) {
+    if (r->borrowed == 0) {
+        return;
+    }
+    r->reader.tab->consume(cast(void*, r->reader.obj), r->borrowed);
+    r->borrowed = 0;
+}
+
+/*/doc
+
+Moves unconsumed bytes to buffer start and reads once from underlying reader
+into free space. Returns false if nothing can be read: buffer is full or
+underlying reader returned error.
+*/
+static bool
+buf_reader_fill(BufReader* r) {
+    buf_reader_settle(r);
+    if (r->code != 0) {
+        return false;
+    }
+
+    if (r->pos != 0) {
+        const uint n = r->end - r->pos;
+        if (n != 0) {
+            // regions may overlap
+            __builtin_memmove(r->ptr, r->ptr + r->pos, n);
+        }
+        r->pos = 0;
+        r->end = n;
+    }
+    if (r->end == r->cap) {
+        return false;
+    }
+
+    RetRead rr = r->reader.tab->read(cast(void*, r->reader.obj), make_span_u8(r->ptr + r->end, r->cap - r->end));
+    r->end += rr.count;
+    r->code = rr.code;
+    return rr.count != 0 || rr.code == 0;
+}
+
+/*/doc
+
+Returns at least n buffered bytes without consuming them. Returned span
+is shorter only when underlying reader ends or fails before that, it stays
+valid until next call which fills buffer. Argument must not exceed
+buffer capacity.
+*/
+static span_u8
+buf_reader_peek(BufReader* r, uint n) {
+    must(n <= r->cap);
+
+    while (r->end - r->pos < n) {
+        if (!buf_reader_fill(r)) {
+            break;
+        }
+    }
+    return buf_reader_head(r);
+}
+
+static void
+buf_reader_consume(BufReader* r, uint n) {
+    must(n <= r->end - r->pos);
+    r->pos += n;
+}
+
+/*/doc
+
+Returns error which stopped underlying reader, once buffer has nothing left.
+*/
+static ErrorCode
+buf_reader_error(BufReader* r) {
+    if (r->pos != r->end) {
+        return 0;
+    }
+    return r->code;
+}
+
+/*/doc
+
+Implements bag reader interface. Large reads into empty buffer go
+directly to underlying reader.
+*/
+static RetRead
+buf_reader_read(BufReader* r, span_u8 s) {
+    RetRead ret = {};
+    if (s.len == 0) {
+        return ret;
+    }
+
+    buf_reader_settle(r);
+    if (r->pos == r->end) {
+        if (r->code != 0) {
+            ret.code = r->code;
+            return ret;
+        }
+        if (s.len >= r->cap) {
+            return r->reader.tab->read(cast(void*, r->reader.obj), s);
+        }
+        buf_reader_fill(r);
+        if (r->pos == r->end) {
+            ret.code = r->code;
+            return ret;
+        }
+    }
+
+    const uint n = min_uint(s.len, r->end - r->pos);
+    unsafe_copy(s.ptr, r->ptr + r->pos, n);
+    r->pos += n;
+    ret.count = n;
+    return ret;
+}
+
+/*
+Describes result of reading a line or other delimited piece of data.
+*/
+typedef struct {
+    // Slice into reader buffer. Valid until next read.
+    str s;
+
+    ErrorCode code;
+} RetReadSlice;
+
+/*/doc
+
+Returns data up to delimiter straight from underlying reader memory when
+delimiter is found there. Otherwise moves borrowed data into buffer.
+Buffer must be empty.
+*/
+static bool
+buf_reader_borrow_until(BufReader* r, u8 delim, RetReadSlice* ret) {
+    void* obj = cast(void*, r->reader.obj);
+    RetBorrow b = r->reader.tab->fill_buf(obj);
+    if (b.data.len == 0) {
+        r->code = b.code;
+        return false;
+    }
+
+    RetIndex i = str_index_byte(b.data, delim);
+    if (i.ok) {
+        ret->s = str_slice_head(b.data, i.index + 1);
+        r->borrowed = i.index + 1;
+        return true;
+    }
+
+    const uint n = min_uint(b.data.len, r->cap);
+    unsafe_copy(r->ptr, b.data.ptr, n);
+    r->pos = 0;
+    r->end = n;
+    r->reader.tab->consume(obj, n);
+    return false;
+}
+
+/*/doc
+
+Reads until first occurrence of delimiter and returns data including it.
+Delimiter is searched 16 bytes at once with {str_index_byte(...)}.
+When underlying reader holds data in memory, pieces which do not cross
+its borrow boundary are returned without copying.
+
+Last piece of data without delimiter is returned with error code 0, error
+which ended underlying reader is returned on next call. When delimiter does
+not occur within buffer capacity, entire buffer is returned with
+ERROR_BUFFER_FULL.
+*/
+static RetReadSlice
+buf_reader_read_until(BufReader* r, u8 delim) {
+    RetReadSlice ret = {};
+
+    buf_reader_settle(r);
+    if (r->pos == r->end && r->code == 0 && r->reader.tab->fill_buf != nil) {
+        if (buf_reader_borrow_until(r, delim, &ret)) {
+            return ret;
+        }
+    }
+
+    // number of buffered bytes already checked for delimiter
+    uint scanned = 0;
+    while (true) {
+        str head = buf_reader_head(r);
+        RetIndex i = str_index_byte(str_slice_tail(head, scanned), delim);
+        if (i.ok) {
+            const uint n = scanned + i.index + 1;
+            ret.s = str_slice_head(head, n);
+            r->pos += n;
+            return ret;
+        }
+        scanned = head.len;
+
+        if (!buf_reader_fill(r)) {
+            head = buf_reader_head(r);
+            if (head.len == 0) {
+                ret.code = r->code;
+                return ret;
+            }
+
+            ret.s = head;
+            r->pos = r->end;
+            if (r->code == 0) {
+                ret.code = ERROR_BUFFER_FULL;
+            }
+            return ret;
+        }
+    }
+}
+
+/*/doc
+
+Reads next line and returns it without line break. Carriage return
+before line break is kept.
+*/
+static RetReadSlice
+buf_reader_read_line(BufReader* r) {
+    RetReadSlice ret = buf_reader_read_until(r, '\n');
+    if (ret.s.len != 0 && ret.s.ptr[ret.s.len - 1] == '\n') {
+        ret.s.len -= 1;
+    }
+    return ret;
+}
+
+static RetBorrow
+buf_reader_fill_buf(BufReader* r) {
+    RetBorrow ret = {};
+    while (r->pos == r->end && r->code == 0) {
+        buf_reader_fill(r);
+    }
+    ret.data = buf_reader_head(r);
+    if (ret.data.len == 0) {
+        ret.code = r->code;
+    }
+    return ret;
+}
+
+const BagReaderTab buf_reader_bag_reader_tab = {
+    .type_id = 8,
+    .read = cast(BagFuncRead, buf_reader_read),
+    .fill_buf = cast(BagFuncFillBuf, buf_reader_fill_buf),
+    .consume = cast(BagFuncConsume, buf_reader_consume),
+};
+
+static Reader
+bag_buf_reader(BufReader* r) {
+    must(r != nil);
+
+    Reader reader = {};
+    reader.obj = cast(uint, r);
+    reader.tab = &buf_reader_bag_reader_tab;
+    return reader;
+}
+
+/*/doc
+
+Writer which coalesces small writes into large writes to underlying
+writer. Buffered data reaches underlying writer when buffer is full
+or on explicit flush. Buffer memory is provided by caller.
+
+Related:
+    +init_buf_writer(...)
+    .buf_writer_flush(...)
+    .bag_buf_writer(...)
+*/
+typedef struct {
+    Writer writer;
+
+    // Array pointer to buffer memory.
+    u8* ptr;
+
+    // Number of bytes stored in buffer.
+    uint len;
+
+    // Buffer capacity.
+    uint cap;
+} BufWriter;
+
+static void
+init_buf_writer(BufWriter* w, Writer writer, span_u8 buf) {
+    must(buf.len != 0);
+
+    w->writer = writer;
+    w->ptr = buf.ptr;
+    w->len = 0;
+    w->cap = buf.len;
+}
+
+/*/doc
+
+Writes all buffered data into underlying writer. On error data which
+was not written stays in buffer.
+*/
+static ErrorCode
+buf_writer_flush(BufWriter* w) {
+    if (w->len == 0) {
+        return 0;
+    }
+
+    RetWrite ret = bag_write_all(w->writer, make_span_u8(w->ptr, w->len));
+    if (ret.code != 0) {
+        const uint n = w->len - ret.count;
+        if (ret.count != 0 && n != 0) {
+            // regions may overlap
+            __builtin_memmove(w->ptr, w->ptr + ret.count, n);
+        }
+        w->len = n;
+        return ret.code;
+    }
+    w->len = 0;
+    return 0;
+}
+
+/*/doc
+
+Implements bag writer interface. Writes larger than buffer capacity
+go directly to underlying writer after buffered data.
+*/
+static RetWrite
+buf_writer_write(BufWriter* w, span_u8 s) {
+    RetWrite ret = {};
+    while (ret.count < s.len) {
+        const uint left = s.len - ret.count;
+        if (w->len == 0 && left >= w->cap) {
+            RetWrite d = bag_write_all(w->writer, span_u8_slice_tail(s, ret.count));
+            ret.count += d.count;
+            ret.code = d.code;
+            return ret;
+        }
+
+        const uint n = min_uint(w->cap - w->len, left);
+        unsafe_copy(w->ptr + w->len, s.ptr + ret.count, n);
+        w->len += n;
+        ret.count += n;
+        if (w->len == w->cap) {
+            ErrorCode code = buf_writer_flush(w);
+            if (code != 0) {
+                ret.code = code;
+                return ret;
+            }
+        }
+    }
+    return ret;
+}
+
+const BagWriterTab buf_writer_bag_writer_tab = {
+    .type_id = 9,
+    .write = cast(BagFuncWrite, buf_writer_write),
+};
+
+static Writer
+bag_buf_writer(BufWriter* w) {
+    must(w != nil);
+
+    Writer writer = {};
+    writer.obj = cast(uint, w);
+    writer.tab = &buf_writer_bag_writer_tab;
+    return writer;
+}
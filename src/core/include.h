@@ -2,11 +2,14 @@
 #define CLAW_INCLUDE_CORE 1
 
 #include "types.c"
+#include "float.c"
+#include "simd.c"
 #include "str.c"
 #include "bag_io.c"
 
 #include "libc.h"
 #include "os_linux_amd64.c"
+#include "str_builder.c"
 
 #include "log.c"
 
@@ -6,6 +6,9 @@
 
 #define LOG_BUFFER_SIZE (1 << 14)
 
+// Strings of this size or larger are never copied into sink buffer.
+#define LOG_DIRECT_WRITE_SIZE (1 << 12)
+
 /*/doc
 
 Encapsulates buffered writes to an opened file.
@@ -84,10 +87,26 @@ log_sink_file_write(LogSink* sink, span_u8 s) {
     if (sink->fd == 0) {
         return;
     }
+    if (sink->fd == OS_LINUX_STDOUT || sink->fd == OS_LINUX_STDERR) {
+        // keep order with buffered print output
+        os_stdio_flush();
+    }
 
     os_linux_write_all(sink->fd, s);
 }
 
+static void
+log_sink_file_write_vec(LogSink* sink, span_str bufs) {
+    if (sink->fd == 0) {
+        return;
+    }
+    if (sink->fd == OS_LINUX_STDOUT || sink->fd == OS_LINUX_STDERR) {
+        os_stdio_flush();
+    }
+
+    os_linux_write_vec_all(sink->fd, bufs);
+}
+
 static void
 log_sink_file_close(LogSink* sink) {
     if (sink->fd == 0) {
@@ -135,10 +154,12 @@ log_sink_close(LogSink* sink) {
 
 static void
 log_sink_write(LogSink* sink, str s) {
-    if (s.len >= (LOG_BUFFER_SIZE / 2)) {
-        // avoid copies for large strings
-        log_sink_flush(sink);
-        log_sink_file_write(sink, s);
+    if (s.len >= LOG_DIRECT_WRITE_SIZE) {
+        // avoid copies for large strings, buffered data and string
+        // go out together in one vectored write
+        str iov[2] = { log_sink_buffer_head(sink), s };
+        log_sink_file_write_vec(sink, make_span_str(iov, 2));
+        sink->pos = 0;
         return;
     }
 
@@ -214,6 +235,15 @@ log_sink_format_dec_s64(LogSink* sink, s64 x) {
     sink->pos += n;
 }
 
+static void
+log_sink_format_f64(LogSink* sink, f64 x) {
+    log_sink_threshold_flush(sink, max_float_dec_length);
+
+    span_u8 tail = log_sink_buffer_tail(sink);
+    uint n = unsafe_fmt_f64(tail, x);
+    sink->pos += n;
+}
+
 static void
 log_sink_format_str(LogSink* sink, str s) {
     log_sink_put_byte(sink, '"');
@@ -257,9 +287,12 @@ log_sink_format_span_s64(LogSink* sink, span_s64 s) {
 
 #define LOG_FIELD_SPAN_S64 4
 
+#define LOG_FIELD_F64 5
+
 typedef union {
     u64 u64;
     s64 s64;
+    f64 f64;
     str str;
 
     span_s64 span_s64;
@@ -309,6 +342,9 @@ log_sink_format_field_value(LogSink* sink, u8 kind, LogFieldValue value) {
     case LOG_FIELD_SPAN_S64:
         log_sink_format_span_s64(sink, value.span_s64);
         return;
+    case LOG_FIELD_F64:
+        log_sink_format_f64(sink, value.f64);
+        return;
     default:
         panic_trap();
     }
@@ -361,6 +397,15 @@ log_field_s64(str name, s64 value) {
     return field;
 }
 
+static LogField
+log_field_f64(str name, f64 value) {
+    LogField field = {};
+    field.value.f64 = value;
+    field.name = name;
+    field.kind = LOG_FIELD_F64;
+    return field;
+}
+
 static LogField
 log_field_str(str name, str value) {
     LogField field = {};
@@ -548,6 +593,11 @@ log_info_field(Logger* lg, str s, LogField field) {
     log_message_field(lg, LOG_LEVEL_INFO, s, field);
 }
 
+static void
+log_info_field2(Logger* lg, str s, LogField field1, LogField field2) {
+    log_message_field2(lg, LOG_LEVEL_INFO, s, field1, field2);
+}
+
 static void
 log_info_fields(Logger* lg, str s, SpanLogField fields) {
     log_message_fields(lg, LOG_LEVEL_INFO, s, fields);
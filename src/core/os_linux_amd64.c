@@ -10,8 +10,121 @@ cpu_clock() {
     return amd64_rdtsc();
 }
 
+static void
+amd64_cpuid(u32 leaf, u32 subleaf, u32* regs) {
+    __asm__ volatile ("cpuid"
+        : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+        : "a" (leaf), "c" (subleaf)
+    );
+}
+
+static u64
+amd64_xgetbv(u32 index) {
+    u32 low, high;
+    __asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (index));
+    return (cast(u64, high) << 32) | low;
+}
+
+#define CPU_FEATURE_SSSE3    (1 << 0)
+#define CPU_FEATURE_SSE41    (1 << 1)
+#define CPU_FEATURE_SSE42    (1 << 2)
+#define CPU_FEATURE_AVX2_BASE (1 << 3)
+#define CPU_FEATURE_BMI2     (1 << 4)
+#define CPU_FEATURE_AVX512F  (1 << 5)
+#define CPU_FEATURE_AVX512BW (1 << 6)
+#define CPU_FEATURE_AVX512VL (1 << 7)
+#define CPU_FEATURE_POPCNT   (1 << 8)
+
+// Feature set required by functions marked with TARGET_AVX2.
+#define CPU_FEATURE_AVX2 (CPU_FEATURE_AVX2_BASE | CPU_FEATURE_BMI2 | CPU_FEATURE_POPCNT)
+
+// Feature set required by functions marked with TARGET_AVX512.
+#define CPU_FEATURE_AVX512 (CPU_FEATURE_AVX2 | CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512BW | CPU_FEATURE_AVX512VL)
+
+// Set when {cpu_features} field is initialized.
+#define CPU_FEATURE_INIT 0x80000000
+
+// Bit flags of detected CPU features. Filled lazily on first query.
+static u32 cpu_features;
+
+static u32
+amd64_detect_cpu_features() {
+    u32 features = CPU_FEATURE_INIT;
+
+    u32 regs[4];
+    amd64_cpuid(0, 0, regs);
+    const u32 max_leaf = regs[0];
+
+    amd64_cpuid(1, 0, regs);
+    const u32 ecx1 = regs[2];
+    if ((ecx1 & (1 << 9)) != 0) {
+        features |= CPU_FEATURE_SSSE3;
+    }
+    if ((ecx1 & (1 << 19)) != 0) {
+        features |= CPU_FEATURE_SSE41;
+    }
+    if ((ecx1 & (1 << 20)) != 0) {
+        features |= CPU_FEATURE_SSE42;
+    }
+    if ((ecx1 & (1 << 23)) != 0) {
+        features |= CPU_FEATURE_POPCNT;
+    }
+
+    // OS must enable saving of extended registers for AVX to be usable
+    const bool osxsave = (ecx1 & (1 << 27)) != 0;
+    if (!osxsave || max_leaf < 7) {
+        return features;
+    }
+    const u64 xcr0 = amd64_xgetbv(0);
+    const bool avx_state = (xcr0 & 0x6) == 0x6;
+    const bool avx512_state = (xcr0 & 0xE6) == 0xE6;
+
+    amd64_cpuid(7, 0, regs);
+    const u32 ebx7 = regs[1];
+    if (avx_state && (ebx7 & (1 << 5)) != 0) {
+        features |= CPU_FEATURE_AVX2_BASE;
+    }
+    if ((ebx7 & (1 << 8)) != 0) {
+        features |= CPU_FEATURE_BMI2;
+    }
+    if (avx512_state && (ebx7 & (1 << 16)) != 0) {
+        features |= CPU_FEATURE_AVX512F;
+    }
+    if (avx512_state && (ebx7 & (1 << 30)) != 0) {
+        features |= CPU_FEATURE_AVX512BW;
+    }
+    if (avx512_state && (ebx7 & 0x80000000) != 0) {
+        features |= CPU_FEATURE_AVX512VL;
+    }
+    return features;
+}
+
+/*/doc
+
+Returns true if CPU supports all features from a given set of flags.
+Meant for runtime dispatch between code paths compiled for different
+instruction sets.
+*/
+static bool
+cpu_has_feature(u32 f) {
+    u32 features = __atomic_load_n(&cpu_features, __ATOMIC_RELAXED);
+    if (features == 0) {
+        features = amd64_detect_cpu_features();
+        __atomic_store_n(&cpu_features, features, __ATOMIC_RELAXED);
+    }
+    return (features & f) == f;
+}
+
 #define OS_LINUX_ERROR_CODE_NOT_EXIST 2
 
+// System call was interrupted by signal before it did anything.
+#define OS_LINUX_ERROR_CODE_INTERRUPTED 4
+
+// Temporary resource shortage, for example limit on number of threads.
+#define OS_LINUX_ERROR_CODE_TRY_AGAIN 11
+
+#define OS_LINUX_ERROR_CODE_NO_MEMORY 12
+
 #define OS_LINUX_AMD64_SYSCALL_READ 0
 
 static sint
@@ -227,6 +340,7 @@ os_linux_convert_syscall_stat_error(uint c) {
 #define OS_LINUX_MEMORY_MAP_SHARED    0x01
 #define OS_LINUX_MEMORY_MAP_PRIVATE   0x02
 #define OS_LINUX_MEMORY_MAP_ANONYMOUS 0x20
+#define OS_LINUX_MEMORY_MAP_POPULATE  0x8000
 
 static sint
 os_linux_amd64_syscall_mmap(void* ptr, uint len, uint prot, uint flags, uint fd, uint offset) {
@@ -256,7 +370,540 @@ os_linux_amd64_syscall_munmap(void* ptr, uint len) {
     __asm__ __volatile__ (
         "syscall"
         : "+r" (rax)
-        : "r" (rdi), "r" (rsi)
+        : "r" (rdi), "r" (rsi)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_MREMAP 25
+
+// Allows kernel to move mapping to a different address.
+#define OS_LINUX_MREMAP_MAYMOVE 0x1
+
+static sint
+os_linux_amd64_syscall_mremap(void* ptr, uint old_len, uint new_len, uint flags) {
+    register sint  rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_MREMAP;
+    register void* rdi __asm__ ("rdi") = ptr;
+    register uint  rsi __asm__ ("rsi") = old_len;
+    register uint  rdx __asm__ ("rdx") = new_len;
+    register uint  r10 __asm__ ("r10") = flags;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_MADVISE 28
+
+#define OS_LINUX_MADVISE_RANDOM     1
+#define OS_LINUX_MADVISE_SEQUENTIAL 2
+#define OS_LINUX_MADVISE_WILLNEED   3
+#define OS_LINUX_MADVISE_HUGEPAGE   14
+
+static sint
+os_linux_amd64_syscall_madvise(void* ptr, uint len, uint advice) {
+    register sint  rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_MADVISE;
+    register void* rdi __asm__ ("rdi") = ptr;
+    register uint  rsi __asm__ ("rsi") = len;
+    register uint  rdx __asm__ ("rdx") = advice;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_FSTAT 5
+
+static sint
+os_linux_amd64_syscall_fstat(uint fd, LinuxFileStat* stat) {
+    register sint           rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_FSTAT;
+    register uint           rdi __asm__ ("rdi") = fd;
+    register LinuxFileStat* rsi __asm__ ("rsi") = stat;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_FSYNC 74
+
+static sint
+os_linux_amd64_syscall_fsync(uint fd) {
+    register sint rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_FSYNC;
+    register uint rdi __asm__ ("rdi") = fd;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_CLONE 56
+
+#define OS_LINUX_CLONE_VM             0x100
+#define OS_LINUX_CLONE_FS             0x200
+#define OS_LINUX_CLONE_FILES          0x400
+#define OS_LINUX_CLONE_SIGHAND        0x800
+#define OS_LINUX_CLONE_THREAD         0x10000
+#define OS_LINUX_CLONE_SYSVSEM        0x40000
+#define OS_LINUX_CLONE_PARENT_SETTID  0x100000
+#define OS_LINUX_CLONE_CHILD_CLEARTID 0x200000
+
+/*/doc
+
+Creates new thread which starts executing on the given stack. Top of the stack
+must hold two machine words: function pointer and its argument (in that order,
+starting from {stack}). Child thread pops them, calls the function and exits
+when it returns. Child never returns from this call.
+
+Returns thread id in parent or negative error code.
+*/
+static sint
+os_linux_amd64_syscall_clone_thread(uint flags, void* stack, u32* parent_tid, u32* child_tid) {
+    register sint  rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_CLONE;
+    register uint  rdi __asm__ ("rdi") = flags;
+    register void* rsi __asm__ ("rsi") = stack;
+    register u32*  rdx __asm__ ("rdx") = parent_tid;
+    register u32*  r10 __asm__ ("r10") = child_tid;
+    register uint  r8  __asm__ ("r8")  = 0;
+    __asm__ __volatile__ (
+        "syscall\n\t"
+        "test %%rax, %%rax\n\t"
+        "jnz 1f\n\t"
+
+        // child thread starts here with fresh stack
+        "xor %%ebp, %%ebp\n\t"
+        "pop %%rax\n\t"
+        "pop %%rdi\n\t"
+        "call *%%rax\n\t"
+
+        // exit only this thread, not the whole thread group
+        "mov $60, %%eax\n\t"
+        "xor %%edi, %%edi\n\t"
+        "syscall\n\t"
+        "hlt\n\t"
+
+        "1:\n\t"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10), "r" (r8)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_FUTEX 202
+
+#define OS_LINUX_FUTEX_WAIT 0
+#define OS_LINUX_FUTEX_WAKE 1
+
+static sint
+os_linux_amd64_syscall_futex(u32* addr, uint op, u32 val, void* timeout) {
+    register sint  rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_FUTEX;
+    register u32*  rdi __asm__ ("rdi") = addr;
+    register uint  rsi __asm__ ("rsi") = op;
+    register uint  rdx __asm__ ("rdx") = val;
+    register void* r10 __asm__ ("r10") = timeout;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_SCHED_GETAFFINITY 204
+
+static sint
+os_linux_amd64_syscall_sched_getaffinity(uint pid, uint size, void* mask) {
+    register sint  rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_SCHED_GETAFFINITY;
+    register uint  rdi __asm__ ("rdi") = pid;
+    register uint  rsi __asm__ ("rsi") = size;
+    register void* rdx __asm__ ("rdx") = mask;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_UNLINK 87
+
+static sint
+os_linux_amd64_syscall_unlink(const u8* path) {
+    register sint      rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_UNLINK;
+    register const u8* rdi __asm__ ("rdi") = path;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_READV 19
+
+/*/doc
+
+Same as {os_linux_amd64_syscall_writev(...)}, but fills buffers
+with data read from file.
+*/
+static sint
+os_linux_amd64_syscall_readv(uint fd, const str* iov, uint count) {
+    register sint       rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_READV;
+    register uint       rdi __asm__ ("rdi") = fd;
+    register const str* rsi __asm__ ("rsi") = iov;
+    register uint       rdx __asm__ ("rdx") = count;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_WRITEV 20
+
+// Maximum number of buffers accepted by single vectored read or write.
+#define OS_LINUX_IOV_MAX 1024
+
+/*/doc
+
+Elements of {iov} array have the same memory layout as kernel iovec
+struct: pointer followed by length.
+*/
+static sint
+os_linux_amd64_syscall_writev(uint fd, const str* iov, uint count) {
+    register sint       rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_WRITEV;
+    register uint       rdi __asm__ ("rdi") = fd;
+    register const str* rsi __asm__ ("rsi") = iov;
+    register uint       rdx __asm__ ("rdx") = count;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_IOCTL 16
+
+// Reads terminal attributes. Fails for files which are not terminals.
+#define OS_LINUX_IOCTL_TCGETS 0x5401
+
+static sint
+os_linux_amd64_syscall_ioctl(uint fd, uint request, void* arg) {
+    register sint  rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_IOCTL;
+    register uint  rdi __asm__ ("rdi") = fd;
+    register uint  rsi __asm__ ("rsi") = request;
+    register void* rdx __asm__ ("rdx") = arg;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+/*/doc
+
+Reports whether file descriptor refers to a terminal.
+*/
+static bool
+os_linux_is_terminal(uint fd) {
+    // large enough for kernel termios struct
+    u8 termios[64];
+    return os_linux_amd64_syscall_ioctl(fd, OS_LINUX_IOCTL_TCGETS, termios) == 0;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_LSEEK 8
+
+#define OS_LINUX_SEEK_SET 0
+#define OS_LINUX_SEEK_CUR 1
+
+static sint
+os_linux_amd64_syscall_lseek(uint fd, sint offset, uint whence) {
+    register sint rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_LSEEK;
+    register uint rdi __asm__ ("rdi") = fd;
+    register sint rsi __asm__ ("rsi") = offset;
+    register uint rdx __asm__ ("rdx") = whence;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+// Offsets of submission ring fields inside its memory mapping.
+typedef struct {
+    u32 head;
+    u32 tail;
+    u32 ring_mask;
+    u32 ring_entries;
+    u32 flags;
+    u32 dropped;
+    u32 array;
+    u32 reserved1;
+    u64 user_addr;
+} LinuxUringSqOffsets;
+
+// Offsets of completion ring fields inside its memory mapping.
+typedef struct {
+    u32 head;
+    u32 tail;
+    u32 ring_mask;
+    u32 ring_entries;
+    u32 overflow;
+    u32 cqes;
+    u32 flags;
+    u32 reserved1;
+    u64 user_addr;
+} LinuxUringCqOffsets;
+
+/*/doc
+
+Parameters of io_uring instance. Kernel fills ring sizes, supported
+features and field offsets on setup.
+*/
+typedef struct {
+    u32 sq_entries;
+    u32 cq_entries;
+    u32 flags;
+    u32 sq_thread_cpu;
+    u32 sq_thread_idle;
+    u32 features;
+    u32 wq_fd;
+    u32 reserved[3];
+
+    LinuxUringSqOffsets sq_off;
+    LinuxUringCqOffsets cq_off;
+} LinuxUringParams;
+
+// Submission queue entry. Describes single operation.
+typedef struct {
+    u8  opcode;
+    u8  flags;
+    u16 ioprio;
+    s32 fd;
+
+    // File offset. Value -1 means current file position.
+    u64 off;
+
+    // Buffer address.
+    u64 addr;
+
+    // Buffer length.
+    u32 len;
+
+    u32 rw_flags;
+
+    // Passed back unchanged in completion entry.
+    u64 user_data;
+
+    // Index of registered buffer for fixed operations.
+    u16 buf_index;
+
+    u16 personality;
+    s32 splice_fd_in;
+    u64 addr3;
+    u64 padding;
+} LinuxUringSqe;
+
+// Completion queue entry. Holds result of single operation.
+typedef struct {
+    u64 user_data;
+
+    // Same as return value of equivalent system call.
+    s32 res;
+
+    u32 flags;
+} LinuxUringCqe;
+
+static_assert(sizeof(LinuxUringParams) == 120);
+static_assert(sizeof(LinuxUringSqe) == 64);
+static_assert(sizeof(LinuxUringCqe) == 16);
+
+#define OS_LINUX_URING_OP_READV       1
+#define OS_LINUX_URING_OP_READ_FIXED  4
+#define OS_LINUX_URING_OP_WRITE_FIXED 5
+
+// Submission and completion rings share single memory mapping.
+#define OS_LINUX_URING_FEAT_SINGLE_MMAP (1 << 0)
+
+// Wait for completions in io_uring_enter.
+#define OS_LINUX_URING_ENTER_GETEVENTS (1 << 0)
+
+#define OS_LINUX_URING_REGISTER_BUFFERS 0
+
+// Memory map offsets of rings and submission entries array.
+#define OS_LINUX_URING_OFF_SQ_RING 0
+#define OS_LINUX_URING_OFF_CQ_RING 0x8000000
+#define OS_LINUX_URING_OFF_SQES    0x10000000
+
+#define OS_LINUX_AMD64_SYSCALL_IO_URING_SETUP    425
+#define OS_LINUX_AMD64_SYSCALL_IO_URING_ENTER    426
+#define OS_LINUX_AMD64_SYSCALL_IO_URING_REGISTER 427
+
+static sint
+os_linux_amd64_syscall_io_uring_setup(uint entries, LinuxUringParams* params) {
+    register sint              rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_IO_URING_SETUP;
+    register uint              rdi __asm__ ("rdi") = entries;
+    register LinuxUringParams* rsi __asm__ ("rsi") = params;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+static sint
+os_linux_amd64_syscall_io_uring_enter(uint fd, uint to_submit, uint min_complete, uint flags) {
+    register sint  rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_IO_URING_ENTER;
+    register uint  rdi __asm__ ("rdi") = fd;
+    register uint  rsi __asm__ ("rsi") = to_submit;
+    register uint  rdx __asm__ ("rdx") = min_complete;
+    register uint  r10 __asm__ ("r10") = flags;
+    register void* r8  __asm__ ("r8")  = nil; // signal mask
+    register uint  r9  __asm__ ("r9")  = 0;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10), "r" (r8), "r" (r9)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+static sint
+os_linux_amd64_syscall_io_uring_register(uint fd, uint opcode, const void* arg, uint nr_args) {
+    register sint        rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_IO_URING_REGISTER;
+    register uint        rdi __asm__ ("rdi") = fd;
+    register uint        rsi __asm__ ("rsi") = opcode;
+    register const void* rdx __asm__ ("rdx") = arg;
+    register uint        r10 __asm__ ("r10") = nr_args;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_SENDFILE 40
+
+/*/doc
+
+Copies data from {in_fd} to {out_fd} inside kernel. Input must support
+memory mapping (regular file). Offset pointer is nil to use and advance
+input file position.
+*/
+static sint
+os_linux_amd64_syscall_sendfile(uint out_fd, uint in_fd, u64* offset, uint count) {
+    register sint rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_SENDFILE;
+    register uint rdi __asm__ ("rdi") = out_fd;
+    register uint rsi __asm__ ("rsi") = in_fd;
+    register u64* rdx __asm__ ("rdx") = offset;
+    register uint r10 __asm__ ("r10") = count;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_SPLICE 275
+
+// Hint kernel to move pages instead of copying them.
+#define OS_LINUX_SPLICE_FLAG_MOVE (1 << 0)
+
+/*/doc
+
+Moves data between two file descriptors without copying it to user
+space. One of descriptors must be a pipe. Nil offset pointers mean
+current file positions.
+*/
+static sint
+os_linux_amd64_syscall_splice(uint in_fd, u64* in_off, uint out_fd, u64* out_off, uint len, uint flags) {
+    register sint rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_SPLICE;
+    register uint rdi __asm__ ("rdi") = in_fd;
+    register u64* rsi __asm__ ("rsi") = in_off;
+    register uint rdx __asm__ ("rdx") = out_fd;
+    register u64* r10 __asm__ ("r10") = out_off;
+    register uint r8  __asm__ ("r8")  = len;
+    register uint r9  __asm__ ("r9")  = flags;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10), "r" (r8), "r" (r9)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_PIPE2 293
+
+#define OS_LINUX_PIPE_FLAG_CLOEXEC 0x80000
+
+static sint
+os_linux_amd64_syscall_pipe2(s32* fds, uint flags) {
+    register sint rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_PIPE2;
+    register s32* rdi __asm__ ("rdi") = fds;
+    register uint rsi __asm__ ("rsi") = flags;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi)
+        : "rcx", "r11", "memory"
+    );
+    return rax;
+}
+
+#define OS_LINUX_AMD64_SYSCALL_COPY_FILE_RANGE 326
+
+/*/doc
+
+Copies data between two regular files inside kernel. Filesystem may
+share extents (reflink) or delegate copy to server instead of moving
+data. Nil offset pointers mean current file positions.
+*/
+static sint
+os_linux_amd64_syscall_copy_file_range(uint in_fd, u64* in_off, uint out_fd, u64* out_off, uint len, uint flags) {
+    register sint rax __asm__ ("rax") = OS_LINUX_AMD64_SYSCALL_COPY_FILE_RANGE;
+    register uint rdi __asm__ ("rdi") = in_fd;
+    register u64* rsi __asm__ ("rsi") = in_off;
+    register uint rdx __asm__ ("rdx") = out_fd;
+    register u64* r10 __asm__ ("r10") = out_off;
+    register uint r8  __asm__ ("r8")  = len;
+    register uint r9  __asm__ ("r9")  = flags;
+    __asm__ __volatile__ (
+        "syscall"
+        : "+r" (rax)
+        : "r" (rdi), "r" (rsi), "r" (rdx), "r" (r10), "r" (r8), "r" (r9)
         : "rcx", "r11", "memory"
     );
     return rax;
@@ -288,8 +935,14 @@ os_linux_amd64_syscall_exit(uint c) {
 	__builtin_unreachable();
 }
 
+/*/doc
+
+Terminates the process. Flushes buffered standard output and error
+streams before exit.
+*/
 static _Noreturn void
 os_exit(uint c) {
+    os_stdio_flush();
     os_linux_amd64_syscall_exit(c);
 }
 
@@ -316,6 +969,7 @@ os_linux_write(uint fd, span_u8 buf) {
     return ret;
 }
 
+#define OS_LINUX_STDIN 0
 #define OS_LINUX_STDOUT 1
 #define OS_LINUX_STDERR 2
 
@@ -340,12 +994,214 @@ os_linux_write_all(uint fd, str s) {
     return ret;
 }
 
-static void stdout_write(span_u8 s) {
-    os_linux_write_all(OS_LINUX_STDOUT, s);
+/*/doc
+
+Writes buffers in a single system call. Only first OS_LINUX_IOV_MAX
+buffers are used, the rest is left unwritten as if write was partial.
+*/
+static RetWrite
+os_linux_write_vec(uint fd, span_str bufs) {
+    RetWrite ret = {};
+    if (bufs.len == 0) {
+        return ret;
+    }
+
+    sint n = os_linux_amd64_syscall_writev(fd, bufs.ptr, min_uint(bufs.len, OS_LINUX_IOV_MAX));
+    if (n < 0) {
+        ret.code = os_linux_convert_syscall_write_error(cast(uint, -n));
+        return ret;
+    }
+
+    ret.count = cast(uint, n);
+    return ret;
+}
+
+/*/doc
+
+Writes all buffers, retrying after partial writes. Elements of {bufs}
+are modified in the process: fully written ones become empty, partially
+written one is advanced past written bytes.
+*/
+static RetWrite
+os_linux_write_vec_all(uint fd, span_str bufs) {
+    RetWrite ret = {};
+    uint i = 0;
+    while (i < bufs.len) {
+        const uint k = min_uint(bufs.len - i, OS_LINUX_IOV_MAX);
+        RetWrite w = os_linux_write_vec(fd, make_span_str(bufs.ptr + i, k));
+        ret.count += w.count;
+        if (w.code != 0) {
+            ret.code = w.code;
+            return ret;
+        }
+
+        uint n = w.count;
+        while (i < bufs.len && n >= bufs.ptr[i].len) {
+            n -= bufs.ptr[i].len;
+            bufs.ptr[i].len = 0;
+            i += 1;
+        }
+        if (n != 0) {
+            bufs.ptr[i] = str_slice_tail(bufs.ptr[i], n);
+        }
+    }
+    return ret;
+}
+
+#ifndef OS_STDOUT_BUFFER_SIZE
+#define OS_STDOUT_BUFFER_SIZE (1 << 16)
+#endif
+
+#ifndef OS_STDERR_BUFFER_SIZE
+#define OS_STDERR_BUFFER_SIZE (1 << 12)
+#endif
+
+/*/doc
+
+Buffered writer for standard output or error stream. Buffer is flushed
+when it gets full, on process exit and explicitly via {stdout_flush()}
+or {stderr_flush()}. When stream is a terminal, buffer is also flushed
+after each write which contains newline.
+
+Not safe for concurrent use from multiple threads.
+
+Related:
+    .stdout_write(...)
+    .stdout_set_buffer(...)
+    .os_stdio_flush()
+*/
+typedef struct {
+    // Pointer to buffer memory.
+    u8* ptr;
+
+    // Number of bytes currently stored in buffer.
+    uint len;
+
+    // Buffer capacity. Writes go directly to file if it is 0.
+    uint cap;
+
+    // File descriptor of the stream.
+    uint fd;
+
+    // Flush after each write which contains newline.
+    bool line_mode;
+
+    // Becomes true when terminal check was made. Check is done
+    // lazily on first write.
+    bool ready;
+} OsStdioBuffer;
+
+static u8 os_stdout_buffer_array[OS_STDOUT_BUFFER_SIZE];
+static u8 os_stderr_buffer_array[OS_STDERR_BUFFER_SIZE];
+
+static OsStdioBuffer os_stdout_buffer = {
+    .ptr = os_stdout_buffer_array,
+    .cap = OS_STDOUT_BUFFER_SIZE,
+    .fd = OS_LINUX_STDOUT,
+};
+
+static OsStdioBuffer os_stderr_buffer = {
+    .ptr = os_stderr_buffer_array,
+    .cap = OS_STDERR_BUFFER_SIZE,
+    .fd = OS_LINUX_STDERR,
+};
+
+static void
+os_stdio_buffer_flush(OsStdioBuffer* b) {
+    if (b->len == 0) {
+        return;
+    }
+
+    os_linux_write_all(b->fd, make_span_u8(b->ptr, b->len));
+    b->len = 0;
+}
+
+static void
+os_stdio_buffer_write(OsStdioBuffer* b, span_u8 s) {
+    if (s.len == 0) {
+        return;
+    }
+    if (!b->ready) {
+        b->line_mode = os_linux_is_terminal(b->fd);
+        b->ready = true;
+    }
+
+    if (s.len > b->cap - b->len) {
+        os_stdio_buffer_flush(b);
+        if (s.len >= b->cap) {
+            // avoid copies for large writes
+            os_linux_write_all(b->fd, s);
+            return;
+        }
+    }
+
+    unsafe_copy(b->ptr + b->len, s.ptr, s.len);
+    b->len += s.len;
+    if (b->line_mode && str_index_back_byte(s, '\n').ok) {
+        os_stdio_buffer_flush(b);
+    }
+}
+
+/*/doc
+
+Flushes pending data and switches stream to a new buffer memory.
+Empty span makes stream unbuffered. Buffer memory must stay valid
+until process exit or next call.
+*/
+static void
+os_stdio_buffer_set(OsStdioBuffer* b, span_u8 buf) {
+    os_stdio_buffer_flush(b);
+    b->ptr = buf.ptr;
+    b->cap = buf.len;
+}
+
+static void
+stdout_write(span_u8 s) {
+    os_stdio_buffer_write(&os_stdout_buffer, s);
+}
+
+static void
+stderr_write(span_u8 s) {
+    os_stdio_buffer_write(&os_stderr_buffer, s);
+}
+
+static void
+stdout_flush(void) {
+    os_stdio_buffer_flush(&os_stdout_buffer);
+}
+
+static void
+stderr_flush(void) {
+    os_stdio_buffer_flush(&os_stderr_buffer);
+}
+
+static void
+stdout_set_buffer(span_u8 buf) {
+    os_stdio_buffer_set(&os_stdout_buffer, buf);
+}
+
+static void
+stderr_set_buffer(span_u8 buf) {
+    os_stdio_buffer_set(&os_stderr_buffer, buf);
+}
+
+/*/doc
+
+Flushes both standard output and error streams.
+*/
+static void
+os_stdio_flush(void) {
+    stdout_flush();
+    stderr_flush();
 }
 
-static void stderr_write(span_u8 s) {
-    os_linux_write_all(OS_LINUX_STDERR, s);
+/*/doc
+
+Runs after return from main, when libc calls exit handlers.
+*/
+__attribute__((destructor)) static void
+os_stdio_flush_at_exit(void) {
+    os_stdio_flush();
 }
 
 static ErrorCode
@@ -375,6 +1231,32 @@ os_linux_read(uint fd, span_u8 buf) {
     return ret;
 }
 
+/*/doc
+
+Reads into buffers in order with a single system call. Only first
+OS_LINUX_IOV_MAX buffers are used.
+*/
+static RetRead
+os_linux_read_vec(uint fd, span_str bufs) {
+    RetRead ret = {};
+    if (bufs.len == 0) {
+        return ret;
+    }
+
+    sint n = os_linux_amd64_syscall_readv(fd, bufs.ptr, min_uint(bufs.len, OS_LINUX_IOV_MAX));
+    if (n == 0) {
+        ret.code = ERROR_READER_EOF;
+        return ret;
+    }
+    if (n < 0) {
+        ret.code = os_linux_convert_syscall_read_error(cast(uint, -n));
+        return ret;
+    }
+
+    ret.count = cast(uint, n);
+    return ret;
+}
+
 /*
 Reads until reaching EOF on given file descriptor or no more
 space left in buffer.
@@ -388,7 +1270,7 @@ os_linux_read_all(uint fd, span_u8 buf) {
 	}
 
     while (ret.count < buf.len) {
-        RetRead r = os_linux_read(fd, buf);
+        RetRead r = os_linux_read(fd, span_u8_slice_tail(buf, ret.count));
         ret.count += r.count;
         
         if (r.code != 0) {
@@ -440,6 +1322,143 @@ os_linux_mem_free(MemBlock block) {
     }
 }
 
+/*/doc
+
+Changes size of memory block obtained from {os_linux_mem_alloc(...)}.
+Contents are preserved up to the smaller of old and new sizes. Block may
+be moved to a different address, pages are remapped without copying.
+*/
+static ErrorCode
+os_linux_mem_realloc(MemBlock* block, uint len) {
+    must(len != 0);
+    if (block->span.len == 0) {
+        block->span.len = len;
+        return os_linux_mem_alloc(block);
+    }
+
+    len = align_uint(len, OS_LINUX_PAGE_SIZE);
+    sint n = os_linux_amd64_syscall_mremap(block->span.ptr, block->span.len, len, OS_LINUX_MREMAP_MAYMOVE);
+    if (n < 0) {
+        return os_linux_convert_syscall_mmap_error(cast(uint, -n));
+    }
+
+    block->span.ptr = cast(u8*, n);
+    block->span.len = len;
+    return 0;
+}
+
+#define OS_THREAD_STACK_SIZE (1 << 23)
+
+typedef void (*OsThreadFunc)(void*);
+
+/*/doc
+
+Handle to a thread created directly via clone syscall. Threads share
+address space, file descriptors and signal handlers with the whole process.
+
+Related:
+    +os_thread_start(...)
+    .os_thread_join(...)
+*/
+typedef struct {
+    // Memory for thread stack, allocated directly from operating system.
+    MemBlock stack;
+
+    // Kernel thread id. Kernel sets it to 0 (and wakes futex waiters on it)
+    // when thread exits.
+    u32 tid;
+} OsThread;
+
+/*/doc
+
+Kernel memory shortage is reported as ERROR_NO_MEMORY, like failed
+allocation. Other codes (OS_LINUX_ERROR_CODE_TRY_AGAIN when thread limit
+is reached) are passed as is.
+*/
+static ErrorCode
+os_linux_convert_syscall_clone_error(uint c) {
+    if (c == OS_LINUX_ERROR_CODE_NO_MEMORY) {
+        return ERROR_NO_MEMORY;
+    }
+    return c;
+}
+
+/*/doc
+
+Starts new thread which executes {fn(arg)}. Thread must be joined
+with {os_thread_join(...)} in order to release its stack.
+*/
+static ErrorCode
+os_thread_start(OsThread* t, OsThreadFunc fn, void* arg) {
+    must(fn != nil);
+
+    t->stack.span.len = OS_THREAD_STACK_SIZE;
+    ErrorCode code = os_linux_mem_alloc(&t->stack);
+    if (code != 0) {
+        clear_mem_block(&t->stack);
+        return code;
+    }
+
+    // function and its argument are placed at the top of the stack,
+    // child thread pops them right after clone
+    uint* top = cast(uint*, t->stack.span.ptr + t->stack.span.len);
+    top -= 2;
+    top[0] = cast(uint, fn);
+    top[1] = cast(uint, arg);
+
+    const uint flags = OS_LINUX_CLONE_VM | OS_LINUX_CLONE_FS | OS_LINUX_CLONE_FILES |
+        OS_LINUX_CLONE_SIGHAND | OS_LINUX_CLONE_THREAD | OS_LINUX_CLONE_SYSVSEM |
+        OS_LINUX_CLONE_PARENT_SETTID | OS_LINUX_CLONE_CHILD_CLEARTID;
+    sint n = os_linux_amd64_syscall_clone_thread(flags, top, &t->tid, &t->tid);
+    if (n < 0) {
+        os_linux_mem_free(t->stack);
+        clear_mem_block(&t->stack);
+        return os_linux_convert_syscall_clone_error(cast(uint, -n));
+    }
+
+    return 0;
+}
+
+/*/doc
+
+Blocks until thread exits. Releases thread stack afterwards.
+*/
+static void
+os_thread_join(OsThread* t) {
+    while (true) {
+        u32 tid = __atomic_load_n(&t->tid, __ATOMIC_ACQUIRE);
+        if (tid == 0) {
+            break;
+        }
+        os_linux_amd64_syscall_futex(&t->tid, OS_LINUX_FUTEX_WAIT, tid, nil);
+    }
+
+    os_linux_mem_free(t->stack);
+    clear_mem_block(&t->stack);
+}
+
+/*/doc
+
+Returns number of CPUs available to the process. Always returns at least 1.
+*/
+static uint
+os_cpu_count() {
+    u64 mask[16] = {};
+    sint n = os_linux_amd64_syscall_sched_getaffinity(0, sizeof(mask), mask);
+    if (n <= 0) {
+        return 1;
+    }
+
+    uint count = 0;
+    for (uint i = 0; i < cast(uint, n) / sizeof(u64); i += 1) {
+        count += cast(uint, __builtin_popcountl(mask[i]));
+    }
+    if (count == 0) {
+        return 1;
+    }
+    return count;
+}
+
 /*
 Represents a blob that was fully loaded into memory.
 */
@@ -505,6 +1524,39 @@ os_create(str path) {
     return os_open_file(path, OS_LINUX_OPEN_FLAG_WRITE_ONLY | OS_LINUX_OPEN_FLAG_CREATE | OS_LINUX_OPEN_FLAG_TRUNCATE, 0644);
 }
 
+/*/doc
+
+Missing file is reported as OS_LINUX_ERROR_CODE_NOT_EXIST, so that
+callers can ignore it when removing files which may not exist. Other
+codes are passed as is.
+*/
+static ErrorCode
+os_linux_convert_syscall_unlink_error(uint c) {
+    return c;
+}
+
+/*/doc
+
+Removes file with a given path.
+*/
+static ErrorCode
+os_remove(str path) {
+    must(path.len != 0);
+
+    if (path.len >= OS_LINUX_MAX_PATH_LENGTH) {
+        return ERROR_LONG_PATH;
+    }
+
+    u8 path_buf[OS_LINUX_MAX_PATH_LENGTH];
+    c_string cstr_path = unsafe_copy_as_c_string(make_span_u8(path_buf, OS_LINUX_MAX_PATH_LENGTH), path);
+
+    sint n = os_linux_amd64_syscall_unlink(cstr_path.ptr);
+    if (n < 0) {
+        return os_linux_convert_syscall_unlink_error(cast(uint, -n));
+    }
+    return 0;
+}
+
 /*
 Reads entire file into memory provided by allocator.
 
@@ -555,9 +1607,97 @@ os_load_file(MemAllocator al, str path, MemBlob* blob) {
     return 0;
 }
 
+// Prefault all pages of mapping at once, when file is mapped.
+#define OS_MAP_FILE_POPULATE   (1 << 0)
+
+// Data will be accessed in order, kernel reads ahead aggressively.
+#define OS_MAP_FILE_SEQUENTIAL (1 << 1)
+
+// Data will be needed soon, kernel starts reading it asynchronously.
+#define OS_MAP_FILE_WILLNEED   (1 << 2)
+
+// Back mapping with huge pages where filesystem supports it.
+#define OS_MAP_FILE_HUGEPAGE   (1 << 3)
+
+// Hints suitable for a file which is read once from start to end.
+#define OS_MAP_FILE_DEFAULT (OS_MAP_FILE_POPULATE | OS_MAP_FILE_SEQUENTIAL)
+
+/*
+Maps entire file into memory for reading. Unlike {os_load_file(...)}
+data is not copied, blob memory is backed by page cache directly.
+Hints are a combination of OS_MAP_FILE_* flags, kernel may ignore them.
+
+File must exist. Must be regular file. Mapping of empty file is an
+empty blob, blob is also left empty on error. Blob memory is read-only
+and must be released with {os_unmap_file(...)}.
+*/
+static ErrorCode
+os_map_file(str path, uint hints, MemBlob* blob) {
+    clear_mem_blob(blob);
+
+    RetOpen o = os_open(path);
+    if (o.code != 0) {
+        return o.code;
+    }
+
+    LinuxFileStat stat;
+    sint n = os_linux_amd64_syscall_fstat(o.fd, &stat);
+    if (n < 0) {
+        os_linux_amd64_syscall_close(o.fd);
+        return os_linux_convert_syscall_stat_error(cast(uint, -n));
+    }
+    if (stat.size == 0) {
+        os_linux_amd64_syscall_close(o.fd);
+        return 0;
+    }
+
+    uint flags = OS_LINUX_MEMORY_MAP_PRIVATE;
+    if ((hints & OS_MAP_FILE_POPULATE) != 0) {
+        flags |= OS_LINUX_MEMORY_MAP_POPULATE;
+    }
+    n = os_linux_amd64_syscall_mmap(nil, stat.size, OS_LINUX_MEMORY_MAP_PROT_READ, flags, o.fd, 0);
+
+    // mapping keeps its own reference to file
+    os_linux_amd64_syscall_close(o.fd);
+    if (n < 0) {
+        return os_linux_convert_syscall_mmap_error(cast(uint, -n));
+    }
+
+    blob->block.span.ptr = cast(u8*, n);
+    blob->block.span.len = align_uint(stat.size, OS_LINUX_PAGE_SIZE);
+    blob->block.id = 0;
+    blob->size = stat.size;
+
+    // advice is best effort, errors are ignored
+    if ((hints & OS_MAP_FILE_SEQUENTIAL) != 0) {
+        os_linux_amd64_syscall_madvise(blob->block.span.ptr, blob->block.span.len, OS_LINUX_MADVISE_SEQUENTIAL);
+    }
+    if ((hints & OS_MAP_FILE_WILLNEED) != 0) {
+        os_linux_amd64_syscall_madvise(blob->block.span.ptr, blob->block.span.len, OS_LINUX_MADVISE_WILLNEED);
+    }
+    if ((hints & OS_MAP_FILE_HUGEPAGE) != 0) {
+        os_linux_amd64_syscall_madvise(blob->block.span.ptr, blob->block.span.len, OS_LINUX_MADVISE_HUGEPAGE);
+    }
+    return 0;
+}
+
+/*/doc
+
+Releases mapping obtained from {os_map_file(...)}.
+*/
+static void
+os_unmap_file(MemBlob* blob) {
+    if (blob->block.span.len == 0) {
+        return;
+    }
+    os_linux_mem_free(blob->block);
+    clear_mem_blob(blob);
+}
+
 const BagReaderTab bag_fd_reader_tab = {
     .type_id = 3,
     .read = cast(BagFuncRead, cast(void*, os_linux_read)),
+    .read_vec = cast(BagFuncReadVec, cast(void*, os_linux_read_vec)),
 };
 
 static Reader
@@ -571,6 +1711,7 @@ bag_fd_reader(uint fd) {
 const BagWriterTab bag_fd_writer_tab = {
     .type_id = 4,
     .write = cast(BagFuncWrite, cast(void*, os_linux_write)),
+    .write_vec = cast(BagFuncWriteVec, cast(void*, os_linux_write_vec)),
 };
 
 static Writer
@@ -0,0 +1,51 @@
+/*
+Fixed size vector types based on compiler vector extensions. Arithmetic,
+bitwise and comparison operators work on them lane by lane. Comparison
+produces signed integer vector of the same lane width with all bits set
+in lanes where comparison holds.
+
+Code which uses these types compiles for any target. Functions which need
+specific instruction set should be marked with target attribute and
+selected at runtime via {cpu_has_feature(...)}.
+*/
+
+typedef u32 vec8_u32 __attribute__((vector_size(32)));
+typedef s32 vec8_s32 __attribute__((vector_size(32)));
+typedef f32 vec8_f32 __attribute__((vector_size(32)));
+typedef u64 vec4_u64 __attribute__((vector_size(32)));
+typedef s64 vec4_s64 __attribute__((vector_size(32)));
+typedef f64 vec4_f64 __attribute__((vector_size(32)));
+
+typedef u8  vec16_u8 __attribute__((vector_size(16)));
+typedef s16 vec8_s16 __attribute__((vector_size(16)));
+typedef s32 vec4_s32 __attribute__((vector_size(16)));
+
+// Lanes of plain char type. Byte arguments of SSE builtins
+// are declared with this type, other byte vectors must be cast to it.
+typedef char vec16_char __attribute__((vector_size(16)));
+
+// Occupies one AVX-512 register or two AVX2 registers.
+typedef u64 vec8_u64 __attribute__((vector_size(64)));
+
+// Marks function to be compiled with SSSE3 byte shuffle instructions enabled.
+// Check for CPU_FEATURE_SSSE3 before calling it.
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+
+// Marks function to be compiled with AVX2 instructions enabled
+// (together with BMI2 and POPCNT, present on all AVX2 CPUs in practice).
+// Check for CPU_FEATURE_AVX2 before calling it.
+#define TARGET_AVX2 __attribute__((target("avx2,bmi2,popcnt")))
+
+// Marks function to be compiled with AVX-512 instructions enabled
+// (foundation, byte/word and 128/256-bit vector length extensions).
+// Check for CPU_FEATURE_AVX512 before calling it.
+#define TARGET_AVX512 __attribute__((target("avx2,bmi2,popcnt,avx512f,avx512bw,avx512vl")))
+
+// Unaligned load and store. Dereferencing vector pointer directly
+// requires memory to be aligned by vector size.
+#define simd_load(v, p)  __builtin_memcpy(&(v), (p), sizeof(v))
+#define simd_store(p, v) __builtin_memcpy((p), &(v), sizeof(v))
+
+// Collects top bits of four 64-bit lanes into integer bit mask.
+// Usable only inside functions with AVX target.
+#define simd_movemask_vec4(v) cast(uint, __builtin_ia32_movmskpd256(cast(vec4_f64, (v))))
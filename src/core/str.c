@@ -3,10 +3,29 @@ typedef struct {
     bool ok;
 } RetIndex;
 
+/*/doc
+
+Returns index of first occurrence of byte in string. Compares 16 bytes
+at once, SSE2 is always available on amd64.
+*/
 static RetIndex
 str_index_byte(str s, u8 x) {
     RetIndex ret = {};
-    for (uint i = 0; i < s.len; i += 1) {
+
+    const vec16_u8 needle = (vec16_u8){} + x;
+    uint i = 0;
+    for (; i + 16 <= s.len; i += 16) {
+        vec16_u8 v;
+        simd_load(v, s.ptr + i);
+        const uint mask = cast(uint, __builtin_ia32_pmovmskb128(cast(vec16_char, v == needle)));
+        if (mask != 0) {
+            ret.index = i + cast(uint, __builtin_ctzl(mask));
+            ret.ok = true;
+            return ret;
+        }
+    }
+
+    for (; i < s.len; i += 1) {
         if (s.ptr[i] == x) {
             ret.index = i;
             ret.ok = true;
@@ -33,6 +52,33 @@ str_index_back_byte(str s, u8 x) {
 
 /*/doc
 
+Compares two strings lexicographically byte by byte. Returns negative number
+if {a} < {b}, positive number if {a} > {b} and 0 if strings are equal.
+String which is a proper prefix of another string is considered smaller.
+*/
+static s32
+str_compare(str a, str b) {
+    uint n = min_uint(a.len, b.len);
+    for (uint i = 0; i < n; i += 1) {
+        if (a.ptr[i] != b.ptr[i]) {
+            if (a.ptr[i] < b.ptr[i]) {
+                return -1;
+            }
+            return 1;
+        }
+    }
+
+    if (a.len < b.len) {
+        return -1;
+    }
+    if (a.len > b.len) {
+        return 1;
+    }
+    return 0;
+}
+
+/*/doc
+
 Removes space characters (' ' byte) from both start and end of the string.
 Returned string is either:
 1. empty in case original string contains only spaces or is empty
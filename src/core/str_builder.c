@@ -0,0 +1,414 @@
+/*
+String builder which grows by chaining chunks of memory obtained from
+allocator. Chunks are never moved or copied, thus growth does not
+reformat or copy already built text and works well with arena-like
+allocators. Built text can be handed off to vectored write chunk by chunk.
+*/
+
+// Data capacity of the first chunk if not specified at init.
+#define STR_BUILDER_DEFAULT_CHUNK_SIZE (1 << 12)
+
+// Data capacity of chunks stops growing upon reaching this size.
+#define STR_BUILDER_MAX_CHUNK_SIZE (1 << 20)
+
+/*/doc
+
+Header placed at the start of each chunk memory block. Chunk data
+follows the header.
+*/
+typedef struct StrBuilderChunk {
+    // Next chunk in chain. Nil for the last allocated chunk.
+    struct StrBuilderChunk* next;
+
+    // Memory block which holds header and data of this chunk.
+    MemBlock block;
+
+    // Number of data bytes stored in chunk.
+    uint len;
+
+    // Chunk data capacity.
+    uint cap;
+} StrBuilderChunk;
+
+/*/doc
+
+Growable string builder with the same put vocabulary as FormatBuffer.
+Instead of trapping when there is no room left it allocates a new chunk
+twice as large as previous one.
+
+Allocation error is sticky: it is saved in builder, further puts
+do nothing. Check it with {str_builder_error(...)} after building.
+
+Related:
+    +init_str_builder(...)
+    .str_builder_write_fd(...)
+    .str_builder_copy(...)
+    .str_builder_free(...)
+*/
+typedef struct {
+    MemAllocator al;
+
+    // First chunk in chain. Nil until first put.
+    StrBuilderChunk* head;
+
+    // Chunk which receives puts. Chunks after it (if any) are empty
+    // and were kept by {str_builder_reset(...)} for reuse.
+    StrBuilderChunk* tail;
+
+    // Total number of bytes stored in all chunks.
+    uint len;
+
+    // Data capacity of next allocated chunk.
+    uint next_cap;
+
+    // First allocation error.
+    ErrorCode code;
+} StrBuilder;
+
+static void
+init_str_builder(StrBuilder* b, MemAllocator al, uint chunk_size) {
+    b->al = al;
+    b->head = nil;
+    b->tail = nil;
+    b->len = 0;
+    b->next_cap = chunk_size == 0 ? STR_BUILDER_DEFAULT_CHUNK_SIZE : chunk_size;
+    b->code = 0;
+}
+
+static ErrorCode
+str_builder_error(StrBuilder* b) {
+    return b->code;
+}
+
+static u8*
+str_builder_chunk_data(StrBuilderChunk* c) {
+    return cast(u8*, c + 1);
+}
+
+static str
+str_builder_chunk_head(StrBuilderChunk* c) {
+    return make_str(str_builder_chunk_data(c), c->len);
+}
+
+/*/doc
+
+Makes tail chunk have at least n bytes available. Moves to already
+allocated empty chunk when possible, allocates new one otherwise.
+Returns false on allocation error.
+*/
+static bool
+str_builder_grow(StrBuilder* b, uint n) {
+    if (b->code != 0) {
+        return false;
+    }
+
+    StrBuilderChunk* next = b->tail == nil ? b->head : b->tail->next;
+    if (next != nil && next->cap >= n) {
+        b->tail = next;
+        return true;
+    }
+
+    uint cap = b->next_cap;
+    while (cap < n) {
+        cap *= 2;
+    }
+
+    MemBlock block = {};
+    block.span.len = sizeof(StrBuilderChunk) + cap;
+    ErrorCode code = mem_alloc(b->al, &block);
+    if (code != 0) {
+        b->code = code;
+        return false;
+    }
+
+    StrBuilderChunk* c = cast(StrBuilderChunk*, block.span.ptr);
+    c->block = block;
+    c->len = 0;
+    c->cap = block.span.len - sizeof(StrBuilderChunk);
+
+    // new chunk is inserted right after tail, so that reused
+    // empty chunks are not lost
+    c->next = next;
+    if (b->tail == nil) {
+        b->head = c;
+    } else {
+        b->tail->next = c;
+    }
+    b->tail = c;
+
+    if (b->next_cap < STR_BUILDER_MAX_CHUNK_SIZE) {
+        b->next_cap = min_uint(cap * 2, STR_BUILDER_MAX_CHUNK_SIZE);
+    }
+    return true;
+}
+
+/*/doc
+
+Returns contiguous unoccupied memory of at least n bytes. Returned span
+is empty on allocation error. Bytes written there must be committed
+with {str_builder_commit(...)}.
+*/
+static span_u8
+str_builder_reserve(StrBuilder* b, uint n) {
+    StrBuilderChunk* c = b->tail;
+    if (c == nil || c->cap - c->len < n) {
+        if (!str_builder_grow(b, n)) {
+            return make_span_u8(nil, 0);
+        }
+        c = b->tail;
+    }
+    return make_span_u8(str_builder_chunk_data(c) + c->len, c->cap - c->len);
+}
+
+static void
+str_builder_commit(StrBuilder* b, uint n) {
+    b->tail->len += n;
+    b->len += n;
+}
+
+/*/doc
+
+Appends string to builder. Unlike formatted puts, string may be split
+between two chunks.
+*/
+static void
+str_builder_put_str(StrBuilder* b, str s) {
+    uint i = 0;
+    while (i < s.len) {
+        span_u8 tail = str_builder_reserve(b, 1);
+        if (tail.len == 0) {
+            return;
+        }
+
+        const uint n = min_uint(tail.len, s.len - i);
+        unsafe_copy(tail.ptr, s.ptr + i, n);
+        str_builder_commit(b, n);
+        i += n;
+    }
+}
+
+static void
+str_builder_put_byte(StrBuilder* b, u8 x) {
+    span_u8 tail = str_builder_reserve(b, 1);
+    if (tail.len == 0) {
+        return;
+    }
+    tail.ptr[0] = x;
+    str_builder_commit(b, 1);
+}
+
+static void
+str_builder_put_byte_repeat(StrBuilder* b, u8 x, uint n) {
+    uint i = 0;
+    while (i < n) {
+        span_u8 tail = str_builder_reserve(b, 1);
+        if (tail.len == 0) {
+            return;
+        }
+
+        const uint k = min_uint(tail.len, n - i);
+        for (uint j = 0; j < k; j += 1) {
+            tail.ptr[j] = x;
+        }
+        str_builder_commit(b, k);
+        i += k;
+    }
+}
+
+static void
+str_builder_put_newline(StrBuilder* b) {
+    str_builder_put_byte(b, '\n');
+}
+
+static void
+str_builder_put_space(StrBuilder* b) {
+    str_builder_put_byte(b, ' ');
+}
+
+static void
+str_builder_put_space_repeat(StrBuilder* b, uint n) {
+    str_builder_put_byte_repeat(b, ' ', n);
+}
+
+static void
+str_builder_put_dec_u64(StrBuilder* b, u64 x) {
+    span_u8 tail = str_builder_reserve(b, max_u64_dec_length);
+    if (tail.len == 0) {
+        return;
+    }
+    str_builder_commit(b, unsafe_fmt_dec_u64(tail, x));
+}
+
+static void
+str_builder_put_dec_s64(StrBuilder* b, s64 x) {
+    span_u8 tail = str_builder_reserve(b, max_s64_dec_length);
+    if (tail.len == 0) {
+        return;
+    }
+    str_builder_commit(b, unsafe_fmt_dec_s64(tail, x));
+}
+
+/*/doc
+
+Puts exactly w least significant decimal digits of a number,
+prefixing them with zeroes if necessary.
+*/
+static void
+str_builder_put_dec_fixed_width_u64(StrBuilder* b, u64 x, uint w) {
+    span_u8 tail = str_builder_reserve(b, w);
+    if (tail.len == 0) {
+        return;
+    }
+    unsafe_fmt_dec_fixed_width_u64(tail, x, w);
+    str_builder_commit(b, w);
+}
+
+static void
+str_builder_put_hex_u64(StrBuilder* b, u64 x) {
+    span_u8 tail = str_builder_reserve(b, max_u64_hex_length);
+    if (tail.len == 0) {
+        return;
+    }
+    str_builder_commit(b, unsafe_fmt_hex_u64(tail, x));
+}
+
+static void
+str_builder_put_hex_prefix_zeroes_u64(StrBuilder* b, u64 x) {
+    span_u8 tail = str_builder_reserve(b, max_u64_hex_length);
+    if (tail.len == 0) {
+        return;
+    }
+    unsafe_fmt_hex_prefix_zeroes_u64(tail, x);
+    str_builder_commit(b, max_u64_hex_length);
+}
+
+static void
+str_builder_put_hex_prefix_zeroes_u32(StrBuilder* b, u32 x) {
+    span_u8 tail = str_builder_reserve(b, max_u32_hex_length);
+    if (tail.len == 0) {
+        return;
+    }
+    unsafe_fmt_hex_prefix_zeroes_u32(tail, x);
+    str_builder_commit(b, max_u32_hex_length);
+}
+
+static void
+str_builder_put_hex_byte(StrBuilder* b, u8 x) {
+    span_u8 tail = str_builder_reserve(b, 2);
+    if (tail.len == 0) {
+        return;
+    }
+    unsafe_fmt_hex_byte(tail, x);
+    str_builder_commit(b, 2);
+}
+
+static void
+str_builder_put_bin_byte(StrBuilder* b, u8 x) {
+    span_u8 tail = str_builder_reserve(b, 8);
+    if (tail.len == 0) {
+        return;
+    }
+    unsafe_fmt_bin_byte(tail, x);
+    str_builder_commit(b, 8);
+}
+
+static void
+str_builder_put_f64(StrBuilder* b, f64 x) {
+    span_u8 tail = str_builder_reserve(b, max_float_dec_length);
+    if (tail.len == 0) {
+        return;
+    }
+    str_builder_commit(b, unsafe_fmt_f64(tail, x));
+}
+
+static void
+str_builder_put_f32(StrBuilder* b, f32 x) {
+    span_u8 tail = str_builder_reserve(b, max_float_dec_length);
+    if (tail.len == 0) {
+        return;
+    }
+    str_builder_commit(b, unsafe_fmt_f32(tail, x));
+}
+
+/*/doc
+
+Copies built text into contiguous buffer. Returns number of bytes copied,
+which is less than builder length if buffer is too small.
+*/
+static uint
+str_builder_copy(StrBuilder* b, span_u8 buf) {
+    uint n = 0;
+    for (StrBuilderChunk* c = b->head; c != nil && n < buf.len; c = c->next) {
+        const uint k = min_uint(c->len, buf.len - n);
+        if (k != 0) {
+            unsafe_copy(buf.ptr + n, str_builder_chunk_data(c), k);
+        }
+        n += k;
+    }
+    return n;
+}
+
+/*/doc
+
+Writes built text into file with vectored writes, one buffer per chunk.
+Builder is not modified.
+*/
+static RetWrite
+str_builder_write_fd(StrBuilder* b, uint fd) {
+    str iov[64];
+    RetWrite ret = {};
+
+    if (fd == OS_LINUX_STDOUT || fd == OS_LINUX_STDERR) {
+        // keep order with buffered print output
+        os_stdio_flush();
+    }
+
+    StrBuilderChunk* c = b->head;
+    while (c != nil) {
+        uint k = 0;
+        for (; c != nil && k < array_len(iov); c = c->next) {
+            if (c->len != 0) {
+                iov[k] = str_builder_chunk_head(c);
+                k += 1;
+            }
+        }
+
+        RetWrite w = os_linux_write_vec_all(fd, make_span_str(iov, k));
+        ret.count += w.count;
+        if (w.code != 0) {
+            ret.code = w.code;
+            return ret;
+        }
+    }
+    return ret;
+}
+
+/*/doc
+
+Clears built text, but keeps allocated chunks for reuse.
+*/
+static void
+str_builder_reset(StrBuilder* b) {
+    for (StrBuilderChunk* c = b->head; c != nil; c = c->next) {
+        c->len = 0;
+    }
+    b->tail = b->head;
+    b->len = 0;
+}
+
+/*/doc
+
+Returns all chunks to allocator. Builder can be used again after that.
+*/
+static void
+str_builder_free(StrBuilder* b) {
+    StrBuilderChunk* c = b->head;
+    while (c != nil) {
+        StrBuilderChunk* next = c->next;
+        mem_free(b->al, c->block);
+        c = next;
+    }
+    b->head = nil;
+    b->tail = nil;
+    b->len = 0;
+}
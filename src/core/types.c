@@ -61,8 +61,22 @@ typedef uint pint;
 
 #define panic(s) panic_origin(s, SOURCE_ORIGIN)
 
+static void
+os_stdio_flush(void);
+
+// Set by the first panic, so that failure during flush does not flush again.
+static bool panic_trap_flushing = false;
+
+/*/doc
+
+Flushes buffered standard output and error streams and terminates
+process with trap instruction.
+*/
 _Noreturn static void
 panic_trap(void) {
+	if (!__atomic_exchange_n(&panic_trap_flushing, true, __ATOMIC_ACQ_REL)) {
+		os_stdio_flush();
+	}
 	__builtin_trap();
 	__builtin_unreachable();
 }
@@ -386,15 +400,26 @@ str_has_prefix(str s, str prefix) {
 	return str_equal(str_slice_head(s, prefix.len), prefix);
 }
 
+#define DJB2_HASH64_SEED 5381 // magic number
+
+/*/doc
+
+Continues hash {h} over more data. Hash of concatenated portions
+equals hash of the whole, starting from DJB2_HASH64_SEED.
+*/
 static u64
-djb2_hash64(span_u8 s) {
-    u64 h = 5381; // magic number
+djb2_hash64_update(u64 h, span_u8 s) {
     for (uint i = 0; i < s.len; i += 1) {
         h = ((h << 5) + h) + cast(u64, s.ptr[i]);
     }
     return h;
 }
 
+static u64
+djb2_hash64(span_u8 s) {
+    return djb2_hash64_update(DJB2_HASH64_SEED, s);
+}
+
 typedef struct {
 	str* ptr;
 	uint len;
@@ -429,6 +454,57 @@ make_span_u64(u64* ptr, uint len) {
     return s;
 }
 
+typedef struct {
+	u32* ptr;
+	uint len;
+} span_u32;
+
+static span_u32
+make_span_u32(u32* ptr, uint len) {
+    span_u32 s = {};
+	if (len == 0) {
+		return s;
+	}
+
+    s.ptr = ptr;
+    s.len = len;
+    return s;
+}
+
+typedef struct {
+	f32* ptr;
+	uint len;
+} span_f32;
+
+static span_f32
+make_span_f32(f32* ptr, uint len) {
+    span_f32 s = {};
+	if (len == 0) {
+		return s;
+	}
+
+    s.ptr = ptr;
+    s.len = len;
+    return s;
+}
+
+typedef struct {
+	f64* ptr;
+	uint len;
+} span_f64;
+
+static span_f64
+make_span_f64(f64* ptr, uint len) {
+    span_f64 s = {};
+	if (len == 0) {
+		return s;
+	}
+
+    s.ptr = ptr;
+    s.len = len;
+    return s;
+}
+
 typedef struct {
 	uint* ptr;
 	uint  len;
@@ -566,6 +642,29 @@ const uint max_u64_hex_length = 16;
 
 /*/doc
 
+Converts u32 integer into 8 hexadecimal digit characters packed into u64,
+most significant digit goes into the lowest byte. Thus storing result
+to memory (little endian) produces digits in reading order.
+
+Nibbles are spread into separate bytes with shifts and masks, then all
+of them are converted to characters at once: bytes with values above 9
+get an extra offset which moves them into letters range.
+*/
+static u64
+fmt_hex_8_digits(u32 x) {
+	u64 t = x;
+	t = (t | (t << 16)) & 0x0000FFFF0000FFFFULL;
+	t = (t | (t << 8)) & 0x00FF00FF00FF00FFULL;
+	t = (t | (t << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	t = __builtin_bswap64(t);
+
+	// high nibble of (t + 6) is 1 only for bytes which hold values above 9
+	const u64 letters = ((t + 0x0606060606060606ULL) >> 4) & 0x0101010101010101ULL;
+	return t + 0x3030303030303030ULL + letters * (cast(u64, 'A') - '0' - 10);
+}
+
+/*/doc
+
 Formats a given u64 integer as a hexadecimal number of
 fixed width (=16) format, prefixing significant digits with
 zeroes if necessary. Buffer must be at least 16 bytes
@@ -573,14 +672,10 @@ long.
 */
 static void
 unsafe_fmt_hex_prefix_zeroes_u64(span_u8 buf, u64 x) {
-	uint i = max_u64_hex_length;
-	// digits are written from least to most significant bit
-	while (i != 0) {
-		i -= 1;
-		const u8 n = cast(u8, x & 0xF);
-		buf.ptr[i] = fmt_hex_digit(n);
-		x = x >> 4;
-	}
+	const u64 hi = fmt_hex_8_digits(cast(u32, x >> 32));
+	const u64 lo = fmt_hex_8_digits(cast(u32, x));
+	__builtin_memcpy(buf.ptr, &hi, 8);
+	__builtin_memcpy(buf.ptr + 8, &lo, 8);
 }
 
 /*/doc
@@ -610,14 +705,8 @@ long.
 */
 static void
 unsafe_fmt_hex_prefix_zeroes_u32(span_u8 buf, u32 x) {
-	uint i = max_u32_hex_length;
-	// digits are written from least to most significant bit
-	while (i != 0) {
-		i -= 1;
-		const u8 n = cast(u8, x & 0xF);
-		buf.ptr[i] = fmt_hex_digit(n);
-		x = x >> 4;
-	}
+	const u64 digits = fmt_hex_8_digits(x);
+	__builtin_memcpy(buf.ptr, &digits, 8);
 }
 
 /*/doc
@@ -668,26 +757,165 @@ Maximum number of bytes (digits) needed to format any u64 integer as decimal num
 static const uint
 max_u64_dec_length = 20;
 
+/*/doc
+
+Decimal representations of all numbers in range [0, 99], two characters each.
+Formatting with this table needs one division per two digits.
+*/
+static const u8 fmt_dec_digit_pairs[200] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// Element t holds the smallest number with t + 1 decimal digits (10^t),
+// except for the first one, which is 0 to treat 0 as having one digit.
+static const u64 fmt_dec_len_thresholds[20] = {
+	0,
+	10,
+	100,
+	1000,
+	10000,
+	100000,
+	1000000,
+	10000000,
+	100000000,
+	1000000000,
+	10000000000ULL,
+	100000000000ULL,
+	1000000000000ULL,
+	10000000000000ULL,
+	100000000000000ULL,
+	1000000000000000ULL,
+	10000000000000000ULL,
+	100000000000000000ULL,
+	1000000000000000000ULL,
+	10000000000000000000ULL,
+};
+
+/*/doc
+
+Returns number of decimal digits in a given integer. Zero has one digit.
+
+Number of significant bits gives an estimate t = floor(bits * log10(2)),
+(1233 / 4096 approximates log10(2)). Actual number of digits is
+either t or t + 1, one comparison selects between them.
+*/
+static uint
+fmt_dec_len_u64(u64 x) {
+	const uint bits = 64 - cast(uint, __builtin_clzl(x | 1));
+	const uint t = (bits * 1233) >> 12;
+	return t + (x >= fmt_dec_len_thresholds[t] ? 1 : 0);
+}
+
+/*/doc
+
+Writes exactly n decimal digits of a number, ending right before {ptr[n]}.
+Digits are produced two at a time from the end. Number must have
+at most n digits, zeroes are prefixed if it has fewer.
+*/
+static void
+unsafe_fmt_dec_digits_backward(u8* ptr, u64 x, uint n) {
+	// 8 digits at a time, so that the rest is done in 32-bit arithmetic
+	while (n >= 8) {
+		u32 y = cast(u32, x % 100000000);
+		x /= 100000000;
+		n -= 8;
+
+		for (uint j = 0; j < 4; j += 1) {
+			__builtin_memcpy(ptr + n + 6 - 2 * j, fmt_dec_digit_pairs + 2 * (y % 100), 2);
+			y /= 100;
+		}
+	}
+
+	u32 y = cast(u32, x);
+	while (n >= 2) {
+		n -= 2;
+		__builtin_memcpy(ptr + n, fmt_dec_digit_pairs + 2 * (y % 100), 2);
+		y /= 100;
+	}
+	if (n != 0) {
+		ptr[0] = fmt_dec_digit(cast(u8, y % 10));
+	}
+}
+
+/*/doc
+
+Converts integer in range [0, 10^8) into 8 decimal digit characters
+packed into u64, most significant digit goes into the lowest byte.
+Leading zeroes are included.
+
+Number is split into halves of 4 digits, then each half into 2 digit
+numbers and those into single digits. Division by a small constant is
+replaced with multiplication by its scaled reciprocal, which is exact
+for the range of values in each step. All parts are processed at once
+inside lanes of u64.
+*/
+static u64
+fmt_dec_8_digits(u32 x) {
+	// two 32-bit lanes hold numbers below 10^4
+	u64 t = (x / 10000) | (cast(u64, x % 10000) << 32);
+
+	// floor(v / 100) = (v * 10486) >> 20 for v < 10^4
+	u64 q = ((t * 10486) >> 20) & 0x0000007F0000007FULL;
+	t = q | ((t - 100 * q) << 16);
+
+	// floor(v / 10) = (v * 103) >> 10 for v < 100
+	q = ((t * 103) >> 10) & 0x000F000F000F000FULL;
+	t = q | ((t - 10 * q) << 8);
+
+	return t + 0x3030303030303030ULL;
+}
+
+/*/doc
+
+Stores k (in range [1, 8]) last digits from a result of
+{fmt_dec_8_digits(...)} or {fmt_hex_8_digits(...)}. Always writes
+8 bytes, bytes after digits are set to zero.
+*/
+static void
+unsafe_fmt_put_8_digits_tail(u8* ptr, u64 digits, uint k) {
+	const u64 d = digits >> (8 * (8 - k));
+	__builtin_memcpy(ptr, &d, 8);
+}
+
 /*
 Same as fmt_dec_u64, but has no buffer boundary checks.
+
+Digits are produced by groups of 8 without loops. Numbers below 10^8
+(most common case) need single group.
+
+Buffer must be at least {max_u64_dec_length} (=20) bytes long, even if
+number is shorter. Digits are stored with 8-byte writes, bytes after
+the last digit are overwritten.
 */
 static uint
 unsafe_fmt_dec_u64(span_u8 buf, u64 x) {
-	u8 digits[max_u64_dec_length];
-	const uint n = unsafe_fmt_reverse_dec_u64(digits, x);
-	unsafe_reverse_copy(buf.ptr, digits, n);
-	return n;
-}
+	const uint n = fmt_dec_len_u64(x);
+	if (n <= 8) {
+		unsafe_fmt_put_8_digits_tail(buf.ptr, fmt_dec_8_digits(cast(u32, x)), n);
+		return n;
+	}
 
-static void
-unsafe_fmt_reverse_dec_fixed_width_u64(u8* ptr, u64 x, uint w) {
-	uint i = 0;
-	while (i < w) {
-		const u8 n = cast(u8, x % 10);
-		x /= 10;
-		ptr[i] = fmt_dec_digit(n);
-		i += 1;
+	const u64 lo = fmt_dec_8_digits(cast(u32, x % 100000000));
+	x /= 100000000;
+	if (n <= 16) {
+		unsafe_fmt_put_8_digits_tail(buf.ptr, fmt_dec_8_digits(cast(u32, x)), n - 8);
+		__builtin_memcpy(buf.ptr + n - 8, &lo, 8);
+		return n;
 	}
+
+	const u64 mid = fmt_dec_8_digits(cast(u32, x % 100000000));
+	unsafe_fmt_put_8_digits_tail(buf.ptr, fmt_dec_8_digits(cast(u32, x / 100000000)), n - 16);
+	__builtin_memcpy(buf.ptr + n - 16, &mid, 8);
+	__builtin_memcpy(buf.ptr + n - 8, &lo, 8);
+	return n;
 }
 
 /*/doc
@@ -699,9 +927,13 @@ than only least significant ones will be written.
 */
 static void
 unsafe_fmt_dec_fixed_width_u64(span_u8 buf, u64 x, uint w) {
-	u8 digits[max_u64_dec_length];
-	unsafe_fmt_reverse_dec_fixed_width_u64(digits, x, w);
-	unsafe_reverse_copy(buf.ptr, digits, w);
+	if (w == 0) {
+		return;
+	}
+	if (w < max_u64_dec_length) {
+		x %= fmt_dec_len_thresholds[w];
+	}
+	unsafe_fmt_dec_digits_backward(buf.ptr, x, w);
 }
 
 /*/doc
@@ -711,6 +943,11 @@ Maximum number of bytes (digits) needed to format any u64 integer as decimal num
 static const uint
 max_s64_dec_length = max_u64_dec_length + 1;
 
+/*/doc
+
+Buffer must be at least {max_s64_dec_length} (=21) bytes long, see
+{unsafe_fmt_dec_u64(...)}.
+*/
 static uint
 unsafe_fmt_dec_s64(span_u8 buf, s64 x) {
 	if (x >= 0) {
@@ -718,7 +955,8 @@ unsafe_fmt_dec_s64(span_u8 buf, s64 x) {
 	}
 
 	buf.ptr[0] = '-';
-	uint n = unsafe_fmt_dec_u64(span_u8_slice_tail(buf, 1), cast(u64, -x));
+	// negation in unsigned arithmetic is defined for minimal s64 as well
+	uint n = unsafe_fmt_dec_u64(span_u8_slice_tail(buf, 1), 0 - cast(u64, x));
 	return n + 1;
 }
 
@@ -734,20 +972,19 @@ fmt_dec_u64(span_u8 buf, u64 x) {
 		return 0;
 	}
 	must(buf.ptr != nil);
-	
+
 	if (buf.len >= max_u64_dec_length) {
 		return unsafe_fmt_dec_u64(buf, x);
 	}
-	
-	u8 digits[max_u64_dec_length];
-	const uint len = unsafe_fmt_reverse_dec_u64(digits, x);
-	if (len > buf.len) {
+
+	const uint n = fmt_dec_len_u64(x);
+	if (n > buf.len) {
 		// Not enough space in buffer to represent integer.
 		return 0;
 	}
 
-	unsafe_reverse_copy(buf.ptr, digits, len);
-	return len;
+	unsafe_fmt_dec_digits_backward(buf.ptr, x, n);
+	return n;
 }
 
 static uint
@@ -760,7 +997,7 @@ fmt_dec_s64(span_u8 buf, s64 x) {
 		return 0;
 	}
 
-	const uint n = fmt_dec_u64(span_u8_slice_tail(buf, 1), cast(u64, -x));
+	const uint n = fmt_dec_u64(span_u8_slice_tail(buf, 1), 0 - cast(u64, x));
 	if (n == 0) {
 		return 0;
 	}
@@ -768,6 +1005,54 @@ fmt_dec_s64(span_u8 buf, s64 x) {
 	return n + 1;
 }
 
+/*/doc
+
+Returns number of hexadecimal digits in a given integer
+without leading zeroes. Zero has one digit.
+*/
+static uint
+fmt_hex_len_u64(u64 x) {
+	const uint bits = 64 - cast(uint, __builtin_clzl(x | 1));
+	return (bits + 3) >> 2;
+}
+
+/*/doc
+
+Formats integer as hexadecimal number without leading zeroes.
+Returns number of bytes written.
+
+Buffer must be at least {max_u64_hex_length} (=16) bytes long, even if
+number is shorter. Digits are stored with 8-byte writes, bytes after
+the last digit are overwritten.
+*/
+static uint
+unsafe_fmt_hex_u64(span_u8 buf, u64 x) {
+	const uint n = fmt_hex_len_u64(x);
+	const u64 lo = fmt_hex_8_digits(cast(u32, x));
+	if (n <= 8) {
+		unsafe_fmt_put_8_digits_tail(buf.ptr, lo, n);
+		return n;
+	}
+
+	unsafe_fmt_put_8_digits_tail(buf.ptr, fmt_hex_8_digits(cast(u32, x >> 32)), n - 8);
+	__builtin_memcpy(buf.ptr + n - 8, &lo, 8);
+	return n;
+}
+
+/*/doc
+
+Writes exactly n hexadecimal digits of a number, ending right before {ptr[n]}.
+Number must have at most n digits, zeroes are prefixed if it has fewer.
+*/
+static void
+unsafe_fmt_hex_digits_backward(u8* ptr, u64 x, uint n) {
+	while (n != 0) {
+		n -= 1;
+		ptr[n] = fmt_hex_digit(cast(u8, x & 0xF));
+		x >>= 4;
+	}
+}
+
 static const uint
 max_time_dur_micro_length = max_s64_dec_length + 1 + 6;
 
@@ -906,9 +1191,62 @@ unsafe_fmt_buffer_put_hex_span_u8(FormatBuffer* buf, span_u8 s) {
 	}
 }
 
+/*/doc
+
+Near the end of buffer digits are written one by one, because
+{unsafe_fmt_dec_u64(...)} stores may go past the written number.
+*/
 static void
 unsafe_fmt_buffer_put_dec_u64(FormatBuffer* buf, u64 x) {
-	const uint n = unsafe_fmt_dec_u64(fmt_buffer_tail(buf), x);
+	span_u8 tail = fmt_buffer_tail(buf);
+	if (tail.len >= max_u64_dec_length) {
+		buf->len += unsafe_fmt_dec_u64(tail, x);
+		return;
+	}
+
+	const uint n = fmt_dec_len_u64(x);
+	must(n <= tail.len);
+	unsafe_fmt_dec_digits_backward(tail.ptr, x, n);
+	buf->len += n;
+}
+
+static void
+unsafe_fmt_buffer_put_dec_s64(FormatBuffer* buf, s64 x) {
+	if (x >= 0) {
+		unsafe_fmt_buffer_put_dec_u64(buf, cast(u64, x));
+		return;
+	}
+
+	unsafe_fmt_buffer_put_byte(buf, '-');
+	// negation in unsigned arithmetic is defined for minimal s64 as well
+	unsafe_fmt_buffer_put_dec_u64(buf, 0 - cast(u64, x));
+}
+
+/*/doc
+
+Puts exactly w least significant decimal digits of a number,
+prefixing them with zeroes if necessary.
+*/
+static void
+unsafe_fmt_buffer_put_dec_fixed_width_u64(FormatBuffer* buf, u64 x, uint w) {
+	span_u8 tail = fmt_buffer_tail(buf);
+	must(tail.len >= w);
+
+	unsafe_fmt_dec_fixed_width_u64(tail, x, w);
+	buf->len += w;
+}
+
+static void
+unsafe_fmt_buffer_put_hex_u64(FormatBuffer* buf, u64 x) {
+	span_u8 tail = fmt_buffer_tail(buf);
+	if (tail.len >= max_u64_hex_length) {
+		buf->len += unsafe_fmt_hex_u64(tail, x);
+		return;
+	}
+
+	const uint n = fmt_hex_len_u64(x);
+	must(n <= tail.len);
+	unsafe_fmt_hex_digits_backward(tail.ptr, x, n);
 	buf->len += n;
 }
 
@@ -0,0 +1,239 @@
+/*
+Streaming transforms over bag readers and writers. Wrappers compute
+checksum or hash and count bytes of data passing through them, so that
+a single {bag_copy(...)} pass can copy, checksum and count.
+
+Requires "crc.c" to be included before and {init_crc_table()} to be
+called before CRC digests are used.
+*/
+
+// Only count bytes.
+#define DIGEST_KIND_COUNT 0
+
+// IEEE CRC-32, same as produced by {crc_digest(...)}.
+#define DIGEST_KIND_CRC32 1
+
+// 64-bit hash, same as produced by {djb2_hash64(...)}.
+#define DIGEST_KIND_DJB2 2
+
+#define DIGEST_NUM_KINDS 3
+
+/*/doc
+
+Running checksum or hash of data stream.
+*/
+typedef struct {
+    // Current checksum or hash value.
+    u64 sum;
+
+    // Number of bytes digested so far.
+    u64 count;
+
+    uint kind;
+} Digest;
+
+static void
+init_digest(Digest* d, uint kind) {
+    must(kind < DIGEST_NUM_KINDS);
+
+    d->kind = kind;
+    d->count = 0;
+    d->sum = kind == DIGEST_KIND_DJB2 ? DJB2_HASH64_SEED : 0;
+}
+
+static void
+digest_update(Digest* d, span_u8 s) {
+    d->count += s.len;
+    switch (d->kind) {
+    case DIGEST_KIND_COUNT:
+        break;
+    case DIGEST_KIND_CRC32:
+        d->sum = crc_digest(cast(u32, d->sum), s);
+        break;
+    case DIGEST_KIND_DJB2:
+        d->sum = djb2_hash64_update(d->sum, s);
+        break;
+    default:
+        panic_trap();
+    }
+}
+
+/*/doc
+
+Reader which digests all data read from underlying reader. Supports
+borrowing if underlying reader does, borrowed data is digested when
+it is consumed.
+
+Related:
+    +init_digest_reader(...)
+    .bag_digest_reader(...)
+*/
+typedef struct {
+    Reader reader;
+
+    Digest digest;
+
+    // Data returned by last borrow from underlying reader.
+    span_u8 borrowed;
+} DigestReader;
+
+static void
+init_digest_reader(DigestReader* r, Reader reader, uint kind) {
+    r->reader = reader;
+    r->borrowed = make_span_u8(nil, 0);
+    init_digest(&r->digest, kind);
+}
+
+static RetRead
+digest_reader_read(DigestReader* r, span_u8 s) {
+    RetRead ret = r->reader.tab->read(cast(void*, r->reader.obj), s);
+    digest_update(&r->digest, span_u8_slice_head(s, ret.count));
+    return ret;
+}
+
+static RetBorrow
+digest_reader_fill_buf(DigestReader* r) {
+    RetBorrow ret = r->reader.tab->fill_buf(cast(void*, r->reader.obj));
+    r->borrowed = ret.data;
+    return ret;
+}
+
+static void
+digest_reader_consume(DigestReader* r, uint n) {
+    digest_update(&r->digest, span_u8_slice_head(r->borrowed, n));
+    r->borrowed = span_u8_slice_tail(r->borrowed, n);
+    r->reader.tab->consume(cast(void*, r->reader.obj), n);
+}
+
+const BagReaderTab digest_reader_bag_reader_tab = {
+    .type_id = 11,
+    .read = cast(BagFuncRead, digest_reader_read),
+    .fill_buf = cast(BagFuncFillBuf, digest_reader_fill_buf),
+    .consume = cast(BagFuncConsume, digest_reader_consume),
+};
+
+// Used when underlying reader does not support borrowing.
+const BagReaderTab digest_reader_copy_bag_reader_tab = {
+    .type_id = 11,
+    .read = cast(BagFuncRead, digest_reader_read),
+};
+
+static Reader
+bag_digest_reader(DigestReader* r) {
+    must(r != nil);
+
+    Reader reader = {};
+    reader.obj = cast(uint, r);
+    if (r->reader.tab->fill_buf != nil) {
+        reader.tab = &digest_reader_bag_reader_tab;
+    } else {
+        reader.tab = &digest_reader_copy_bag_reader_tab;
+    }
+    return reader;
+}
+
+/*/doc
+
+Writer which digests data accepted by underlying writer. Without
+underlying writer it accepts and digests everything, acting as a sink.
+
+Related:
+    +init_digest_writer(...)
+    +init_digest_sink(...)
+    .bag_digest_writer(...)
+*/
+typedef struct {
+    Writer writer;
+
+    Digest digest;
+
+    // Discard data after digesting it.
+    bool sink;
+} DigestWriter;
+
+static void
+init_digest_writer(DigestWriter* w, Writer writer, uint kind) {
+    w->writer = writer;
+    w->sink = false;
+    init_digest(&w->digest, kind);
+}
+
+static void
+init_digest_sink(DigestWriter* w, uint kind) {
+    w->writer = (Writer){};
+    w->sink = true;
+    init_digest(&w->digest, kind);
+}
+
+static RetWrite
+digest_writer_write(DigestWriter* w, span_u8 s) {
+    RetWrite ret = {};
+    if (w->sink) {
+        ret.count = s.len;
+    } else {
+        ret = w->writer.tab->write(cast(void*, w->writer.obj), s);
+    }
+    digest_update(&w->digest, span_u8_slice_head(s, ret.count));
+    return ret;
+}
+
+const BagWriterTab digest_writer_bag_writer_tab = {
+    .type_id = 12,
+    .write = cast(BagFuncWrite, digest_writer_write),
+};
+
+static Writer
+bag_digest_writer(DigestWriter* w) {
+    must(w != nil);
+
+    Writer writer = {};
+    writer.obj = cast(uint, w);
+    writer.tab = &digest_writer_bag_writer_tab;
+    return writer;
+}
+
+/*/doc
+
+Writer which duplicates data into two writers. Primary writer decides
+how much data is accepted, exactly that data is then fully written into
+secondary writer.
+
+Related:
+    +init_tee_writer(...)
+    .bag_tee_writer(...)
+*/
+typedef struct {
+    Writer primary;
+    Writer secondary;
+} TeeWriter;
+
+static void
+init_tee_writer(TeeWriter* w, Writer primary, Writer secondary) {
+    w->primary = primary;
+    w->secondary = secondary;
+}
+
+static RetWrite
+tee_writer_write(TeeWriter* w, span_u8 s) {
+    RetWrite ret = w->primary.tab->write(cast(void*, w->primary.obj), s);
+    RetWrite t = bag_write_all(w->secondary, span_u8_slice_head(s, ret.count));
+    if (ret.code == 0) {
+        ret.code = t.code;
+    }
+    return ret;
+}
+
+const BagWriterTab tee_writer_bag_writer_tab = {
+    .type_id = 13,
+    .write = cast(BagFuncWrite, tee_writer_write),
+};
+
+static Writer
+bag_tee_writer(TeeWriter* w) {
+    must(w != nil);
+
+    Writer writer = {};
+    writer.obj = cast(uint, w);
+    writer.tab = &tee_writer_bag_writer_tab;
+    return writer;
+}
@@ -0,0 +1,620 @@
+/*
+Hex and base64 encoding and decoding of byte spans, and hexdump formatter
+for bulk binary data.
+
+Bulk of the work is done by kernels which process 16 bytes at a time with
+SSSE3 byte shuffles. Kernels are selected at runtime, scalar code handles
+short tails and CPUs without SSSE3.
+*/
+
+#define ERROR_BAD_HEX_FORMAT    6
+#define ERROR_BAD_BASE64_FORMAT 7
+
+typedef struct {
+    // Number of bytes written into output.
+    //
+    // On error bytes decoded before bad input remain in output.
+    uint len;
+
+    ErrorCode code;
+} RetDecode;
+
+static const u8
+encoding_hex_digits[16] = "0123456789ABCDEF";
+
+// Byte shuffle index which produces zero in destination lane.
+#define ENCODING_SHUFFLE_ZERO 0x80
+
+static uint
+hex_encoded_len(uint n) {
+    return 2 * n;
+}
+
+static void
+hex_encode_base(u8* dst, const u8* src, uint n) {
+    for (uint i = 0; i < n; i += 1) {
+        const u8 x = src[i];
+        dst[2 * i] = encoding_hex_digits[x >> 4];
+        dst[2 * i + 1] = encoding_hex_digits[x & 0xF];
+    }
+}
+
+/*/doc
+
+Converts each byte into two hex digits. Digits of lower half bytes
+go into first result, digits of upper half bytes into second one.
+*/
+TARGET_SSSE3 static void
+hex_encode_ssse3_16(vec16_char* lo, vec16_char* hi, vec16_u8 v) {
+    const vec16_char digits = {
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+    };
+    const vec16_char h = __builtin_ia32_pshufb128(digits, cast(vec16_char, (v >> 4) & 0xF));
+    const vec16_char l = __builtin_ia32_pshufb128(digits, cast(vec16_char, v & 0xF));
+    *lo = __builtin_ia32_punpcklbw128(h, l);
+    *hi = __builtin_ia32_punpckhbw128(h, l);
+}
+
+/*/doc
+
+Encodes whole 16-byte blocks. Returns number of input bytes consumed.
+*/
+TARGET_SSSE3 static uint
+hex_encode_ssse3(u8* dst, const u8* src, uint n) {
+    uint i = 0;
+    for (; n - i >= 16; i += 16) {
+        vec16_u8 v;
+        simd_load(v, src + i);
+
+        vec16_char lo;
+        vec16_char hi;
+        hex_encode_ssse3_16(&lo, &hi, v);
+        simd_store(dst + 2 * i, lo);
+        simd_store(dst + 2 * i + 16, hi);
+    }
+    return i;
+}
+
+/*/doc
+
+Writes two uppercase hex digits for each byte of source span without
+separators. Buffer must have at least {hex_encoded_len(...)} bytes.
+Returns number of bytes written.
+*/
+static uint
+unsafe_hex_encode(span_u8 buf, span_u8 src) {
+    uint i = 0;
+    if (cpu_has_feature(CPU_FEATURE_SSSE3)) {
+        i = hex_encode_ssse3(buf.ptr, src.ptr, src.len);
+    }
+    hex_encode_base(buf.ptr + 2 * i, src.ptr + i, src.len - i);
+    return 2 * src.len;
+}
+
+/*/doc
+
+Same as {unsafe_hex_encode(...)}, but checks buffer length.
+Returns 0 and writes nothing if encoded text does not fit.
+*/
+static uint
+hex_encode(span_u8 buf, span_u8 src) {
+    if (buf.len < hex_encoded_len(src.len)) {
+        return 0;
+    }
+    return unsafe_hex_encode(buf, src);
+}
+
+// Returns value of hex digit (any case) or 0xFF for other characters.
+static u8
+hex_digit_value(u8 c) {
+    const u8 d = c - '0';
+    if (d <= 9) {
+        return d;
+    }
+    const u8 x = (c | 0x20) - 'a';
+    if (x <= 5) {
+        return x + 10;
+    }
+    return 0xFF;
+}
+
+/*/doc
+
+Converts 16 hex digit characters into their values. Lanes with other
+characters are marked in bad mask.
+*/
+TARGET_SSSE3 static vec16_u8
+hex_decode_ssse3_values(vec16_u8 v, vec16_u8* bad) {
+    const vec16_u8 d = v - '0';
+    const vec16_u8 x = (v | 0x20) - 'a';
+    const vec16_u8 is_dec = cast(vec16_u8, d <= 9);
+    const vec16_u8 is_alpha = cast(vec16_u8, x <= 5);
+    *bad |= ~(is_dec | is_alpha);
+    return (d & is_dec) | ((x + 10) & is_alpha);
+}
+
+/*/doc
+
+Decodes whole 32-character blocks. Stops at first block which contains
+non-digit character. Returns number of input characters consumed.
+*/
+TARGET_SSSE3 static uint
+hex_decode_ssse3(u8* dst, const u8* src, uint n) {
+    const vec16_char weights = {16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1};
+
+    uint i = 0;
+    for (; n - i >= 32; i += 32) {
+        vec16_u8 a;
+        vec16_u8 b;
+        simd_load(a, src + i);
+        simd_load(b, src + i + 16);
+
+        vec16_u8 bad = {};
+        a = hex_decode_ssse3_values(a, &bad);
+        b = hex_decode_ssse3_values(b, &bad);
+        if (__builtin_ia32_pmovmskb128(cast(vec16_char, bad)) != 0) {
+            break;
+        }
+
+        const vec8_s16 pa = __builtin_ia32_pmaddubsw128(cast(vec16_char, a), weights);
+        const vec8_s16 pb = __builtin_ia32_pmaddubsw128(cast(vec16_char, b), weights);
+        const vec16_char out = __builtin_ia32_packuswb128(pa, pb);
+        simd_store(dst + i / 2, out);
+    }
+    return i;
+}
+
+/*/doc
+
+Decodes pairs of hex digits (any case) into bytes. Buffer must have
+at least half of text length bytes. Text of odd length is an error
+reported after all complete pairs are decoded.
+*/
+static RetDecode
+hex_decode(span_u8 buf, str s) {
+    must(buf.len >= s.len / 2);
+
+    RetDecode ret = {};
+    uint i = 0;
+    if (cpu_has_feature(CPU_FEATURE_SSSE3)) {
+        i = hex_decode_ssse3(buf.ptr, s.ptr, s.len);
+    }
+    for (; s.len - i >= 2; i += 2) {
+        const u8 h = hex_digit_value(s.ptr[i]);
+        const u8 l = hex_digit_value(s.ptr[i + 1]);
+        if ((h | l) == 0xFF) {
+            ret.len = i / 2;
+            ret.code = ERROR_BAD_HEX_FORMAT;
+            return ret;
+        }
+        buf.ptr[i / 2] = (h << 4) | l;
+    }
+
+    ret.len = i / 2;
+    if (i != s.len) {
+        ret.code = ERROR_BAD_HEX_FORMAT;
+    }
+    return ret;
+}
+
+static const u8
+base64_alphabet[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Length of padded base64 text which encodes n bytes.
+static uint
+base64_encoded_len(uint n) {
+    return (n + 2) / 3 * 4;
+}
+
+// Maximum number of bytes encoded by base64 text of length n.
+static uint
+base64_decoded_max_len(uint n) {
+    return n / 4 * 3;
+}
+
+static void
+base64_encode_base(u8* dst, const u8* src, uint n) {
+    uint i = 0;
+    for (; n - i >= 3; i += 3) {
+        const u32 x = (cast(u32, src[i]) << 16) | (cast(u32, src[i + 1]) << 8) | src[i + 2];
+        dst[0] = base64_alphabet[x >> 18];
+        dst[1] = base64_alphabet[(x >> 12) & 0x3F];
+        dst[2] = base64_alphabet[(x >> 6) & 0x3F];
+        dst[3] = base64_alphabet[x & 0x3F];
+        dst += 4;
+    }
+
+    if (i == n) {
+        return;
+    }
+    u32 x = cast(u32, src[i]) << 16;
+    if (n - i == 2) {
+        x |= cast(u32, src[i + 1]) << 8;
+    }
+    dst[0] = base64_alphabet[x >> 18];
+    dst[1] = base64_alphabet[(x >> 12) & 0x3F];
+    dst[2] = n - i == 2 ? base64_alphabet[(x >> 6) & 0x3F] : '=';
+    dst[3] = '=';
+}
+
+/*/doc
+
+Encodes 12-byte blocks into 16 characters. Input is loaded 16 bytes
+at a time, thus last 4 bytes of input are never consumed by this kernel.
+Returns number of input bytes consumed.
+
+Bytes are spread into 6-bit groups with multiplications instead of
+per-lane shifts (scheme by Wojciech Muła), group values are then turned
+into characters by adding offset of their alphabet range.
+*/
+TARGET_SSSE3 static uint
+base64_encode_ssse3(u8* dst, const u8* src, uint n) {
+    const vec16_char spread = {1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10};
+    const vec8_s16 mul_hi = {0x40, 0x400, 0x40, 0x400, 0x40, 0x400, 0x40, 0x400};
+    const vec8_s16 mul_lo = {0x10, 0x100, 0x10, 0x100, 0x10, 0x100, 0x10, 0x100};
+
+    // offsets indexed by reduced group value, see below
+    const u8 digit = cast(u8, '0' - 52);
+    const vec16_char offsets = {
+        'a' - 26, digit, digit, digit, digit, digit, digit, digit,
+        digit, digit, digit, cast(u8, '+' - 62), cast(u8, '/' - 63), 'A', 0, 0,
+    };
+
+    uint i = 0;
+    uint j = 0;
+    for (; n - i >= 16; i += 12) {
+        vec16_u8 v;
+        simd_load(v, src + i);
+
+        const vec4_s32 in = cast(vec4_s32, __builtin_ia32_pshufb128(cast(vec16_char, v), spread));
+        const vec8_s16 t0 = cast(vec8_s16, in & 0x0FC0FC00);
+        const vec8_s16 t1 = __builtin_ia32_pmulhuw128(t0, mul_hi);
+        const vec8_s16 t2 = cast(vec8_s16, in & 0x003F03F0);
+        const vec8_s16 t3 = t2 * mul_lo;
+        const vec16_u8 g = cast(vec16_u8, t1 | t3);
+
+        // groups [0, 25] map to 13, [26, 51] to 0, [52, 63] to [1, 12]
+        vec16_u8 r = (g - 51) & cast(vec16_u8, g > 51);
+        r |= cast(vec16_u8, g < 26) & 13;
+        const vec16_u8 out = g + cast(vec16_u8, __builtin_ia32_pshufb128(offsets, cast(vec16_char, r)));
+        simd_store(dst + j, out);
+        j += 16;
+    }
+    return i;
+}
+
+/*/doc
+
+Writes standard base64 encoding of source span with padding.
+Buffer must have at least {base64_encoded_len(...)} bytes.
+Returns number of bytes written.
+*/
+static uint
+unsafe_base64_encode(span_u8 buf, span_u8 src) {
+    uint i = 0;
+    if (cpu_has_feature(CPU_FEATURE_SSSE3)) {
+        i = base64_encode_ssse3(buf.ptr, src.ptr, src.len);
+    }
+    base64_encode_base(buf.ptr + i / 3 * 4, src.ptr + i, src.len - i);
+    return base64_encoded_len(src.len);
+}
+
+/*/doc
+
+Same as {unsafe_base64_encode(...)}, but checks buffer length.
+Returns 0 and writes nothing if encoded text does not fit.
+*/
+static uint
+base64_encode(span_u8 buf, span_u8 src) {
+    if (buf.len < base64_encoded_len(src.len)) {
+        return 0;
+    }
+    return unsafe_base64_encode(buf, src);
+}
+
+// Returns value of base64 character or 0xFF for other characters.
+static u8
+base64_char_value(u8 c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    }
+    if (c == '+') {
+        return 62;
+    }
+    if (c == '/') {
+        return 63;
+    }
+    return 0xFF;
+}
+
+/*/doc
+
+Decodes 16-character blocks into 12 bytes, storing 16 bytes each time.
+Stops at first block which contains character outside of alphabet
+(padding included). Caller must leave at least 8 characters after
+consumed blocks, so that extra stored bytes fit into output.
+Returns number of input characters consumed.
+
+Characters are validated with two lookups by lower and upper nibble
+which share a bit only for invalid characters (scheme by Wojciech Muła
+and Daniel Lemire).
+*/
+TARGET_SSSE3 static uint
+base64_decode_ssse3(u8* dst, const u8* src, uint n) {
+    const vec16_char lut_lo = {
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+    };
+    const vec16_char lut_hi = {
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    };
+
+    // offsets indexed by upper nibble, '/' is moved to index 1
+    const u8 upper = cast(u8, -'A');
+    const u8 lower = cast(u8, 26 - 'a');
+    const vec16_char lut_roll = {0, 16, 19, 4, upper, upper, lower, lower, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    const vec16_char merge_pairs = {0x40, 1, 0x40, 1, 0x40, 1, 0x40, 1, 0x40, 1, 0x40, 1, 0x40, 1, 0x40, 1};
+    const vec8_s16 merge_quads = {0x1000, 1, 0x1000, 1, 0x1000, 1, 0x1000, 1};
+    const vec16_char pack = {
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+        ENCODING_SHUFFLE_ZERO, ENCODING_SHUFFLE_ZERO, ENCODING_SHUFFLE_ZERO, ENCODING_SHUFFLE_ZERO,
+    };
+
+    uint i = 0;
+    uint j = 0;
+    for (; n - i >= 24; i += 16) {
+        vec16_u8 v;
+        simd_load(v, src + i);
+
+        const vec16_char hi_nibbles = cast(vec16_char, (v >> 4) & 0xF);
+        const vec16_char lo_nibbles = cast(vec16_char, v & 0xF);
+        const vec16_u8 lo = cast(vec16_u8, __builtin_ia32_pshufb128(lut_lo, lo_nibbles));
+        const vec16_u8 hi = cast(vec16_u8, __builtin_ia32_pshufb128(lut_hi, hi_nibbles));
+        if (__builtin_ia32_pmovmskb128(cast(vec16_char, (lo & hi) != 0)) != 0) {
+            break;
+        }
+
+        const vec16_char is_slash = cast(vec16_char, v == '/');
+        const vec16_u8 roll = cast(vec16_u8, __builtin_ia32_pshufb128(lut_roll, hi_nibbles + is_slash));
+        const vec16_u8 values = v + roll;
+
+        const vec8_s16 pairs = __builtin_ia32_pmaddubsw128(cast(vec16_char, values), merge_pairs);
+        const vec4_s32 quads = __builtin_ia32_pmaddwd128(pairs, merge_quads);
+        const vec16_char out = __builtin_ia32_pshufb128(cast(vec16_char, quads), pack);
+        simd_store(dst + j, out);
+        j += 12;
+    }
+    return i;
+}
+
+/*/doc
+
+Decodes standard base64 text with padding. Text length must be a multiple
+of 4, padding characters may only appear at the end of last quad.
+Buffer must have at least {base64_decoded_max_len(...)} bytes.
+*/
+static RetDecode
+base64_decode(span_u8 buf, str s) {
+    must(buf.len >= base64_decoded_max_len(s.len));
+
+    RetDecode ret = {};
+    if (s.len % 4 != 0) {
+        ret.code = ERROR_BAD_BASE64_FORMAT;
+        return ret;
+    }
+
+    uint i = 0;
+    if (cpu_has_feature(CPU_FEATURE_SSSE3)) {
+        i = base64_decode_ssse3(buf.ptr, s.ptr, s.len);
+    }
+
+    uint j = i / 4 * 3;
+    for (; i < s.len; i += 4) {
+        const u8* p = s.ptr + i;
+        uint k = 4;
+        if (s.len - i == 4) {
+            // padding is allowed only in last quad
+            if (p[3] == '=') {
+                k = p[2] == '=' ? 2 : 3;
+            }
+        }
+
+        u32 x = 0;
+        for (uint t = 0; t < k; t += 1) {
+            const u8 v = base64_char_value(p[t]);
+            if (v == 0xFF) {
+                ret.len = j;
+                ret.code = ERROR_BAD_BASE64_FORMAT;
+                return ret;
+            }
+            x = (x << 6) | v;
+        }
+        x <<= 6 * (4 - k);
+
+        buf.ptr[j] = cast(u8, x >> 16);
+        if (k >= 3) {
+            buf.ptr[j + 1] = cast(u8, x >> 8);
+        }
+        if (k == 4) {
+            buf.ptr[j + 2] = cast(u8, x);
+        }
+        j += k - 1;
+    }
+
+    ret.len = j;
+    return ret;
+}
+
+// Number of data bytes shown in one hexdump line.
+#define HEXDUMP_LINE_BYTES 16
+
+// Length of hexdump line (including newline) which has offset with
+// more than 8 hex digits. Lines with smaller offsets are 8 bytes shorter.
+#define max_hexdump_line_length 87
+
+// Upper bound on length of hexdump text for n bytes of data.
+static uint
+hexdump_max_len(uint n) {
+    return (n + HEXDUMP_LINE_BYTES - 1) / HEXDUMP_LINE_BYTES * max_hexdump_line_length;
+}
+
+static uint
+hexdump_put_offset(u8* p, u64 offset) {
+    if (offset >> 32 == 0) {
+        unsafe_fmt_hex_prefix_zeroes_u32(make_span_u8(p, 8), cast(u32, offset));
+        return 8;
+    }
+    unsafe_fmt_hex_prefix_zeroes_u64(make_span_u8(p, 16), offset);
+    return 16;
+}
+
+/*/doc
+
+Writes line contents after offset column: hex columns, text column and
+newline. Line may hold less than full 16 bytes, missing bytes are padded
+with spaces in hex columns. Returns number of bytes written.
+*/
+static uint
+hexdump_put_line_base(u8* p, const u8* data, uint n) {
+    p[0] = ' ';
+    p[1] = ' ';
+    uint j = 2;
+    for (uint i = 0; i < HEXDUMP_LINE_BYTES; i += 1) {
+        if (i == HEXDUMP_LINE_BYTES / 2) {
+            p[j] = ' ';
+            j += 1;
+        }
+        if (i < n) {
+            p[j] = encoding_hex_digits[data[i] >> 4];
+            p[j + 1] = encoding_hex_digits[data[i] & 0xF];
+        } else {
+            p[j] = ' ';
+            p[j + 1] = ' ';
+        }
+        p[j + 2] = ' ';
+        j += 3;
+    }
+
+    p[j] = ' ';
+    p[j + 1] = '|';
+    j += 2;
+    for (uint i = 0; i < n; i += 1) {
+        const u8 c = data[i];
+        p[j + i] = c >= 0x20 && c < 0x7F ? c : '.';
+    }
+    j += n;
+    p[j] = '|';
+    p[j + 1] = '\n';
+    return j + 2;
+}
+
+/*/doc
+
+Spreads 16 hex digits (8 bytes) into 24 characters with space after
+each pair. Stores 32 bytes, last 8 of them are garbage.
+*/
+TARGET_SSSE3 static void
+hexdump_spread_ssse3(u8* p, vec16_char hex) {
+    const u8 z = ENCODING_SHUFFLE_ZERO;
+    const vec16_char m0 = {0, 1, z, 2, 3, z, 4, 5, z, 6, 7, z, 8, 9, z, 10};
+    const vec16_char m1 = {11, z, 12, 13, z, 14, 15, z, z, z, z, z, z, z, z, z};
+    const vec16_char s0 = {0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0};
+    const vec16_char s1 = {0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, 0, 0, 0, 0, 0, 0};
+
+    const vec16_char a = __builtin_ia32_pshufb128(hex, m0) | s0;
+    const vec16_char b = __builtin_ia32_pshufb128(hex, m1) | s1;
+    simd_store(p, a);
+    simd_store(p + 16, b);
+}
+
+/*/doc
+
+Writes full hexdump lines for whole 16-byte blocks. Returns number
+of bytes written, consumed data length is a multiple of 16 below n.
+*/
+TARGET_SSSE3 static uint
+hexdump_put_lines_ssse3(u8* p, const u8* data, uint n, u64 offset) {
+    uint j = 0;
+    for (uint i = 0; n - i >= HEXDUMP_LINE_BYTES; i += HEXDUMP_LINE_BYTES) {
+        const uint k = hexdump_put_offset(p + j, offset + i);
+        u8* q = p + j + k;
+
+        vec16_u8 v;
+        simd_load(v, data + i);
+        vec16_char lo;
+        vec16_char hi;
+        hex_encode_ssse3_16(&lo, &hi, v);
+
+        // order of stores matters, each one overwrites garbage
+        // tail of previous one
+        q[0] = ' ';
+        q[1] = ' ';
+        hexdump_spread_ssse3(q + 2, lo);
+        q[26] = ' ';
+        hexdump_spread_ssse3(q + 27, hi);
+        q[51] = ' ';
+        q[52] = '|';
+
+        const vec16_u8 printable = cast(vec16_u8, (v - 0x20) < 0x5F);
+        const vec16_u8 text = (v & printable) | ('.' & ~printable);
+        simd_store(q + 53, text);
+        q[69] = '|';
+        q[70] = '\n';
+
+        j += k + 71;
+    }
+    return j;
+}
+
+/*/doc
+
+Puts data in canonical hexdump layout: offset, 16 bytes in hex split
+into two columns and text column with printable ASCII characters.
+Offset of first byte is taken from argument, so data can be dumped
+chunk by chunk. Buffer must have at least {hexdump_max_len(...)} bytes
+available.
+*/
+static void
+unsafe_fmt_buffer_put_hexdump(FormatBuffer* buf, span_u8 data, u64 offset) {
+    span_u8 tail = fmt_buffer_tail(buf);
+    must(tail.len >= hexdump_max_len(data.len));
+
+    uint i = 0;
+    uint j = 0;
+    if (cpu_has_feature(CPU_FEATURE_SSSE3)) {
+        j = hexdump_put_lines_ssse3(tail.ptr, data.ptr, data.len, offset);
+        i = data.len / HEXDUMP_LINE_BYTES * HEXDUMP_LINE_BYTES;
+    }
+    while (i < data.len) {
+        const uint n = min_uint(data.len - i, HEXDUMP_LINE_BYTES);
+        j += hexdump_put_offset(tail.ptr + j, offset + i);
+        j += hexdump_put_line_base(tail.ptr + j, data.ptr + i, n);
+        i += n;
+    }
+    buf->len += j;
+}
+
+static void
+unsafe_fmt_buffer_put_hex(FormatBuffer* buf, span_u8 s) {
+    span_u8 tail = fmt_buffer_tail(buf);
+    must(tail.len >= hex_encoded_len(s.len));
+
+    buf->len += unsafe_hex_encode(tail, s);
+}
+
+static void
+unsafe_fmt_buffer_put_base64(FormatBuffer* buf, span_u8 s) {
+    span_u8 tail = fmt_buffer_tail(buf);
+    must(tail.len >= base64_encoded_len(s.len));
+
+    buf->len += unsafe_base64_encode(tail, s);
+}
@@ -720,9 +720,8 @@ vulkan_create_swapchain(EngineHarness* h) {
 
 static vk_ShaderModule
 vulkan_create_shader_module(EngineHarness* h, str path) {
-    MemAllocator al = imake_mem_bump_allocator(&proc_mem_bump_allocator);
     MemBlob blob;
-    ErrorCode c = os_load_file(al, path, &blob);
+    ErrorCode c = os_map_file(path, OS_MAP_FILE_POPULATE, &blob);
     if (c != 0) {
         log_error_field(&h->lg, ss("load shader code"), log_field_u64(ss("error"), c));
         engine_harness_mark_exit(h, ENGINE_EXIT_ERROR_INIT);
@@ -738,6 +737,9 @@ vulkan_create_shader_module(EngineHarness* h, str path) {
 
     vk_ShaderModule shader_module;
     vk_Result r = vk_create_shader_module(h->vk.device, &create_info, nil, &shader_module);
+
+    // driver copies shader code during module creation
+    os_unmap_file(&blob);
     if (r != 0) {
         log_vulkan_error(&h->lg, ss("create shader module"), r);
         engine_harness_mark_exit(h, ENGINE_EXIT_ERROR_INIT);
@@ -0,0 +1,823 @@
+/*/doc
+
+External merge sort for binary files of s64 integers (native byte order),
+which do not fit into memory. Depends on {sample_sort_s64(...)} from sort_sample.c
+and {Uring} from uring.c.
+
+Sorting is done in two phases:
+
+	1. input is read in large chunks, each chunk is sorted in memory
+	   and written into a temporary run file
+	2. runs are merged into output file with k-way loser tree
+
+Number of runs merged at once is limited by memory budget, see
+{extsort_max_runs(...)}. If there are more runs, groups of them are first
+merged into intermediate runs, which takes additional passes over data.
+
+All writes are performed by a background thread. Calling thread meanwhile
+reads and sorts next chunk (first phase) or merges next block of output (second phase).
+Thus disk writes overlap with computation and reads in both phases. During merge
+run files are also read ahead through io_uring, so that merge does not wait
+for reads unless disk falls behind.
+
+Temporary run files are named "extsort_run_<index>.tmp" and removed after merge.
+Concurrent sorts must not share the same directory for them.
+*/
+
+#define ERROR_EXTSORT_BAD_INPUT_SIZE 21
+
+// Smallest allowed memory budget for the whole sort.
+#define EXTSORT_MIN_MEM_SIZE (1 << 24)
+
+// Smallest allowed read buffer for each run during merge, it is split into
+// two halves for read ahead. Smaller buffers turn merge into random reads
+// across run files.
+#define EXTSORT_MIN_RUN_BUFFER_SIZE (1 << 20)
+
+// Maximum number of runs merged in a single pass.
+#define EXTSORT_MAX_RUNS (1 << 12)
+
+// Maximum length of temporary directory path.
+#define EXTSORT_MAX_TEMP_DIR_LEN (1 << 10)
+
+typedef struct {
+    str input;
+    str output;
+
+    // Directory for temporary run files.
+    str temp_dir;
+
+    // Memory budget in bytes for all sort buffers.
+    uint mem_size;
+
+    // Number of threads used to sort each chunk in memory.
+    uint num_threads;
+} ExtSortConfig;
+
+typedef struct {
+    // Number of sorted integers.
+    u64 num_elems;
+
+    // Number of runs produced by first pass. When input fits into
+    // a single chunk it is sorted in memory and written directly
+    // to output, number of runs is 0 in that case.
+    uint num_runs;
+
+    // Number of merge passes over data, including the final one.
+    uint num_passes;
+
+    ErrorCode code;
+} RetExtSort;
+
+/*/doc
+
+Write of a single buffer which is performed by a background thread.
+*/
+typedef struct {
+    OsThread thread;
+
+    Writer writer;
+    span_u8 data;
+
+    RetWrite ret;
+
+    // True if write runs in separate thread and was not waited yet.
+    bool pending;
+} ExtSortWriteJob;
+
+static void
+extsort_write_job_run(void* arg) {
+    ExtSortWriteJob* job = arg;
+    job->ret = bag_write_all(job->writer, job->data);
+}
+
+/*/doc
+
+Starts writing data in background. Memory referenced by data must not be
+changed until {extsort_write_wait(...)} is called. Falls back to
+synchronous write if thread cannot be started.
+*/
+static void
+extsort_write_start(ExtSortWriteJob* job, Writer writer, span_u8 data) {
+    must(!job->pending);
+
+    job->writer = writer;
+    job->data = data;
+    job->ret = (RetWrite){};
+
+    ErrorCode code = os_thread_start(&job->thread, extsort_write_job_run, job);
+    if (code != 0) {
+        extsort_write_job_run(job);
+        return;
+    }
+    job->pending = true;
+}
+
+/*/doc
+
+Waits until previously started write is finished and returns its error code.
+*/
+static ErrorCode
+extsort_write_wait(ExtSortWriteJob* job) {
+    if (job->pending) {
+        os_thread_join(&job->thread);
+        job->pending = false;
+    }
+    return job->ret.code;
+}
+
+static span_u8
+extsort_bytes_s64(s64* ptr, uint len) {
+    return make_span_u8(cast(u8*, ptr), len * sizeof(s64));
+}
+
+/*/doc
+
+Formats path of temporary run file with a given index into buffer.
+*/
+static str
+extsort_run_path(span_u8 buf, str dir, uint i) {
+    FormatBuffer fb;
+    init_fmt_buffer(&fb, buf);
+    unsafe_fmt_buffer_put_str(&fb, dir);
+    unsafe_fmt_buffer_put_str(&fb, ss("/extsort_run_"));
+    unsafe_fmt_buffer_put_dec_u64(&fb, i);
+    unsafe_fmt_buffer_put_str(&fb, ss(".tmp"));
+    return fmt_buffer_head(&fb);
+}
+
+// Length of each output buffer during merge, in elements. Two such buffers
+// take a quarter of memory, the rest is split between runs.
+static uint
+extsort_out_len(uint mem_len) {
+    return mem_len / 8;
+}
+
+/*/doc
+
+Returns maximum number of runs which can be merged in a single pass
+with a given memory budget (in elements). It is at least 2 for any
+budget allowed by {EXTSORT_MIN_MEM_SIZE}.
+*/
+static uint
+extsort_max_runs(uint mem_len) {
+    uint n = (mem_len - 2 * extsort_out_len(mem_len)) / (EXTSORT_MIN_RUN_BUFFER_SIZE / sizeof(s64));
+    return min_uint(n, EXTSORT_MAX_RUNS);
+}
+
+typedef struct {
+    // Number of integers read from input.
+    u64 num_elems;
+
+    uint num_runs;
+
+    // True if input fitted into single chunk and was written
+    // directly to output.
+    bool direct;
+
+    ErrorCode code;
+} RetExtSortRuns;
+
+/*/doc
+
+Reads up to {buf.len} integers from file. Returns number of integers read
+in {count} field. Error code ERROR_READER_EOF is returned when input ends.
+*/
+static RetRead
+extsort_read_s64(uint fd, span_s64 buf) {
+    RetRead r = os_linux_read_all(fd, extsort_bytes_s64(buf.ptr, buf.len));
+    if (r.code != 0 && r.code != ERROR_READER_EOF) {
+        return r;
+    }
+    if (r.count % sizeof(s64) != 0) {
+        r.code = ERROR_EXTSORT_BAD_INPUT_SIZE;
+        return r;
+    }
+    r.count /= sizeof(s64);
+    return r;
+}
+
+/*/doc
+
+First phase. Splits input into chunks of {chunks[i].len} integers, sorts each
+of them and writes into run files. Two chunk buffers are used in turns:
+while one is written in background, the other is filled and sorted.
+*/
+static RetExtSortRuns
+extsort_make_runs(const ExtSortConfig* cfg, span_s64 chunks[2], span_s64 scratch) {
+    RetExtSortRuns ret = {};
+
+    RetOpen ro = os_open(cfg->input);
+    if (ro.code != 0) {
+        ret.code = ro.code;
+        return ret;
+    }
+    const uint fd_in = ro.fd;
+
+    u8 path_buf[EXTSORT_MAX_TEMP_DIR_LEN + 64];
+
+    ExtSortWriteJob job = {};
+    uint fd_run = 0;
+    bool has_run = false;
+
+    uint cur = 0;
+    while (true) {
+        RetRead r = extsort_read_s64(fd_in, chunks[cur]);
+        if (r.code != 0 && r.code != ERROR_READER_EOF) {
+            ret.code = r.code;
+            break;
+        }
+        const bool eof = r.code == ERROR_READER_EOF;
+        // empty input still goes through the loop once to create empty output
+        if (r.count == 0 && ret.num_runs != 0) {
+            break;
+        }
+
+        span_s64 chunk = make_span_s64(chunks[cur].ptr, r.count);
+        if (scratch.len == 0) {
+            intro_sort_s64(chunk);
+        } else {
+            sample_sort_s64(chunk, scratch, cfg->num_threads);
+        }
+        ret.num_elems += r.count;
+
+        ErrorCode code = extsort_write_wait(&job);
+        if (has_run) {
+            os_linux_amd64_syscall_close(fd_run);
+            has_run = false;
+        }
+        if (code != 0) {
+            ret.code = code;
+            break;
+        }
+
+        str path;
+        if (eof && ret.num_runs == 0) {
+            // whole input fits into one chunk
+            ret.direct = true;
+            path = cfg->output;
+        } else {
+            path = extsort_run_path(make_span_u8(path_buf, sizeof(path_buf)), cfg->temp_dir, ret.num_runs);
+        }
+
+        RetOpen rc = os_create(path);
+        if (rc.code != 0) {
+            ret.code = rc.code;
+            break;
+        }
+        if (!ret.direct) {
+            ret.num_runs += 1;
+        }
+        fd_run = rc.fd;
+        has_run = true;
+        extsort_write_start(&job, bag_fd_writer(fd_run), extsort_bytes_s64(chunk.ptr, chunk.len));
+
+        if (eof) {
+            break;
+        }
+        cur ^= 1;
+    }
+
+    ErrorCode code = extsort_write_wait(&job);
+    if (has_run) {
+        os_linux_amd64_syscall_close(fd_run);
+    }
+    if (ret.code == 0) {
+        ret.code = code;
+    }
+    os_linux_amd64_syscall_close(fd_in);
+    return ret;
+}
+
+/*/doc
+
+Double buffered reader of a single run file during merge. While elements
+are merged from front half of its buffer, next portion of file is read
+into back half. Halves are swapped when front one is exhausted.
+*/
+typedef struct {
+    // Front half, holds elements which are not yet merged.
+    s64* buf;
+
+    // Back half, target of read in flight.
+    s64* back;
+
+    // Position of current head element inside front half.
+    uint pos;
+
+    // Number of elements in front half.
+    uint len;
+
+    // Capacity of each half.
+    uint cap;
+
+    // Number of bytes read into back half so far.
+    uint filled;
+
+    // File offset of next read.
+    u64 offset;
+
+    // Describes remaining part of back half for vectored read.
+    // Must stay valid while read is in flight.
+    str iov;
+
+    uint fd;
+
+    // Error of read into back half.
+    ErrorCode code;
+
+    // True while read into back half is in flight.
+    bool reading;
+
+    // True if run file was read until its end.
+    bool eof;
+} ExtSortRun;
+
+typedef struct {
+    // Ring for reads of all runs. Each run has at most one read in flight.
+    Uring ring;
+
+    // Number of reads in flight.
+    uint inflight;
+
+    // True if reads go through ring, otherwise they are synchronous.
+    bool async;
+
+
+    ExtSortRun runs[EXTSORT_MAX_RUNS];
+
+    // Current head element of each run. Stored separately from runs
+    // to keep tree comparisons within few cache lines.
+    s64 keys[EXTSORT_MAX_RUNS];
+
+    // True for runs without elements left.
+    bool done[EXTSORT_MAX_RUNS];
+
+    // Loser tree. Internal nodes 1, ..., k - 1 hold index of the run which
+    // lost comparison at this node. Node 0 holds index of overall winner.
+    // Leaf of run i is implicit node k + i.
+    uint tree[EXTSORT_MAX_RUNS];
+
+    uint num_runs;
+} ExtSortMerger;
+
+/*/doc
+
+Returns true if head of run {a} must be merged before head of run {b}.
+Runs without elements lose to any other run.
+*/
+static bool
+extsort_merger_beats(const ExtSortMerger* m, uint a, uint b) {
+    if (m->done[a]) {
+        return false;
+    }
+    if (m->done[b]) {
+        return true;
+    }
+    return m->keys[a] < m->keys[b];
+}
+
+/*/doc
+
+Prepares read of remaining part of back half of run. It is passed
+to kernel on next submit.
+*/
+static void
+extsort_merger_prep_read(ExtSortMerger* m, uint i) {
+    ExtSortRun* run = &m->runs[i];
+    LinuxUringSqe* sqe = uring_get_sqe(&m->ring);
+
+    // ring has at least as many entries as there are runs
+    must(sqe != nil);
+
+    run->iov = make_str(cast(u8*, run->back) + run->filled, run->cap * sizeof(s64) - run->filled);
+    sqe->opcode = OS_LINUX_URING_OP_READV;
+    sqe->fd = cast(s32, run->fd);
+    sqe->off = run->offset;
+    sqe->addr = cast(u64, &run->iov);
+    sqe->len = 1;
+    sqe->user_data = i;
+    run->reading = true;
+    m->inflight += 1;
+}
+
+static void
+extsort_merger_complete(ExtSortMerger* m, LinuxUringCqe cqe) {
+    ExtSortRun* run = &m->runs[cqe.user_data];
+    run->reading = false;
+    m->inflight -= 1;
+    if (cqe.res < 0) {
+        run->code = os_linux_convert_syscall_read_error(cast(uint, -cqe.res));
+        return;
+    }
+    if (cqe.res == 0) {
+        run->eof = true;
+        return;
+    }
+
+    const uint n = cast(uint, cqe.res);
+    run->filled += n;
+    run->offset += n;
+    if (run->filled < run->cap * sizeof(s64)) {
+        // short read, rest of the half is requested again,
+        // at end of file it will complete with 0
+        extsort_merger_prep_read(m, cast(uint, cqe.user_data));
+    }
+}
+
+/*/doc
+
+Starts reading next portion of run file into back half of its buffer.
+Reads synchronously when io_uring is not available.
+*/
+static ErrorCode
+extsort_merger_read(ExtSortMerger* m, uint i) {
+    ExtSortRun* run = &m->runs[i];
+    run->filled = 0;
+    if (run->eof) {
+        return 0;
+    }
+
+    if (!m->async) {
+        RetRead r = os_linux_read_all(run->fd, extsort_bytes_s64(run->back, run->cap));
+        if (r.code != 0 && r.code != ERROR_READER_EOF) {
+            run->code = r.code;
+            return 0;
+        }
+        run->eof = r.code == ERROR_READER_EOF;
+        run->filled = r.count;
+        return 0;
+    }
+
+    extsort_merger_prep_read(m, i);
+    return uring_submit_and_wait(&m->ring, 0);
+}
+
+/*/doc
+
+Waits until read into back half of run is finished. Reads of other runs
+which complete meanwhile are handled too.
+*/
+static ErrorCode
+extsort_merger_wait(ExtSortMerger* m, uint i) {
+    const ExtSortRun* run = &m->runs[i];
+    while (run->reading) {
+        LinuxUringCqe cqe;
+        if (uring_peek_cqe(&m->ring, &cqe)) {
+            extsort_merger_complete(m, cqe);
+            continue;
+        }
+        ErrorCode code = uring_submit_and_wait(&m->ring, 1);
+        if (code != 0) {
+            return code;
+        }
+    }
+    if (m->ring.sqe_pending != 0) {
+        // pass reads requested again after short reads
+        return uring_submit_and_wait(&m->ring, 0);
+    }
+    return 0;
+}
+
+/*/doc
+
+Swaps halves of run buffer after its front half is exhausted and starts
+reading into the new back half. Marks run as done when no elements left.
+*/
+static ErrorCode
+extsort_merger_refill(ExtSortMerger* m, uint i) {
+    ExtSortRun* run = &m->runs[i];
+    ErrorCode code = extsort_merger_wait(m, i);
+    if (code != 0) {
+        return code;
+    }
+    if (run->code != 0) {
+        return run->code;
+    }
+    if (run->filled % sizeof(s64) != 0) {
+        return ERROR_EXTSORT_BAD_INPUT_SIZE;
+    }
+
+    s64* buf = run->back;
+    run->back = run->buf;
+    run->buf = buf;
+    run->pos = 0;
+    run->len = run->filled / sizeof(s64);
+    if (run->len == 0) {
+        m->done[i] = true;
+        return 0;
+    }
+    m->keys[i] = run->buf[0];
+    return extsort_merger_read(m, i);
+}
+
+/*/doc
+
+Waits for all reads in flight, since kernel may still access buffer
+memory, then releases ring.
+*/
+static void
+extsort_merger_close(ExtSortMerger* m) {
+    if (!m->async) {
+        return;
+    }
+    LinuxUringCqe cqe;
+    while (m->inflight != 0) {
+        if (uring_submit_and_wait(&m->ring, 1) != 0) {
+            break;
+        }
+        while (uring_peek_cqe(&m->ring, &cqe)) {
+            extsort_merger_complete(m, cqe);
+        }
+    }
+    uring_close(&m->ring);
+}
+
+/*/doc
+
+Builds subtree with root at a given node. Returns index of run which wins
+in this subtree.
+*/
+static uint
+extsort_merger_build(ExtSortMerger* m, uint node) {
+    const uint k = m->num_runs;
+    if (node >= k) {
+        return node - k;
+    }
+
+    uint a = extsort_merger_build(m, 2 * node);
+    uint b = extsort_merger_build(m, 2 * node + 1);
+    if (extsort_merger_beats(m, b, a)) {
+        m->tree[node] = a;
+        return b;
+    }
+    m->tree[node] = b;
+    return a;
+}
+
+/*/doc
+
+Replays matches on path from leaf of run {w} to the root after its head
+element has changed. Only one comparison per tree level is needed.
+*/
+static void
+extsort_merger_replay(ExtSortMerger* m, uint w) {
+    uint node = (w + m->num_runs) >> 1;
+    while (node != 0) {
+        uint c = m->tree[node];
+        if (extsort_merger_beats(m, c, w)) {
+            m->tree[node] = w;
+            w = c;
+        }
+        node >>= 1;
+    }
+    m->tree[0] = w;
+}
+
+/*/doc
+
+Merges all runs of merger into output file. Output is produced into
+two buffers in turns: while one is written in background, the other is
+filled by merge.
+*/
+static ErrorCode
+extsort_merge(ExtSortMerger* m, span_s64 outs[2], str output) {
+    ErrorCode code = 0;
+    // start reads of all runs at once, then take their results
+    for (uint i = 0; i < m->num_runs; i += 1) {
+        code = extsort_merger_read(m, i);
+        if (code != 0) {
+            return code;
+        }
+    }
+    for (uint i = 0; i < m->num_runs; i += 1) {
+        code = extsort_merger_refill(m, i);
+        if (code != 0) {
+            return code;
+        }
+    }
+    m->tree[0] = extsort_merger_build(m, 1);
+
+    RetOpen ro = os_create(output);
+    if (ro.code != 0) {
+        return ro.code;
+    }
+    const Writer writer = bag_fd_writer(ro.fd);
+
+    ExtSortWriteJob job = {};
+    uint cur = 0;
+    s64* out = outs[cur].ptr;
+    const uint out_cap = outs[cur].len;
+    uint n = 0;
+    while (true) {
+        const uint w = m->tree[0];
+        if (m->done[w]) {
+            break;
+        }
+
+        out[n] = m->keys[w];
+        n += 1;
+        if (n == out_cap) {
+            code = extsort_write_wait(&job);
+            if (code != 0) {
+                break;
+            }
+            extsort_write_start(&job, writer, extsort_bytes_s64(out, n));
+            cur ^= 1;
+            out = outs[cur].ptr;
+            n = 0;
+        }
+
+        ExtSortRun* run = &m->runs[w];
+        run->pos += 1;
+        if (run->pos < run->len) {
+            m->keys[w] = run->buf[run->pos];
+        } else {
+            code = extsort_merger_refill(m, w);
+            if (code != 0) {
+                break;
+            }
+        }
+        extsort_merger_replay(m, w);
+    }
+
+    ErrorCode wait_code = extsort_write_wait(&job);
+    if (code == 0) {
+        code = wait_code;
+    }
+    if (code == 0 && n != 0) {
+        RetWrite r = bag_write_all(writer, extsort_bytes_s64(out, n));
+        code = r.code;
+    }
+    os_linux_amd64_syscall_close(ro.fd);
+    return code;
+}
+
+/*/doc
+
+Opens run files with indices {first}, ..., {first + num_runs - 1} and
+distributes memory between their read buffers and two output buffers,
+then merges runs into output.
+*/
+static ErrorCode
+extsort_merge_runs(const ExtSortConfig* cfg, span_s64 mem, uint first, uint num_runs, str output) {
+    MemBlock block = {};
+    block.span.len = sizeof(ExtSortMerger);
+    ErrorCode code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        return code;
+    }
+    ExtSortMerger* m = cast(ExtSortMerger*, block.span.ptr);
+    m->num_runs = num_runs;
+
+    const uint out_len = extsort_out_len(mem.len);
+    span_s64 outs[2] = {
+        make_span_s64(mem.ptr, out_len),
+        make_span_s64(mem.ptr + out_len, out_len),
+    };
+    const uint run_len = (mem.len - 2 * out_len) / num_runs;
+    must(run_len * sizeof(s64) >= EXTSORT_MIN_RUN_BUFFER_SIZE);
+    const uint half_len = run_len / 2;
+
+    m->async = init_uring(&m->ring, num_runs) == 0;
+
+    u8 path_buf[EXTSORT_MAX_TEMP_DIR_LEN + 64];
+    uint num_open = 0;
+    for (uint i = 0; i < num_runs; i += 1) {
+        str path = extsort_run_path(make_span_u8(path_buf, sizeof(path_buf)), cfg->temp_dir, first + i);
+        RetOpen ro = os_open(path);
+        if (ro.code != 0) {
+            code = ro.code;
+            break;
+        }
+        ExtSortRun* run = &m->runs[i];
+        run->buf = mem.ptr + 2 * out_len + i * run_len;
+        run->back = run->buf + half_len;
+        run->cap = half_len;
+        run->fd = ro.fd;
+        num_open += 1;
+    }
+
+    if (code == 0) {
+        code = extsort_merge(m, outs, output);
+    }
+    extsort_merger_close(m);
+
+    for (uint i = 0; i < num_open; i += 1) {
+        os_linux_amd64_syscall_close(m->runs[i].fd);
+    }
+    os_linux_mem_free(block);
+    return code;
+}
+
+typedef struct {
+    // Number of run files created during merge phase. Together with
+    // runs of the first phase they have indices 0, ..., num_files - 1.
+    uint num_files;
+
+    uint num_passes;
+
+    ErrorCode code;
+} RetExtSortMerge;
+
+/*/doc
+
+Second phase. Merges runs produced by the first phase into output file.
+While there are more runs than can be merged at once, each pass merges
+consecutive groups of them into new runs, which are numbered after
+existing ones. Consumed runs are removed as soon as their group is merged.
+*/
+static RetExtSortMerge
+extsort_merge_all(const ExtSortConfig* cfg, span_s64 mem, uint num_runs) {
+    const uint max_runs = extsort_max_runs(mem.len);
+    must(max_runs >= 2);
+
+    RetExtSortMerge ret = {};
+    ret.num_files = num_runs;
+
+    u8 path_buf[EXTSORT_MAX_TEMP_DIR_LEN + 64];
+    uint first = 0;
+    uint count = num_runs;
+    while (count > max_runs) {
+        const uint next = ret.num_files;
+        for (uint g = 0; g < count; g += max_runs) {
+            const uint k = min_uint(max_runs, count - g);
+            str path = extsort_run_path(make_span_u8(path_buf, sizeof(path_buf)), cfg->temp_dir, ret.num_files);
+            // count file before merge, so that partially written one is removed on error
+            ret.num_files += 1;
+            ret.code = extsort_merge_runs(cfg, mem, first + g, k, path);
+            if (ret.code != 0) {
+                return ret;
+            }
+            for (uint i = first + g; i < first + g + k; i += 1) {
+                os_remove(extsort_run_path(make_span_u8(path_buf, sizeof(path_buf)), cfg->temp_dir, i));
+            }
+        }
+        ret.num_passes += 1;
+        first = next;
+        count = ret.num_files - next;
+    }
+
+    ret.code = extsort_merge_runs(cfg, mem, first, count, cfg->output);
+    ret.num_passes += 1;
+    return ret;
+}
+
+/*/doc
+
+Sorts integers from input file and writes them into output file.
+Input and output must be different files.
+*/
+static RetExtSort
+ext_sort(const ExtSortConfig* cfg) {
+    must(cfg->mem_size >= EXTSORT_MIN_MEM_SIZE);
+
+    RetExtSort ret = {};
+    if (cfg->temp_dir.len > EXTSORT_MAX_TEMP_DIR_LEN) {
+        ret.code = ERROR_LONG_PATH;
+        return ret;
+    }
+
+    MemBlock block = {};
+    block.span.len = cfg->mem_size;
+    ErrorCode code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        ret.code = code;
+        return ret;
+    }
+    span_s64 mem = make_span_s64(cast(s64*, block.span.ptr), cfg->mem_size / sizeof(s64));
+
+    // sample sort needs scratch buffer of chunk size, single thread sorts in place
+    const uint num_parts = cfg->num_threads > 1 ? 3 : 2;
+    const uint chunk_len = mem.len / num_parts;
+    span_s64 chunks[2] = {
+        make_span_s64(mem.ptr, chunk_len),
+        make_span_s64(mem.ptr + chunk_len, chunk_len),
+    };
+    span_s64 scratch = make_span_s64(mem.ptr + 2 * chunk_len, chunk_len);
+    if (num_parts == 2) {
+        scratch = make_span_s64(nil, 0);
+    }
+
+    RetExtSortRuns runs = extsort_make_runs(cfg, chunks, scratch);
+    ret.num_elems = runs.num_elems;
+    ret.num_runs = runs.num_runs;
+    ret.code = runs.code;
+
+    // runs already removed during merge are skipped by failed removal
+    uint num_files = runs.num_runs;
+    if (ret.code == 0 && !runs.direct) {
+        RetExtSortMerge r = extsort_merge_all(cfg, mem, runs.num_runs);
+        ret.num_passes = r.num_passes;
+        ret.code = r.code;
+        num_files = r.num_files;
+    }
+
+    u8 path_buf[EXTSORT_MAX_TEMP_DIR_LEN + 64];
+    for (uint i = 0; i < num_files; i += 1) {
+        os_remove(extsort_run_path(make_span_u8(path_buf, sizeof(path_buf)), cfg->temp_dir, i));
+    }
+
+    os_linux_mem_free(block);
+    return ret;
+}
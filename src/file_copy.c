@@ -0,0 +1,217 @@
+/*
+Copy between two file descriptors which prefers kernel-side methods.
+Data does not pass through user space memory, for file to file copy
+filesystem may even share extents instead of copying them.
+
+Methods are tried in order:
+
+    copy_file_range  both files are regular
+    sendfile         source supports memory mapping (regular file)
+    splice           any files, through intermediate pipe
+    user             buffers in user space, see {uring_copy_fd(...)}
+
+Next method is tried when previous one reports that it does not support
+given files. All methods use and advance file positions, thus copy may
+switch method after some data was already copied.
+*/
+
+#define FILE_COPY_METHOD_COPY_FILE_RANGE 0
+#define FILE_COPY_METHOD_SENDFILE        1
+#define FILE_COPY_METHOD_SPLICE          2
+#define FILE_COPY_METHOD_USER            3
+
+#define FILE_COPY_NUM_METHODS 4
+
+/*/doc
+
+Do not reorder elements in this array. It is tied to copy method constants.
+*/
+static const str
+file_copy_method_names[] = {
+    sl("copy_file_range"),
+    sl("sendfile"),
+    sl("splice"),
+    sl("user"),
+};
+
+// Maximum number of bytes requested by single system call.
+#define FILE_COPY_CHUNK_SIZE (1 << 30)
+
+// Maximum number of bytes moved through intermediate pipe at once.
+// Equals default pipe capacity.
+#define FILE_COPY_PIPE_CHUNK_SIZE (1 << 16)
+
+typedef struct {
+    // Total number of bytes copied by all tried methods.
+    u64 count;
+
+    ErrorCode code;
+
+    // Method which finished the copy (or failed it).
+    uint method;
+} RetFileCopy;
+
+/*/doc
+
+Reports whether system call error means that method can not be used
+for given files, rather than that copy itself failed.
+*/
+static bool
+file_copy_unsupported(uint c) {
+    switch (c) {
+    case 9:  // EBADF, file opened in append mode
+    case 18: // EXDEV, files on different filesystems
+    case 22: // EINVAL, file type does not support method
+    case 38: // ENOSYS
+    case 95: // EOPNOTSUPP
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*/doc
+
+Moves data left in pipe after failed splice into output with plain
+reads and writes, so that it is not lost when copy switches method.
+*/
+static ErrorCode
+file_copy_pipe_leftover(uint out_fd, uint pipe_fd, uint len) {
+    u8 buf[1 << 12];
+    while (len != 0) {
+        RetRead r = os_linux_read(pipe_fd, make_span_u8(buf, min_uint(len, array_len(buf))));
+        if (r.code != 0) {
+            return r.code;
+        }
+        RetWrite w = os_linux_write_all(out_fd, make_span_u8(buf, r.count));
+        if (w.code != 0) {
+            return w.code;
+        }
+        len -= r.count;
+    }
+    return 0;
+}
+
+/*/doc
+
+Splices source into pipe and pipe into destination until source ends.
+*/
+static RetCopy
+file_copy_splice(uint out_fd, uint in_fd) {
+    RetCopy ret = {};
+
+    s32 p[2];
+    sint n = os_linux_amd64_syscall_pipe2(p, OS_LINUX_PIPE_FLAG_CLOEXEC);
+    if (n < 0) {
+        ret.code = cast(ErrorCode, -n);
+        return ret;
+    }
+    const uint pipe_in = cast(uint, p[1]);
+    const uint pipe_out = cast(uint, p[0]);
+
+    while (true) {
+        n = os_linux_amd64_syscall_splice(in_fd, nil, pipe_in, nil, FILE_COPY_PIPE_CHUNK_SIZE, OS_LINUX_SPLICE_FLAG_MOVE);
+        if (n <= 0) {
+            ret.code = cast(ErrorCode, -n);
+            break;
+        }
+
+        uint len = cast(uint, n);
+        while (len != 0) {
+            n = os_linux_amd64_syscall_splice(pipe_out, nil, out_fd, nil, len, OS_LINUX_SPLICE_FLAG_MOVE);
+            if (n <= 0) {
+                break;
+            }
+            ret.count += cast(uint, n);
+            len -= cast(uint, n);
+        }
+        if (len != 0) {
+            ret.code = n == 0 ? ERROR_WRITER_EOF : cast(ErrorCode, -n);
+            if (file_copy_unsupported(ret.code)) {
+                ErrorCode code = file_copy_pipe_leftover(out_fd, pipe_out, len);
+                if (code != 0) {
+                    ret.code = code;
+                } else {
+                    ret.count += len;
+                }
+            }
+            break;
+        }
+    }
+
+    os_linux_amd64_syscall_close(pipe_in);
+    os_linux_amd64_syscall_close(pipe_out);
+    return ret;
+}
+
+/*/doc
+
+Copies with a single kernel-side method until source ends. Error code
+of failed system call is returned as is, so that caller can check it
+with {file_copy_unsupported(...)}.
+*/
+static RetCopy
+file_copy_kernel(uint method, uint out_fd, uint in_fd) {
+    if (method == FILE_COPY_METHOD_SPLICE) {
+        return file_copy_splice(out_fd, in_fd);
+    }
+
+    RetCopy ret = {};
+    while (true) {
+        sint n;
+        switch (method) {
+        case FILE_COPY_METHOD_COPY_FILE_RANGE:
+            n = os_linux_amd64_syscall_copy_file_range(in_fd, nil, out_fd, nil, FILE_COPY_CHUNK_SIZE, 0);
+            break;
+        case FILE_COPY_METHOD_SENDFILE:
+            n = os_linux_amd64_syscall_sendfile(out_fd, in_fd, nil, FILE_COPY_CHUNK_SIZE);
+            break;
+        default:
+            panic_trap();
+        }
+
+        if (n == 0 && ret.count == 0 && method == FILE_COPY_METHOD_COPY_FILE_RANGE) {
+            // some pseudo filesystems report zero size files to copy_file_range,
+            // sendfile reads them properly and handles genuinely empty files
+            ret.code = 22;
+            return ret;
+        }
+        if (n == 0) {
+            return ret;
+        }
+        if (n < 0) {
+            ret.code = cast(ErrorCode, -n);
+            return ret;
+        }
+        ret.count += cast(uint, n);
+    }
+}
+
+/*/doc
+
+Copies source file into destination starting from their current positions,
+using the first method which supports both files. Method argument selects
+the first method to try, pass FILE_COPY_METHOD_COPY_FILE_RANGE to try all
+of them.
+*/
+static RetFileCopy
+file_copy(uint out_fd, uint in_fd, uint method) {
+    must(method < FILE_COPY_NUM_METHODS);
+
+    RetFileCopy ret = {};
+    for (; method < FILE_COPY_METHOD_USER; method += 1) {
+        RetCopy c = file_copy_kernel(method, out_fd, in_fd);
+        ret.count += c.count;
+        if (c.code == 0 || !file_copy_unsupported(c.code)) {
+            ret.code = c.code;
+            ret.method = method;
+            return ret;
+        }
+    }
+
+    RetCopy c = uring_copy_fd(out_fd, in_fd);
+    ret.count += c.count;
+    ret.code = c.code;
+    ret.method = FILE_COPY_METHOD_USER;
+    return ret;
+}
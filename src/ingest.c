@@ -0,0 +1,419 @@
+/*/doc
+
+Bulk loading of integers from text. Numbers are decimal, with optional sign,
+separated by whitespace. Any byte not greater than space (ASCII control
+characters and space itself) counts as whitespace.
+
+Text is scanned in blocks of 64 bytes: whitespace positions are collected
+into 64-bit mask, token starts are non-whitespace bytes preceded by
+whitespace. Each token is converted by {parse_dec_s64_prefix(...)},
+which handles 8 or 16 digits at a time. Depends on strconv.c.
+*/
+
+// Text is split into segments of this length, before each segment output
+// span reserves space for the largest possible number of integers in it.
+// Must be a multiple of 64.
+#define INGEST_SEGMENT_LEN (1 << 20)
+
+// Texts shorter than this are parsed on a single thread.
+#define INGEST_MIN_PARALLEL_LEN (1 << 22)
+
+#define INGEST_MAX_THREADS 64
+
+// Initial size of buffer for reading input.
+#define INGEST_READ_BUFFER_SIZE (1 << 24)
+
+/*/doc
+
+Span of integers which grows as elements are appended. Memory is obtained
+directly from operating system and grows via mremap, thus growth does not
+copy elements.
+
+Zero value is an empty span ready for use.
+
+Related:
+    .grow_span_s64_reserve(...)
+    .grow_span_s64_get(...)
+    .grow_span_s64_free(...)
+*/
+typedef struct {
+    MemBlock block;
+
+    // Number of stored integers.
+    uint len;
+} GrowSpanS64;
+
+static uint
+grow_span_s64_cap(const GrowSpanS64* g) {
+    return g->block.span.len / sizeof(s64);
+}
+
+/*/doc
+
+Makes sure that at least n more integers can be appended without growth.
+Capacity at least doubles on each growth.
+*/
+static ErrorCode
+grow_span_s64_reserve(GrowSpanS64* g, uint n) {
+    const uint cap = grow_span_s64_cap(g);
+    if (g->len + n <= cap) {
+        return 0;
+    }
+
+    uint new_cap = max_uint(2 * cap, g->len + n);
+    new_cap = max_uint(new_cap, OS_LINUX_PAGE_SIZE / sizeof(s64));
+    return os_linux_mem_realloc(&g->block, new_cap * sizeof(s64));
+}
+
+/*/doc
+
+Returns pointer to the first free element after stored ones.
+*/
+static s64*
+grow_span_s64_end(GrowSpanS64* g) {
+    return cast(s64*, g->block.span.ptr) + g->len;
+}
+
+static span_s64
+grow_span_s64_get(GrowSpanS64* g) {
+    return make_span_s64(cast(s64*, g->block.span.ptr), g->len);
+}
+
+static void
+grow_span_s64_free(GrowSpanS64* g) {
+    if (g->block.span.len != 0) {
+        os_linux_mem_free(g->block);
+    }
+    clear_mem_block(&g->block);
+    g->len = 0;
+}
+
+typedef struct {
+    // Offset of the first byte of bad token in text, if {code} is not 0.
+    uint offset;
+
+    ErrorCode code;
+} RetIngest;
+
+/*/doc
+
+Returns mask of whitespace bytes among 64 bytes, bit i corresponds to byte i.
+*/
+static u64
+ingest_ws_mask_base(const u8* p) {
+    u64 mask = 0;
+    for (uint j = 0; j < 8; j += 1) {
+        u64 x;
+        __builtin_memcpy(&x, p + 8 * j, 8);
+
+        // high bit of each byte is set if byte is greater than space
+        const u64 low = x & ~STRCONV_SWAR_HIGH;
+        const u64 gt = strconv_swar_ge(low, ' ' + 1) | (x & STRCONV_SWAR_HIGH);
+
+        // gather high bits of all bytes into 8 low bits
+        const u64 bits = ((gt >> 7) * 0x0102040810204080ULL) >> 56;
+        mask |= (~bits & 0xff) << (8 * j);
+    }
+    return mask;
+}
+
+TARGET_AVX2 static u64
+ingest_ws_mask_avx2(const u8* p) {
+    typedef u8 vec32_u8 __attribute__((vector_size(32)));
+    typedef char vec32_char __attribute__((vector_size(32)));
+
+    vec32_u8 lo;
+    vec32_u8 hi;
+    simd_load(lo, p);
+    simd_load(hi, p + 32);
+
+    const vec32_u8 ws_lo = cast(vec32_u8, lo <= ' ');
+    const vec32_u8 ws_hi = cast(vec32_u8, hi <= ' ');
+    const u64 m_lo = cast(u32, __builtin_ia32_pmovmskb256(cast(vec32_char, ws_lo)));
+    const u64 m_hi = cast(u32, __builtin_ia32_pmovmskb256(cast(vec32_char, ws_hi)));
+    return m_lo | (m_hi << 32);
+}
+
+typedef struct {
+    s64 n;
+
+    // False if token is not a number with at most 15 digits.
+    bool ok;
+} RetIngestToken;
+
+/*/doc
+
+Parses token of known length with optional sign and at most 15 digits.
+Both halves of digits are converted unconditionally, so that token
+length does not cause branch mispredictions. At least 17 bytes must be
+readable from token start. Failure means that token must go through
+generic parser, which reports errors and handles longer numbers.
+*/
+static RetIngestToken
+ingest_parse_short_token(const u8* p, uint len) {
+    RetIngestToken ret = {};
+
+    const bool neg = p[0] == '-';
+    const uint sign_len = (neg || p[0] == '+') ? 1 : 0;
+    const uint d = len - sign_len;
+    if (d == 0 || d > 15) {
+        return ret;
+    }
+
+    u64 lo;
+    u64 hi;
+    __builtin_memcpy(&lo, p + sign_len, 8);
+    __builtin_memcpy(&hi, p + sign_len + 8, 8);
+
+    // k1 in range [1, 8], k2 in range [0, 7]; shifts are split where
+    // their amount could reach 64 bits
+    const uint k1 = min_uint(d, 8);
+    const uint k2 = d - k1;
+    const u64 want1 = STRCONV_SWAR_HIGH >> (8 * (8 - k1));
+    const u64 want2 = (STRCONV_SWAR_HIGH >> (8 * (7 - k2))) >> 8;
+    if ((strconv_swar_dec_mask(lo) & want1) != want1 || (strconv_swar_dec_mask(hi) & want2) != want2) {
+        return ret;
+    }
+
+    // same as strconv_swar_align(...), but without branches
+    const u64 fill = '0' * STRCONV_SWAR_ONES;
+    lo = (lo << (64 - 8 * k1)) | ((fill >> (8 * k1 - 8)) >> 8);
+    hi = ((hi << (56 - 8 * k2)) << 8) | (fill >> (8 * k2));
+    const u64 n = strconv_swar_parse_8_dec(lo) * strconv_pow10[k2] + strconv_swar_parse_8_dec(hi);
+
+    ret.n = neg ? cast(s64, 0 - n) : cast(s64, n);
+    ret.ok = true;
+    return ret;
+}
+
+/*/doc
+
+Generates function which parses text and appends integers to output span.
+Whitespace mask of each 64-byte block is computed by MASK function.
+*/
+#define INGEST_DEFINE_PARSE(NAME, MASK, ATTR) \
+ATTR static RetIngest \
+NAME(str text, GrowSpanS64* out) { \
+    RetIngest ret = {}; \
+\
+    /* start of text counts as whitespace */ \
+    u64 prev_ws = 1; \
+    for (uint seg = 0; seg < text.len; seg += INGEST_SEGMENT_LEN) { \
+        const uint seg_end = min_uint(seg + INGEST_SEGMENT_LEN, text.len); \
+\
+        /* every integer takes at least two bytes, including separator */ \
+        ErrorCode code = grow_span_s64_reserve(out, (seg_end - seg) / 2 + 1); \
+        if (code != 0) { \
+            ret.code = code; \
+            ret.offset = seg; \
+            return ret; \
+        } \
+        s64* dst = grow_span_s64_end(out); \
+        const s64* dst_start = dst; \
+\
+        for (uint b = seg; b < seg_end; b += 64) { \
+            u64 ws; \
+            if (text.len - b >= 64) { \
+                ws = MASK(text.ptr + b); \
+            } else { \
+                /* padding bytes are zero, they count as whitespace */ \
+                u8 buf[64] = {}; \
+                for (uint j = 0; j < text.len - b; j += 1) { \
+                    buf[j] = text.ptr[b + j]; \
+                } \
+                ws = MASK(buf); \
+            } \
+\
+            u64 starts = ~ws & ((ws << 1) | prev_ws); \
+            prev_ws = ws >> 63; \
+            while (starts != 0) { \
+                const uint bit = cast(uint, __builtin_ctzl(starts)); \
+                const uint i = b + bit; \
+                starts &= starts - 1; \
+\
+                /* token which ends inside the block has known length */ \
+                const u64 rest = ws >> bit; \
+                if (rest != 0 && text.len - i >= 17) { \
+                    const uint tok_len = cast(uint, __builtin_ctzl(rest)); \
+                    RetIngestToken t = ingest_parse_short_token(text.ptr + i, tok_len); \
+                    if (t.ok) { \
+                        *dst = t.n; \
+                        dst += 1; \
+                        continue; \
+                    } \
+                } \
+\
+                RetParseS64 r = parse_dec_s64_prefix(str_slice_tail(text, i)); \
+                const uint end = i + r.len; \
+                if (r.code == 0 && end < text.len && text.ptr[end] > ' ') { \
+                    r.code = ERROR_BAD_INTEGER_FORMAT; \
+                } \
+                if (r.code != 0) { \
+                    out->len += cast(uint, dst - dst_start); \
+                    ret.code = r.code; \
+                    ret.offset = i; \
+                    return ret; \
+                } \
+                *dst = r.n; \
+                dst += 1; \
+            } \
+        } \
+        out->len += cast(uint, dst - dst_start); \
+    } \
+    return ret; \
+}
+
+INGEST_DEFINE_PARSE(ingest_parse_s64_avx2, ingest_ws_mask_avx2, TARGET_AVX2)
+INGEST_DEFINE_PARSE(ingest_parse_s64_base, ingest_ws_mask_base, )
+
+/*/doc
+
+Parses whitespace separated integers from text and appends them to output span.
+On error integers parsed before bad token remain in output span.
+*/
+static RetIngest
+ingest_parse_s64(str text, GrowSpanS64* out) {
+    if (cpu_has_feature(CPU_FEATURE_AVX2)) {
+        return ingest_parse_s64_avx2(text, out);
+    }
+    return ingest_parse_s64_base(text, out);
+}
+
+typedef struct {
+    str text;
+
+    // Offset of text chunk inside the whole text.
+    uint offset;
+
+    GrowSpanS64 out;
+
+    RetIngest ret;
+} IngestTask;
+
+static void
+ingest_task_run(void* arg) {
+    IngestTask* t = arg;
+    t->ret = ingest_parse_s64(t->text, &t->out);
+    t->ret.offset += t->offset;
+}
+
+/*/doc
+
+Same as {ingest_parse_s64(...)}, but text is split into chunks which are
+parsed by {num_threads} threads. Chunks end at whitespace, so that tokens
+are not cut. Results of all chunks are appended to output span in order.
+
+On error output span is left unchanged and offset of the first bad token
+is reported.
+*/
+static RetIngest
+ingest_parse_parallel_s64(str text, uint num_threads, GrowSpanS64* out) {
+    num_threads = min_uint(num_threads, INGEST_MAX_THREADS);
+    if (num_threads <= 1 || text.len < INGEST_MIN_PARALLEL_LEN) {
+        GrowSpanS64 g = *out;
+        RetIngest ret = ingest_parse_s64(text, &g);
+        if (ret.code != 0) {
+            g.len = out->len;
+        }
+        *out = g;
+        return ret;
+    }
+
+    IngestTask tasks[INGEST_MAX_THREADS];
+    uint start = 0;
+    for (uint t = 0; t < num_threads; t += 1) {
+        uint end = text.len;
+        if (t + 1 < num_threads) {
+            end = max_uint(cast(uint, cast(u128, text.len) * (t + 1) / num_threads), start);
+            while (end < text.len && text.ptr[end] > ' ') {
+                end += 1;
+            }
+        }
+
+        IngestTask* task = &tasks[t];
+        task->text = str_slice(text, start, end);
+        task->offset = start;
+        clear_mem_block(&task->out.block);
+        task->out.len = 0;
+        start = end;
+    }
+
+    OsThread threads[INGEST_MAX_THREADS];
+    bool started[INGEST_MAX_THREADS];
+    for (uint t = 1; t < num_threads; t += 1) {
+        ErrorCode code = os_thread_start(&threads[t], ingest_task_run, &tasks[t]);
+        started[t] = code == 0;
+        if (!started[t]) {
+            // not enough resources for a thread, do its work here
+            ingest_task_run(&tasks[t]);
+        }
+    }
+    ingest_task_run(&tasks[0]);
+    for (uint t = 1; t < num_threads; t += 1) {
+        if (started[t]) {
+            os_thread_join(&threads[t]);
+        }
+    }
+
+    RetIngest ret = {};
+    uint total = 0;
+    for (uint t = 0; t < num_threads; t += 1) {
+        if (tasks[t].ret.code != 0) {
+            ret = tasks[t].ret;
+            break;
+        }
+        total += tasks[t].out.len;
+    }
+    if (ret.code == 0) {
+        ret.code = grow_span_s64_reserve(out, total);
+    }
+
+    for (uint t = 0; t < num_threads; t += 1) {
+        span_s64 s = grow_span_s64_get(&tasks[t].out);
+        if (ret.code == 0 && s.len != 0) {
+            __builtin_memcpy(grow_span_s64_end(out), s.ptr, s.len * sizeof(s64));
+            out->len += s.len;
+        }
+        grow_span_s64_free(&tasks[t].out);
+    }
+    return ret;
+}
+
+/*/doc
+
+Reads from file descriptor until EOF into memory block obtained from
+operating system. Block grows as needed, works for pipes as well as
+for regular files. Returns number of bytes read.
+
+Block must be empty or obtained from {os_linux_mem_alloc(...)}.
+*/
+static RetRead
+ingest_read_all(uint fd, MemBlock* block) {
+    RetRead ret = {};
+    if (block->span.len == 0) {
+        block->span.len = INGEST_READ_BUFFER_SIZE;
+        ret.code = os_linux_mem_alloc(block);
+        if (ret.code != 0) {
+            return ret;
+        }
+    }
+
+    while (true) {
+        if (ret.count == block->span.len) {
+            ret.code = os_linux_mem_realloc(block, 2 * block->span.len);
+            if (ret.code != 0) {
+                return ret;
+            }
+        }
+
+        RetRead r = os_linux_read(fd, span_u8_slice_tail(block->span, ret.count));
+        ret.count += r.count;
+        if (r.code == ERROR_READER_EOF) {
+            return ret;
+        }
+        if (r.code != 0) {
+            ret.code = r.code;
+            return ret;
+        }
+    }
+}
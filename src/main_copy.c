@@ -1,5 +1,129 @@
 #include "core/include.h"
 
+#include "crc.c"
+#include "digest.c"
+#include "uring.c"
+#include "file_copy.c"
+
+/*
+Copies file into another file.
+
+Usage:
+
+	copy [--verify] <source> <target> [method]
+
+Optional method name selects the first copy method to try, see
+{file_copy(...)} for their order. Used method is logged to
+standard error.
+
+With --verify data is copied in user space while CRC-32 is computed of
+data read from source and of data accepted by target writes. Target is
+then synced to storage, read back and its CRC-32 and size are compared
+with both. On success checksum is printed to standard output.
+*/
+
+static u64
+time_dur_to_micro(TimeDur t) {
+    return cast(u64, t.sec) * 1000000 + cast(u64, t.nsec) / 1000;
+}
+
+static uint
+copy_parse_method(str s) {
+    for (uint i = 0; i < FILE_COPY_NUM_METHODS; i += 1) {
+        if (str_equal(s, file_copy_method_names[i])) {
+            return i;
+        }
+    }
+    return FILE_COPY_NUM_METHODS;
+}
+
+typedef struct {
+    // Number of bytes copied into target.
+    u64 count;
+
+    // I/O error of copy, sync or read back.
+    ErrorCode code;
+
+    // Data read back from target differs from data read from source.
+    // Kept apart from {code}, which may hold any system error code.
+    bool mismatch;
+} RetCopyVerify;
+
+/*/doc
+
+Computes checksum of file contents from its current position to the end.
+*/
+static RetCopy
+copy_digest_fd(uint fd, Digest* digest) {
+    UringReader ur;
+    init_uring_reader(&ur, fd, 0, 0);
+
+    DigestWriter sink;
+    init_digest_sink(&sink, digest->kind);
+
+    RetCopy ret = bag_copy(bag_digest_writer(&sink), bag_uring_reader(&ur));
+    uring_reader_close(&ur);
+    *digest = sink.digest;
+    return ret;
+}
+
+/*/doc
+
+Copies source into target through checksumming reader and tee writer,
+which checksums data accepted by target. Then syncs target and reads it
+back from path. Source checksum is returned in {*crc}. Sets mismatch
+flag if any two of source, accepted and read back data differ in
+checksum or size.
+*/
+static RetCopyVerify
+copy_verify(uint out_fd, uint in_fd, str target_path, u32* crc) {
+    UringReader ur;
+    init_uring_reader(&ur, in_fd, 0, 0);
+
+    DigestReader source;
+    init_digest_reader(&source, bag_uring_reader(&ur), DIGEST_KIND_CRC32);
+
+    DigestWriter accepted;
+    init_digest_sink(&accepted, DIGEST_KIND_CRC32);
+
+    TeeWriter tee;
+    init_tee_writer(&tee, bag_fd_writer(out_fd), bag_digest_writer(&accepted));
+
+    RetCopyVerify ret = {};
+    RetCopy w = bag_copy(bag_tee_writer(&tee), bag_digest_reader(&source));
+    uring_reader_close(&ur);
+    ret.count = w.count;
+    if (w.code != 0) {
+        ret.code = w.code;
+        return ret;
+    }
+    *crc = cast(u32, source.digest.sum);
+
+    sint n = os_linux_amd64_syscall_fsync(out_fd);
+    if (n < 0) {
+        ret.code = os_linux_convert_syscall_write_error(cast(uint, -n));
+        return ret;
+    }
+
+    RetOpen o = os_open(target_path);
+    if (o.code != 0) {
+        ret.code = o.code;
+        return ret;
+    }
+    Digest target;
+    init_digest(&target, DIGEST_KIND_CRC32);
+    RetCopy c = copy_digest_fd(o.fd, &target);
+    os_linux_amd64_syscall_close(o.fd);
+    if (c.code != 0) {
+        ret.code = c.code;
+        return ret;
+    }
+
+    ret.mismatch = source.digest.count != accepted.digest.count || source.digest.sum != accepted.digest.sum ||
+        accepted.digest.count != target.count || accepted.digest.sum != target.sum;
+    return ret;
+}
+
 uint main(uint argc, u8** argv, u8** envp) {
     init_proc_mem_bump_allocator();
     ErrorCode code = init_os_proc_input(argc, argv, envp);
@@ -7,13 +131,36 @@ uint main(uint argc, u8** argv, u8** envp) {
         return code;
     }
 
-    if (os_proc_input.args.len < 3) {
+    uint k = 1;
+    bool verify = false;
+    if (os_proc_input.args.len > k && str_equal(os_proc_input.args.ptr[k], ss("--verify"))) {
+        verify = true;
+        k += 1;
+    }
+
+    if (os_proc_input.args.len < k + 2) {
         print(ss("files not specified\n"));
         return 2;
     }
 
-    str source_path = os_proc_input.args.ptr[1];
-    str target_path = os_proc_input.args.ptr[2];
+    str source_path = os_proc_input.args.ptr[k];
+    str target_path = os_proc_input.args.ptr[k + 1];
+
+    uint method = FILE_COPY_METHOD_COPY_FILE_RANGE;
+    if (verify) {
+        method = FILE_COPY_METHOD_USER;
+    }
+    if (os_proc_input.args.len >= k + 3) {
+        method = copy_parse_method(os_proc_input.args.ptr[k + 2]);
+        if (method == FILE_COPY_NUM_METHODS) {
+            print(ss("unknown copy method\n"));
+            return 2;
+        }
+        if (verify && method != FILE_COPY_METHOD_USER) {
+            print(ss("verify requires user copy method\n"));
+            return 2;
+        }
+    }
 
     RetOpen source_ret = os_open(source_path);
     if (source_ret.code != 0) {
@@ -27,12 +174,55 @@ uint main(uint argc, u8** argv, u8** envp) {
         return 3;
     }
 
-    Reader r = bag_fd_reader(source_ret.fd);
-    Writer w = bag_fd_writer(target_ret.fd);
-    RetCopy ret = bag_copy(w, r);
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDERR);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    u32 crc = 0;
+    bool mismatch = false;
+    TimeDur start = clock_mono();
+    RetFileCopy ret = {};
+    if (verify) {
+        init_crc_table();
+        RetCopyVerify c = copy_verify(target_ret.fd, source_ret.fd, target_path, &crc);
+        ret.count = c.count;
+        ret.code = c.code;
+        ret.method = FILE_COPY_METHOD_USER;
+        mismatch = c.mismatch;
+    } else {
+        ret = file_copy(target_ret.fd, source_ret.fd, method);
+    }
+    TimeDur dur = time_dur_sub(clock_mono(), start);
+
     if (ret.code != 0) {
+        log_error_field2(&lg, ss("copy"), log_field_str(ss("method"), file_copy_method_names[ret.method]), log_field_u64(ss("code"), ret.code));
+        log_sink_close(&sink);
         print(ss("error while copying the file\n"));
         return 4;
     }
+    if (mismatch) {
+        log_error_field(&lg, ss("verify"), log_field_u64(ss("bytes"), ret.count));
+        log_sink_close(&sink);
+        print(ss("copied data does not match source\n"));
+        return 5;
+    }
+
+    LogField fields[3] = {
+        log_field_str(ss("method"), file_copy_method_names[ret.method]),
+        log_field_u64(ss("bytes"), ret.count),
+        log_field_u64(ss("micro"), time_dur_to_micro(dur)),
+    };
+    log_debug_fields(&lg, ss("copied"), make_span_log_field(fields, 3));
+    log_sink_close(&sink);
+
+    if (verify) {
+        u8 buf[16];
+        FormatBuffer f;
+        init_fmt_buffer(&f, make_span_u8(buf, array_len(buf)));
+        unsafe_fmt_buffer_put_hex_prefix_zeroes_u32(&f, crc);
+        unsafe_fmt_buffer_put_newline(&f);
+        print(fmt_buffer_head(&f));
+    }
     return 0;
 }
@@ -0,0 +1,102 @@
+#include "core/include.h"
+
+#include "sort_network.c"
+#include "sort.c"
+#include "sort_gen.c"
+#include "sort_sample.c"
+#include "uring.c"
+#include "extsort.c"
+#include "strconv.c"
+
+/*
+Sorts binary file of s64 integers (native byte order) which may be larger
+than available memory.
+
+Usage:
+
+	extsort <input> <output> [mem_mib] [threads] [temp_dir]
+
+Defaults: 1024 MiB of memory, all available CPUs, current directory
+for temporary files.
+*/
+
+static u64
+time_dur_to_micro(TimeDur t) {
+    return cast(u64, t.sec) * 1000000 + cast(u64, t.nsec) / 1000;
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    if (os_proc_input.args.len < 3) {
+        print(ss("usage: extsort <input> <output> [mem_mib] [threads] [temp_dir]\n"));
+        return 2;
+    }
+
+    ExtSortConfig cfg = {};
+    cfg.input = os_proc_input.args.ptr[1];
+    cfg.output = os_proc_input.args.ptr[2];
+    cfg.mem_size = cast(uint, 1) << 30;
+    cfg.num_threads = os_cpu_count();
+    cfg.temp_dir = ss(".");
+
+    if (os_proc_input.args.len >= 4) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[3]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        if (r.n > (cast(u64, 1) << 30)) {
+            print(ss("memory budget is too large\n"));
+            return 2;
+        }
+        cfg.mem_size = r.n << 20;
+    }
+    if (cfg.mem_size < EXTSORT_MIN_MEM_SIZE) {
+        print(ss("memory budget must be at least 16 MiB\n"));
+        return 2;
+    }
+
+    if (os_proc_input.args.len >= 5) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[4]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        cfg.num_threads = max_uint(r.n, 1);
+    }
+
+    if (os_proc_input.args.len >= 6) {
+        cfg.temp_dir = os_proc_input.args.ptr[5];
+    }
+
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDOUT);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    TimeDur start = clock_mono();
+    RetExtSort ret = ext_sort(&cfg);
+    TimeDur dur = time_dur_sub(clock_mono(), start);
+
+    if (ret.code != 0) {
+        log_error_field(&lg, ss("sort"), log_field_u64(ss("code"), ret.code));
+        log_sink_close(&sink);
+        return ret.code;
+    }
+
+    u64 micro = max_uint(time_dur_to_micro(dur), 1);
+    LogField fields[5] = {
+        log_field_u64(ss("elems"), ret.num_elems),
+        log_field_u64(ss("runs"), ret.num_runs),
+        log_field_u64(ss("passes"), ret.num_passes),
+        log_field_u64(ss("micro"), micro),
+        // bytes per microsecond equals megabytes per second
+        log_field_u64(ss("mb_per_sec"), ret.num_elems * sizeof(s64) / micro),
+    };
+    log_info_fields(&lg, ss("sorted"), make_span_log_field(fields, 5));
+    log_sink_close(&sink);
+    return 0;
+}
@@ -0,0 +1,298 @@
+#include "core/include.h"
+
+#include "rand.c"
+#include "strconv.c"
+#include "strconv_float.c"
+
+/*
+Benchmark for integer formatting. Compares table-driven formatters
+with straightforward versions which produce one digit per division.
+Outputs of both versions are checked to be identical.
+
+Usage:
+
+	fmtbench [log2_len]
+
+Numbers have uniformly distributed bit length, thus all decimal lengths
+are represented. Prints clocks per number multiplied by 100.
+
+Bits of the same numbers are also taken as f64 and f32 values, which are
+checked to survive formatting and parsing back unchanged.
+*/
+
+/*/doc
+
+Previous implementation of {unsafe_fmt_dec_u64(...)}: digits are
+produced in reverse order and then copied into buffer.
+*/
+static uint
+fmt_bench_dec_base(span_u8 buf, u64 x) {
+    u8 digits[max_u64_dec_length];
+    const uint n = unsafe_fmt_reverse_dec_u64(digits, x);
+    unsafe_reverse_copy(buf.ptr, digits, n);
+    return n;
+}
+
+static void
+fmt_bench_dec_fixed_width_base(span_u8 buf, u64 x, uint w) {
+    uint i = w;
+    while (i != 0) {
+        i -= 1;
+        buf.ptr[i] = fmt_dec_digit(cast(u8, x % 10));
+        x /= 10;
+    }
+}
+
+static void
+fmt_bench_hex_prefix_zeroes_base(span_u8 buf, u64 x) {
+    uint i = max_u64_hex_length;
+    while (i != 0) {
+        i -= 1;
+        buf.ptr[i] = fmt_hex_digit(cast(u8, x & 0xF));
+        x >>= 4;
+    }
+}
+
+// Size of output buffer, it is reused when full.
+#define FMT_BENCH_OUTPUT_SIZE (1 << 16)
+
+static u8 fmt_bench_output[FMT_BENCH_OUTPUT_SIZE];
+
+#define FMT_BENCH_DEC_BASE   0
+#define FMT_BENCH_DEC        1
+#define FMT_BENCH_FIXED_BASE 2
+#define FMT_BENCH_FIXED      3
+#define FMT_BENCH_HEX_BASE   4
+#define FMT_BENCH_HEX        5
+#define FMT_BENCH_HEX_SHORT  6
+
+#define FMT_BENCH_NUM_MODES 7
+
+/*/doc
+
+Do not reorder elements in this array. It is tied to mode constants.
+*/
+static const str
+fmt_bench_mode_names[] = {
+    sl("dec_base"),
+    sl("dec"),
+    sl("fixed_base"),
+    sl("fixed"),
+    sl("hex_base"),
+    sl("hex"),
+    sl("hex_short"),
+};
+
+/*/doc
+
+Formats all numbers one after another into output buffer, which is
+reset when it gets full. Returns clocks spent.
+*/
+static u64
+fmt_bench_run(uint mode, span_u64 nums) {
+    FormatBuffer buf;
+    init_fmt_buffer(&buf, make_span_u8(fmt_bench_output, FMT_BENCH_OUTPUT_SIZE));
+
+    const u64 start = cpu_clock();
+    for (uint i = 0; i < nums.len; i += 1) {
+        if (buf.cap - buf.len < max_s64_dec_length) {
+            fmt_buffer_reset(&buf);
+        }
+
+        const u64 x = nums.ptr[i];
+        span_u8 tail = fmt_buffer_tail(&buf);
+        switch (mode) {
+        case FMT_BENCH_DEC_BASE:
+            buf.len += fmt_bench_dec_base(tail, x);
+            break;
+        case FMT_BENCH_DEC:
+            unsafe_fmt_buffer_put_dec_u64(&buf, x);
+            break;
+        case FMT_BENCH_FIXED_BASE:
+            fmt_bench_dec_fixed_width_base(tail, x, max_u64_dec_length);
+            buf.len += max_u64_dec_length;
+            break;
+        case FMT_BENCH_FIXED:
+            unsafe_fmt_buffer_put_dec_fixed_width_u64(&buf, x, max_u64_dec_length);
+            break;
+        case FMT_BENCH_HEX_BASE:
+            fmt_bench_hex_prefix_zeroes_base(tail, x);
+            buf.len += max_u64_hex_length;
+            break;
+        case FMT_BENCH_HEX:
+            unsafe_fmt_buffer_put_hex_prefix_zeroes_u64(&buf, x);
+            break;
+        case FMT_BENCH_HEX_SHORT:
+            unsafe_fmt_buffer_put_hex_u64(&buf, x);
+            break;
+        default:
+            panic_trap();
+        }
+    }
+    return cpu_clock() - start;
+}
+
+/*/doc
+
+Checks that new formatters produce the same text as baseline ones.
+Expected hex text without leading zeroes is derived from fixed width one.
+*/
+static bool
+fmt_bench_check(u64 x) {
+    u8 want[32];
+    u8 got[32];
+    span_u8 w = make_span_u8(want, 32);
+    span_u8 g = make_span_u8(got, 32);
+
+    const uint n = fmt_bench_dec_base(w, x);
+    if (unsafe_fmt_dec_u64(g, x) != n || !str_equal(make_str(want, n), make_str(got, n))) {
+        return false;
+    }
+    if (fmt_dec_u64(make_span_u8(got, n - 1), x) != 0 || fmt_dec_u64(make_span_u8(got, n), x) != n) {
+        return false;
+    }
+
+    for (uint width = 0; width <= max_u64_dec_length; width += 1) {
+        fmt_bench_dec_fixed_width_base(w, x, width);
+        unsafe_fmt_dec_fixed_width_u64(g, x, width);
+        if (!str_equal(make_str(want, width), make_str(got, width))) {
+            return false;
+        }
+    }
+
+    fmt_bench_hex_prefix_zeroes_base(w, x);
+    unsafe_fmt_hex_prefix_zeroes_u64(g, x);
+    if (!str_equal(make_str(want, max_u64_hex_length), make_str(got, max_u64_hex_length))) {
+        return false;
+    }
+
+    uint skip = 0;
+    while (skip + 1 < max_u64_hex_length && want[skip] == '0') {
+        skip += 1;
+    }
+    const uint hex_len = max_u64_hex_length - skip;
+    if (unsafe_fmt_hex_u64(g, x) != hex_len || !str_equal(make_str(want + skip, hex_len), make_str(got, hex_len))) {
+        return false;
+    }
+
+    // buffer wrappers must stay within exact size buffer, guard byte follows
+    FormatBuffer f;
+    init_fmt_buffer(&f, make_span_u8(got, hex_len));
+    got[hex_len] = '#';
+    unsafe_fmt_buffer_put_hex_u64(&f, x);
+    if (f.len != hex_len || got[hex_len] != '#' || !str_equal(make_str(want + skip, hex_len), make_str(got, hex_len))) {
+        return false;
+    }
+    fmt_bench_dec_base(w, x);
+    init_fmt_buffer(&f, make_span_u8(got, n));
+    got[n] = '#';
+    unsafe_fmt_buffer_put_dec_u64(&f, x);
+    if (f.len != n || got[n] != '#' || !str_equal(make_str(want, n), make_str(got, n))) {
+        return false;
+    }
+
+    const s64 y = cast(s64, x);
+    const uint sn = unsafe_fmt_dec_s64(g, y);
+    RetParseS64 r = parse_dec_s64(make_str(got, sn));
+    return r.code == 0 && r.n == y;
+}
+
+/*/doc
+
+Checks that shortest text of float parses back into the same value.
+NaN values are skipped, their payload is not preserved by text.
+*/
+static bool
+fmt_bench_check_float(u64 x) {
+    u8 text[max_float_dec_length];
+    span_u8 t = make_span_u8(text, max_float_dec_length);
+
+    const f64 a = f64_from_bits(x);
+    if ((x & 0x7FF0000000000000ULL) != 0x7FF0000000000000ULL || (x & 0x000FFFFFFFFFFFFFULL) == 0) {
+        RetParseF64 r = parse_f64(make_str(text, fmt_f64(t, a)));
+        if (r.code != 0 || f64_to_bits(r.n) != x) {
+            return false;
+        }
+    }
+
+    const u32 y = cast(u32, x);
+    const f32 b = f32_from_bits(y);
+    if ((y & 0x7F800000) != 0x7F800000 || (y & 0x007FFFFF) == 0) {
+        RetParseF32 r = parse_f32(make_str(text, fmt_f32(t, b)));
+        if (r.code != 0 || f32_to_bits(r.n) != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDOUT);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    uint log2_len = 20;
+    if (os_proc_input.args.len >= 2) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[1]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        log2_len = r.n;
+    }
+    if (log2_len < 10 || log2_len > 26) {
+        print(ss("length must be in range [10, 26] (log2)\n"));
+        return 2;
+    }
+
+    const uint len = cast(uint, 1) << log2_len;
+    MemBlock block = {};
+    block.span.len = len * sizeof(u64);
+    code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        log_error_field(&lg, ss("allocate memory from os"), log_field_u64(ss("code"), code));
+        log_sink_close(&sink);
+        return code;
+    }
+    span_u64 nums = make_span_u64(cast(u64*, block.span.ptr), len);
+
+    Biski64State state;
+    biski64_seed(&state, 123);
+    for (uint i = 0; i < len; i += 1) {
+        const u64 r = biski64_next(&state);
+        nums.ptr[i] = r >> (r & 63);
+    }
+
+    uint exit_code = 0;
+    for (uint i = 0; i < len; i += 1) {
+        if (!fmt_bench_check(nums.ptr[i])) {
+            log_error_field(&lg, ss("formatted text mismatch"), log_field_u64(ss("x"), nums.ptr[i]));
+            exit_code = 1;
+            break;
+        }
+        if (!fmt_bench_check_float(nums.ptr[i])) {
+            log_error_field(&lg, ss("float round trip mismatch"), log_field_u64(ss("bits"), nums.ptr[i]));
+            exit_code = 1;
+            break;
+        }
+    }
+
+    for (uint m = 0; m < FMT_BENCH_NUM_MODES; m += 1) {
+        const u64 clocks = fmt_bench_run(m, nums);
+        LogField fields[2] = {
+            log_field_u64(ss("len"), len),
+            log_field_u64(ss("clocks_centi"), clocks * 100 / len),
+        };
+        log_info_fields(&lg, fmt_bench_mode_names[m], make_span_log_field(fields, 2));
+    }
+
+    os_linux_mem_free(block);
+    log_sink_close(&sink);
+    return exit_code;
+}
@@ -24,7 +24,11 @@ uint main(uint argc, u8** argv, u8** envp) {
     }
 
     MemBlob blob;
-    c = os_load_file(imake_mem_bump_allocator(&proc_mem_bump_allocator), ss("build.claw"), &blob);
+    c = os_map_file(ss("build.claw"), OS_MAP_FILE_DEFAULT, &blob);
+    if (c != 0) {
+        print(ss("failed to read file\n"));
+        return c;
+    }
 
     FormatBuffer buf;
     init_fmt_buffer(&buf, block.span);
@@ -37,5 +41,6 @@ uint main(uint argc, u8** argv, u8** envp) {
 
     print(fmt_buffer_head(&buf));
     print(mem_blob_get_data(blob));
+    os_unmap_file(&blob);
     return 0;
 }
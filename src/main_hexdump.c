@@ -0,0 +1,196 @@
+#include "core/include.h"
+
+#include "encoding.c"
+
+/*
+Prints contents of file (or standard input) in canonical hexdump layout,
+or converts it to and from hex or base64 text.
+
+Usage:
+
+	hexdump [mode] [input]
+
+Modes:
+
+	-C  hexdump with offset, hex and text columns (default)
+	-x  encode into hex
+	-X  decode from hex
+	-b  encode into base64
+	-B  decode from base64
+
+Input "-" or no input means standard input. Encoded text is written
+as a single line. Whitespace in decoded text is ignored.
+*/
+
+#define HEXDUMP_MODE_DUMP          0
+#define HEXDUMP_MODE_HEX_ENCODE    1
+#define HEXDUMP_MODE_HEX_DECODE    2
+#define HEXDUMP_MODE_BASE64_ENCODE 3
+#define HEXDUMP_MODE_BASE64_DECODE 4
+
+#define HEXDUMP_NUM_MODES 5
+
+// Size of input chunk. It is a multiple of 16 (hexdump line)
+// and 3 (base64 block), thus chunks are encoded independently.
+#define HEXDUMP_INPUT_SIZE (3 << 14)
+
+static u8 hexdump_input[HEXDUMP_INPUT_SIZE];
+
+static u8 hexdump_output[HEXDUMP_INPUT_SIZE / HEXDUMP_LINE_BYTES * max_hexdump_line_length];
+
+/*/doc
+
+Reads into buffer until it is full or input ends. Error code is
+ERROR_READER_EOF only when input ended.
+*/
+static RetRead
+hexdump_read_full(uint fd, span_u8 buf) {
+    RetRead ret = {};
+    while (ret.count < buf.len) {
+        RetRead r = os_linux_read(fd, span_u8_slice_tail(buf, ret.count));
+        ret.count += r.count;
+        if (r.code != 0) {
+            ret.code = r.code;
+            return ret;
+        }
+    }
+    return ret;
+}
+
+// Removes ASCII whitespace from text in place. Returns new text length.
+static uint
+hexdump_strip_space(span_u8 s) {
+    uint j = 0;
+    for (uint i = 0; i < s.len; i += 1) {
+        const u8 c = s.ptr[i];
+        s.ptr[j] = c;
+        j += c > ' ';
+    }
+    return j;
+}
+
+static uint
+hexdump_parse_mode(str s) {
+    if (str_equal(s, ss("-C"))) {
+        return HEXDUMP_MODE_DUMP;
+    }
+    if (str_equal(s, ss("-x"))) {
+        return HEXDUMP_MODE_HEX_ENCODE;
+    }
+    if (str_equal(s, ss("-X"))) {
+        return HEXDUMP_MODE_HEX_DECODE;
+    }
+    if (str_equal(s, ss("-b"))) {
+        return HEXDUMP_MODE_BASE64_ENCODE;
+    }
+    if (str_equal(s, ss("-B"))) {
+        return HEXDUMP_MODE_BASE64_DECODE;
+    }
+    return HEXDUMP_NUM_MODES;
+}
+
+/*/doc
+
+Converts input chunk by chunk and writes result to standard output.
+Decode modes carry incomplete tail of text (odd hex digit or partial
+base64 quad) over to the next chunk.
+*/
+static ErrorCode
+hexdump_run(uint mode, uint fd) {
+    u64 offset = 0;
+    uint carry = 0;
+    while (true) {
+        RetRead r = hexdump_read_full(fd, make_span_u8(hexdump_input + carry, HEXDUMP_INPUT_SIZE - carry));
+        if (r.code != 0 && r.code != ERROR_READER_EOF) {
+            return r.code;
+        }
+        const bool last = r.code == ERROR_READER_EOF;
+        span_u8 in = make_span_u8(hexdump_input, carry + r.count);
+
+        FormatBuffer buf;
+        init_fmt_buffer(&buf, make_span_u8(hexdump_output, array_len(hexdump_output)));
+
+        switch (mode) {
+        case HEXDUMP_MODE_DUMP:
+            unsafe_fmt_buffer_put_hexdump(&buf, in, offset);
+            break;
+        case HEXDUMP_MODE_HEX_ENCODE:
+            unsafe_fmt_buffer_put_hex(&buf, in);
+            break;
+        case HEXDUMP_MODE_BASE64_ENCODE:
+            unsafe_fmt_buffer_put_base64(&buf, in);
+            break;
+        case HEXDUMP_MODE_HEX_DECODE:
+        case HEXDUMP_MODE_BASE64_DECODE: {
+            in.len = carry + hexdump_strip_space(span_u8_slice_tail(in, carry));
+            const uint unit = mode == HEXDUMP_MODE_HEX_DECODE ? 2 : 4;
+            const uint n = last ? in.len : in.len - in.len % unit;
+
+            RetDecode d;
+            if (mode == HEXDUMP_MODE_HEX_DECODE) {
+                d = hex_decode(make_span_u8(hexdump_output, array_len(hexdump_output)), make_str(in.ptr, n));
+            } else {
+                d = base64_decode(make_span_u8(hexdump_output, array_len(hexdump_output)), make_str(in.ptr, n));
+            }
+            if (d.code != 0) {
+                return d.code;
+            }
+            buf.len = d.len;
+
+            carry = in.len - n;
+            unsafe_copy(hexdump_input, in.ptr + n, carry);
+            break;
+        }
+        default:
+            panic_trap();
+        }
+
+        offset += in.len;
+        if (last && (mode == HEXDUMP_MODE_HEX_ENCODE || mode == HEXDUMP_MODE_BASE64_ENCODE)) {
+            unsafe_fmt_buffer_put_newline(&buf);
+        }
+        RetWrite w = os_linux_write_all(OS_LINUX_STDOUT, fmt_buffer_head(&buf));
+        if (w.code != 0) {
+            return w.code;
+        }
+        if (last) {
+            return 0;
+        }
+    }
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    uint mode = HEXDUMP_MODE_DUMP;
+    uint k = 1;
+    if (os_proc_input.args.len > k && os_proc_input.args.ptr[k].len == 2 && os_proc_input.args.ptr[k].ptr[0] == '-') {
+        mode = hexdump_parse_mode(os_proc_input.args.ptr[k]);
+        if (mode == HEXDUMP_NUM_MODES) {
+            print(ss("unknown mode\n"));
+            return 2;
+        }
+        k += 1;
+    }
+
+    uint fd = OS_LINUX_STDIN;
+    if (os_proc_input.args.len > k && !str_equal(os_proc_input.args.ptr[k], ss("-"))) {
+        RetOpen o = os_open(os_proc_input.args.ptr[k]);
+        if (o.code != 0) {
+            print(ss("unable to open input file\n"));
+            return 3;
+        }
+        fd = o.fd;
+    }
+
+    code = hexdump_run(mode, fd);
+    if (code != 0) {
+        print(ss("conversion failed\n"));
+        return 4;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "core/include.h"
+
+#include "sort_network.c"
+#include "sort.c"
+#include "sort_gen.c"
+#include "sort_sample.c"
+#include "strconv.c"
+#include "ingest.c"
+
+/*
+Loads whitespace separated decimal integers from text file (or standard
+input) and sorts them in memory.
+
+Usage:
+
+	ingest [input] [threads]
+
+Input "-" or no input means standard input. Defaults to all available CPUs.
+Reports parsing throughput in MB/s along with timings of each stage.
+*/
+
+static u64
+time_dur_to_micro(TimeDur t) {
+    return cast(u64, t.sec) * 1000000 + cast(u64, t.nsec) / 1000;
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDOUT);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    uint fd = OS_LINUX_STDIN;
+    bool close_fd = false;
+    if (os_proc_input.args.len >= 2 && !str_equal(os_proc_input.args.ptr[1], ss("-"))) {
+        RetOpen r = os_open(os_proc_input.args.ptr[1]);
+        if (r.code != 0) {
+            log_error_field(&lg, ss("open input"), log_field_u64(ss("code"), r.code));
+            log_sink_close(&sink);
+            return 1;
+        }
+        fd = r.fd;
+        close_fd = true;
+    }
+
+    uint num_threads = os_cpu_count();
+    if (os_proc_input.args.len >= 3) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[2]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        num_threads = max_uint(r.n, 1);
+    }
+
+    TimeDur start = clock_mono();
+    MemBlock text_block = {};
+    RetRead rr = ingest_read_all(fd, &text_block);
+    if (close_fd) {
+        os_linux_amd64_syscall_close(fd);
+    }
+    if (rr.code != 0) {
+        log_error_field(&lg, ss("read input"), log_field_u64(ss("code"), rr.code));
+        log_sink_close(&sink);
+        return 1;
+    }
+    const u64 read_micro = time_dur_to_micro(time_dur_sub(clock_mono(), start));
+    str text = make_str(text_block.span.ptr, rr.count);
+
+    start = clock_mono();
+    GrowSpanS64 nums = {};
+    RetIngest ri = ingest_parse_parallel_s64(text, num_threads, &nums);
+    if (ri.code != 0) {
+        log_error_field2(&lg, ss("parse input"), log_field_u64(ss("code"), ri.code), log_field_u64(ss("offset"), ri.offset));
+        log_sink_close(&sink);
+        return 1;
+    }
+    const u64 parse_micro = max_uint(time_dur_to_micro(time_dur_sub(clock_mono(), start)), 1);
+    os_linux_mem_free(text_block);
+
+    span_s64 s = grow_span_s64_get(&nums);
+    uint exit_code = 0;
+    u64 sort_micro = 0;
+    if (s.len != 0) {
+        MemBlock scratch_block = {};
+        scratch_block.span.len = s.len * sizeof(s64);
+        code = os_linux_mem_alloc(&scratch_block);
+        if (code != 0) {
+            log_error_field(&lg, ss("allocate memory from os"), log_field_u64(ss("code"), code));
+            log_sink_close(&sink);
+            return code;
+        }
+
+        start = clock_mono();
+        sample_sort_s64(s, make_span_s64(cast(s64*, scratch_block.span.ptr), s.len), num_threads);
+        sort_micro = time_dur_to_micro(time_dur_sub(clock_mono(), start));
+        os_linux_mem_free(scratch_block);
+
+        for (uint i = 1; i < s.len; i += 1) {
+            if (s.ptr[i - 1] > s.ptr[i]) {
+                log_error(&lg, ss("integers are not sorted"));
+                exit_code = 1;
+                break;
+            }
+        }
+    }
+
+    LogField fields[6] = {
+        log_field_u64(ss("bytes"), text.len),
+        log_field_u64(ss("integers"), s.len),
+        log_field_u64(ss("threads"), num_threads),
+        log_field_u64(ss("read_micro"), read_micro),
+        log_field_u64(ss("parse_micro"), parse_micro),
+        log_field_u64(ss("sort_micro"), sort_micro),
+    };
+    log_info_fields(&lg, ss("ingest"), make_span_log_field(fields, 6));
+
+    // bytes per microsecond equals megabytes per second
+    log_info_field(&lg, ss("parse throughput"), log_field_u64(ss("mb_per_sec"), text.len / parse_micro));
+    if (s.len != 0) {
+        log_info_field2(&lg, ss("range"), log_field_s64(ss("min"), s.ptr[0]), log_field_s64(ss("max"), s.ptr[s.len - 1]));
+    }
+
+    grow_span_s64_free(&nums);
+    log_sink_close(&sink);
+    return exit_code;
+}
@@ -25,9 +25,7 @@ uint main(uint argc, u8** argv, u8** envp) {
     LinesReader lr;
     init_lines_reader(&lr, lines);
 
-    Reader r = bag_lines_reader(&lr);
-    Writer w = bag_fd_writer(target_ret.fd);
-    RetCopy ret = bag_copy(w, r);
+    RetWrite ret = lines_reader_write_to(&lr, bag_fd_writer(target_ret.fd));
     if (ret.code != 0) {
         print(ss("error while copying the file\n"));
         return 4;
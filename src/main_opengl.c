@@ -1,6 +1,7 @@
 #include "core/include.h"
 
 #include "rand.c"
+#include "sort_network.c"
 #include "sort.c"
 #include "strconv.c"
 
@@ -19,13 +19,23 @@ uint main(uint argc, u8** argv, u8** envp) {
 
     str path = os_proc_input.args.ptr[1];
     MemBlob blob;
-    code = os_load_file(imake_mem_bump_allocator(&proc_mem_bump_allocator), path, &blob);
+    code = os_map_file(path, OS_MAP_FILE_DEFAULT, &blob);
     if (code != 0) {
         print(ss("failed to read file\n"));
         return code;
     }
 
-    png_print(mem_blob_get_data(blob));
+    StrBuilder b;
+    init_str_builder(&b, imake_mem_bump_allocator(&proc_mem_bump_allocator), 0);
+    png_print(&b, mem_blob_get_data(blob));
+    os_unmap_file(&blob);
 
-    return 0;
+    code = str_builder_error(&b);
+    if (code != 0) {
+        print(ss("failed to allocate memory\n"));
+        return code;
+    }
+    RetWrite w = str_builder_write_fd(&b, OS_LINUX_STDOUT);
+    str_builder_free(&b);
+    return w.code;
 }
@@ -0,0 +1,92 @@
+#include "core/include.h"
+
+#include "rand.c"
+#include "sort_network.c"
+#include "sort.c"
+#include "sort_gen.c"
+#include "sort_sample.c"
+#include "strconv.c"
+
+static u64
+time_dur_to_micro(TimeDur t) {
+    return cast(u64, t.sec) * 1000000 + cast(u64, t.nsec) / 1000;
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDOUT);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    // number of generated integers
+    uint num_gen = 1 << 27;
+    if (os_proc_input.args.len >= 2) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[1]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        num_gen = r.n;
+    }
+
+    // benchmark runs with 1, 2, ..., max_threads threads
+    uint max_threads = os_cpu_count();
+    if (os_proc_input.args.len >= 3) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[2]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        max_threads = r.n;
+    }
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    log_info_field2(&lg, ss("start benchmark"), log_field_u64(ss("len"), num_gen), log_field_u64(ss("max_threads"), max_threads));
+
+    MemBlock block = {};
+    block.span.len = 2 * num_gen * sizeof(s64);
+    code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        log_error_field(&lg, ss("allocate memory from os"), log_field_u64(ss("code"), code));
+        log_sink_close(&sink);
+        return code;
+    }
+
+    span_s64 s = make_span_s64(cast(s64*, block.span.ptr), num_gen);
+    span_s64 scratch = make_span_s64(cast(s64*, block.span.ptr) + num_gen, num_gen);
+
+    uint exit_code = 0;
+    for (uint p = 1; p <= max_threads; p += 1) {
+        TimeDur fill_start = clock_mono();
+        // input is the same for any number of threads
+        biski64_fill_s64_parallel(123, s, p);
+        log_debug_field(&lg, ss("fill input"), log_field_u64(ss("micro"), time_dur_to_micro(time_dur_sub(clock_mono(), fill_start))));
+
+        TimeDur start = clock_mono();
+        u64 start_clock = cpu_clock();
+        sample_sort_s64(s, scratch, p);
+        u64 clocks = cpu_clock() - start_clock;
+        TimeDur dur = time_dur_sub(clock_mono(), start);
+
+        LogField fields[3] = {
+            log_field_u64(ss("threads"), p),
+            log_field_u64(ss("micro"), time_dur_to_micro(dur)),
+            log_field_u64(ss("clocks_per_elem"), clocks / max_uint(num_gen, 1)),
+        };
+        if (is_sorted_asc_s64(s)) {
+            log_info_fields(&lg, ss("sorted"), make_span_log_field(fields, 3));
+        } else {
+            log_error_fields(&lg, ss("not sorted"), make_span_log_field(fields, 3));
+            exit_code = 1;
+        }
+    }
+
+    os_linux_mem_free(block);
+    log_sink_close(&sink);
+    return exit_code;
+}
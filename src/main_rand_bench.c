@@ -0,0 +1,200 @@
+#include "core/include.h"
+
+#include "rand.c"
+#include "rand_dist.c"
+#include "strconv.c"
+
+/*
+Benchmark for random samplers. Measures clocks per generated value
+for each distribution and checks that sample mean and variance are
+close to expected ones.
+
+Usage:
+
+	randbench [log2_len]
+
+Prints clocks per value multiplied by 100.
+*/
+
+static void
+rand_bench_log(Logger* lg, str name, uint n, u64 clocks) {
+    LogField fields[2] = {
+        log_field_u64(ss("len"), n),
+        log_field_u64(ss("clocks_centi"), clocks * 100 / n),
+    };
+    log_info_fields(lg, name, make_span_log_field(fields, 2));
+}
+
+/*/doc
+
+Checks that sample mean and variance are within a few standard errors
+from expected ones, logs them along with the result.
+*/
+static bool
+rand_bench_check_moments(Logger* lg, str name, span_f64 s, f64 mean, f64 var) {
+    f64 sum = 0.0;
+    for (uint i = 0; i < s.len; i += 1) {
+        sum += s.ptr[i];
+    }
+    const f64 m = sum / cast(f64, s.len);
+
+    f64 sq = 0.0;
+    for (uint i = 0; i < s.len; i += 1) {
+        const f64 d = s.ptr[i] - m;
+        sq += d * d;
+    }
+    const f64 v = sq / cast(f64, s.len);
+
+    LogField fields[2] = {
+        log_field_f64(ss("mean"), m),
+        log_field_f64(ss("var"), v),
+    };
+    log_info_fields(lg, name, make_span_log_field(fields, 2));
+
+    const f64 dm = m - mean;
+    const f64 dv = v - var;
+    const f64 n = cast(f64, s.len);
+    return dm * dm < 25.0 * var / n && dv * dv < 100.0 * var * var / n;
+}
+
+/*/doc
+
+Textbook Fisher-Yates shuffle with one bounded draw per swap.
+Serves as baseline.
+*/
+static void
+rand_bench_shuffle_base(Biski64State* state, span_s64 s) {
+    for (uint i = s.len; i > 1; i -= 1) {
+        const uint j = biski64_bounded(state, i);
+        s64 c = s.ptr[i - 1];
+        s.ptr[i - 1] = s.ptr[j];
+        s.ptr[j] = c;
+    }
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDOUT);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    uint log2_len = 22;
+    if (os_proc_input.args.len >= 2) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[1]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        log2_len = r.n;
+    }
+    if (log2_len < 10 || log2_len > 28) {
+        print(ss("length must be in range [10, 28] (log2)\n"));
+        return 2;
+    }
+
+    const uint len = cast(uint, 1) << log2_len;
+    MemBlock block = {};
+    block.span.len = len * sizeof(u64);
+    code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        log_error_field(&lg, ss("allocate memory from os"), log_field_u64(ss("code"), code));
+        log_sink_close(&sink);
+        return code;
+    }
+    u64* p = cast(u64*, block.span.ptr);
+
+    // touch pages in advance, so that page faults are not measured
+    for (uint i = 0; i < len; i += 1) {
+        p[i] = 0;
+    }
+
+    uint exit_code = 0;
+    Biski64State state;
+    biski64_seed(&state, 123);
+
+    u64 start = cpu_clock();
+    for (uint i = 0; i < len; i += 1) {
+        p[i] = biski64_next(&state);
+    }
+    rand_bench_log(&lg, ss("raw"), len, cpu_clock() - start);
+
+    start = cpu_clock();
+    biski64_fill_bounded_u64(&state, make_span_u64(p, len), 1000);
+    rand_bench_log(&lg, ss("bounded"), len, cpu_clock() - start);
+    for (uint i = 0; i < len; i += 1) {
+        if (p[i] >= 1000) {
+            log_error(&lg, ss("bounded value out of range"));
+            exit_code = 1;
+            break;
+        }
+    }
+
+    span_f32 sf = make_span_f32(cast(f32*, p), 2 * len);
+    start = cpu_clock();
+    biski64_fill_f32(&state, sf);
+    rand_bench_log(&lg, ss("f32"), sf.len, cpu_clock() - start);
+
+    span_f64 s = make_span_f64(cast(f64*, p), len);
+    start = cpu_clock();
+    biski64_fill_f64(&state, s);
+    rand_bench_log(&lg, ss("f64"), len, cpu_clock() - start);
+    if (!rand_bench_check_moments(&lg, ss("f64 moments"), s, 0.5, 1.0 / 12.0)) {
+        log_error(&lg, ss("uniform distribution mismatch"));
+        exit_code = 1;
+    }
+
+    // first call computes tables, exclude it from measurement
+    biski64_normal(&state);
+    start = cpu_clock();
+    biski64_fill_normal_f64(&state, s);
+    rand_bench_log(&lg, ss("normal"), len, cpu_clock() - start);
+    if (!rand_bench_check_moments(&lg, ss("normal moments"), s, 0.0, 1.0)) {
+        log_error(&lg, ss("normal distribution mismatch"));
+        exit_code = 1;
+    }
+
+    start = cpu_clock();
+    biski64_fill_exponential_f64(&state, s);
+    rand_bench_log(&lg, ss("exponential"), len, cpu_clock() - start);
+    if (!rand_bench_check_moments(&lg, ss("exponential moments"), s, 1.0, 1.0)) {
+        log_error(&lg, ss("exponential distribution mismatch"));
+        exit_code = 1;
+    }
+
+    span_s64 si = make_span_s64(cast(s64*, p), len);
+    for (uint i = 0; i < len; i += 1) {
+        si.ptr[i] = cast(s64, i);
+    }
+    start = cpu_clock();
+    rand_bench_shuffle_base(&state, si);
+    u64 base = cpu_clock() - start;
+    start = cpu_clock();
+    biski64_shuffle_s64(&state, si);
+    u64 fast = cpu_clock() - start;
+
+    LogField fields[3] = {
+        log_field_u64(ss("len"), len),
+        log_field_u64(ss("base_centi"), base * 100 / len),
+        log_field_u64(ss("fast_centi"), fast * 100 / len),
+    };
+    log_info_fields(&lg, ss("shuffle"), make_span_log_field(fields, 3));
+
+    // shuffle is a permutation, sum of elements is preserved
+    s64 sum = 0;
+    for (uint i = 0; i < len; i += 1) {
+        sum += si.ptr[i];
+    }
+    if (sum != cast(s64, len) * cast(s64, len - 1) / 2) {
+        log_error(&lg, ss("shuffle lost elements"));
+        exit_code = 1;
+    }
+
+    os_linux_mem_free(block);
+    log_sink_close(&sink);
+    return exit_code;
+}
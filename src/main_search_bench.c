@@ -0,0 +1,175 @@
+#include "core/include.h"
+
+#include "rand.c"
+#include "sort_network.c"
+#include "sort.c"
+#include "sort_gen.c"
+#include "search.c"
+#include "strconv.c"
+
+/*
+Benchmark for search over sorted spans. Compares textbook binary search
+with branchless, batched and Eytzinger layout variants.
+
+Usage:
+
+	searchbench [log2_len] [num_queries]
+
+Prints cycles per query for each variant.
+*/
+
+/*/doc
+
+Textbook binary search with unpredictable branch on each step.
+Serves as baseline.
+*/
+static uint
+search_bench_textbook(span_s64 s, s64 x) {
+    uint lo = 0;
+    uint hi = s.len;
+    while (lo < hi) {
+        uint mid = lo + (hi - lo) / 2;
+        if (s.ptr[mid] < x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDOUT);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    uint log2_len = 24;
+    if (os_proc_input.args.len >= 2) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[1]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        log2_len = r.n;
+    }
+    if (log2_len == 0 || log2_len > 30) {
+        print(ss("length must be in range [1, 30] (log2)\n"));
+        return 2;
+    }
+
+    uint num_queries = 1 << 20;
+    if (os_proc_input.args.len >= 3) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[2]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        num_queries = max_uint(r.n, 1);
+    }
+
+    // slightly less than power of two, so that the last tree level is incomplete
+    const uint len = (cast(uint, 1) << log2_len) - log2_len;
+
+    // sorted span, its Eytzinger layout, queries and results of two searches
+    MemBlock block = {};
+    block.span.len = (2 * len + 1) * sizeof(s64) + num_queries * (sizeof(s64) + 2 * sizeof(uint));
+    code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        log_error_field(&lg, ss("allocate memory from os"), log_field_u64(ss("code"), code));
+        log_sink_close(&sink);
+        return code;
+    }
+    s64* p = cast(s64*, block.span.ptr);
+    span_s64 s = make_span_s64(p, len);
+    span_s64 e = make_span_s64(p + len, len + 1);
+    span_s64 queries = make_span_s64(p + 2 * len + 1, num_queries);
+    uint* res = cast(uint*, queries.ptr + num_queries);
+    span_uint expect = make_span_uint(res, num_queries);
+    span_uint out = make_span_uint(res + num_queries, num_queries);
+
+    Biski64State state;
+    biski64_seed(&state, 123);
+    biski64_fill_s64(&state, s);
+    intro_sort_s64(s);
+    eytzinger_build_s64(s, e);
+    biski64_fill_s64(&state, queries);
+
+    u64 start = cpu_clock();
+    for (uint i = 0; i < num_queries; i += 1) {
+        expect.ptr[i] = search_bench_textbook(s, queries.ptr[i]);
+    }
+    u64 textbook = cpu_clock() - start;
+
+    start = cpu_clock();
+    for (uint i = 0; i < num_queries; i += 1) {
+        out.ptr[i] = lower_bound_s64(s, queries.ptr[i]);
+    }
+    u64 branchless = cpu_clock() - start;
+    uint exit_code = 0;
+    for (uint i = 0; i < num_queries; i += 1) {
+        if (out.ptr[i] != expect.ptr[i]) {
+            log_error(&lg, ss("branchless search mismatch"));
+            exit_code = 1;
+            break;
+        }
+    }
+
+    start = cpu_clock();
+    lower_bound_batch_s64(s, queries, out);
+    u64 batch = cpu_clock() - start;
+    for (uint i = 0; i < num_queries; i += 1) {
+        if (out.ptr[i] != expect.ptr[i]) {
+            log_error(&lg, ss("batched search mismatch"));
+            exit_code = 1;
+            break;
+        }
+    }
+
+    // Eytzinger indices are checked by comparing found values
+    start = cpu_clock();
+    for (uint i = 0; i < num_queries; i += 1) {
+        out.ptr[i] = eytzinger_lower_bound_s64(e, queries.ptr[i]);
+    }
+    u64 eytzinger = cpu_clock() - start;
+    for (uint i = 0; i < num_queries; i += 1) {
+        uint k = out.ptr[i];
+        uint j = expect.ptr[i];
+        if ((k == 0) != (j == len) || (k != 0 && e.ptr[k] != s.ptr[j])) {
+            log_error(&lg, ss("eytzinger search mismatch"));
+            exit_code = 1;
+            break;
+        }
+    }
+
+    start = cpu_clock();
+    eytzinger_lower_bound_batch_s64(e, queries, out);
+    u64 eytzinger_batch = cpu_clock() - start;
+    for (uint i = 0; i < num_queries; i += 1) {
+        uint k = out.ptr[i];
+        uint j = expect.ptr[i];
+        if ((k == 0) != (j == len) || (k != 0 && e.ptr[k] != s.ptr[j])) {
+            log_error(&lg, ss("eytzinger batched search mismatch"));
+            exit_code = 1;
+            break;
+        }
+    }
+
+    LogField fields[6] = {
+        log_field_u64(ss("len"), len),
+        log_field_u64(ss("textbook"), textbook / num_queries),
+        log_field_u64(ss("branchless"), branchless / num_queries),
+        log_field_u64(ss("batch"), batch / num_queries),
+        log_field_u64(ss("eytzinger"), eytzinger / num_queries),
+        log_field_u64(ss("eytzinger_batch"), eytzinger_batch / num_queries),
+    };
+    log_info_fields(&lg, ss("clocks per query"), make_span_log_field(fields, 6));
+
+    os_linux_mem_free(block);
+    log_sink_close(&sink);
+    return exit_code;
+}
@@ -0,0 +1,195 @@
+#include "core/include.h"
+
+#include "rand.c"
+#include "sort_network.c"
+#include "sort.c"
+#include "sort_gen.c"
+#include "search.c"
+#include "setops.c"
+#include "strconv.c"
+
+/*
+Benchmark for set operations over sorted spans. Compares baseline scalar
+merges with AVX2 kernels, and galloping intersection with plain one on inputs
+of very different length.
+
+Usage:
+
+	setbench [log2_len]
+
+Prints cycles per input element for each operation.
+*/
+
+/*/doc
+
+Fills span with sorted unique integers picked from range [0, 4 * len).
+Returns number of unique elements.
+*/
+static uint
+set_bench_fill(Biski64State* state, span_s64 s) {
+    const u64 range = 4 * s.len;
+    for (uint i = 0; i < s.len; i += 1) {
+        s.ptr[i] = cast(s64, biski64_next(state) % range);
+    }
+    intro_sort_s64(s);
+    return set_unique_s64(s);
+}
+
+static bool
+set_bench_equal(const s64* a, const s64* b, uint n) {
+    for (uint i = 0; i < n; i += 1) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+set_bench_log(Logger* lg, str name, uint n, u64 base, u64 fast) {
+    LogField fields[3] = {
+        log_field_u64(ss("len"), n),
+        log_field_u64(ss("base_centi"), base * 100 / n),
+        log_field_u64(ss("fast_centi"), fast * 100 / n),
+    };
+    log_info_fields(lg, name, make_span_log_field(fields, 3));
+}
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    LogSink sink;
+    Logger lg;
+    init_log_sink_from_fd(&sink, OS_LINUX_STDOUT);
+    init_log(&lg, &sink, LOG_LEVEL_DEBUG);
+
+    uint log2_len = 22;
+    if (os_proc_input.args.len >= 2) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[1]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        log2_len = r.n;
+    }
+    if (log2_len < 8 || log2_len > 28) {
+        print(ss("length must be in range [8, 28] (log2)\n"));
+        return 2;
+    }
+    if (!cpu_has_feature(CPU_FEATURE_AVX2)) {
+        log_warn(&lg, ss("no avx2 support, kernels are compared against themselves"));
+    }
+
+    const uint len = cast(uint, 1) << log2_len;
+    MemBlock block = {};
+    block.span.len = 6 * len * sizeof(s64);
+    code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        log_error_field(&lg, ss("allocate memory from os"), log_field_u64(ss("code"), code));
+        log_sink_close(&sink);
+        return code;
+    }
+    s64* p = cast(s64*, block.span.ptr);
+    s64* out_base = p + 2 * len;
+    s64* out_fast = p + 4 * len;
+
+    Biski64State state;
+    biski64_seed(&state, 123);
+    const uint na = set_bench_fill(&state, make_span_s64(p, len));
+    const uint nb = set_bench_fill(&state, make_span_s64(p + len, len));
+    const s64* a = p;
+    const s64* b = p + len;
+    const uint n = na + nb;
+
+    // touch output pages in advance, so that page faults are not measured
+    for (uint i = 0; i < 4 * len; i += 1) {
+        out_base[i] = 0;
+    }
+
+    uint exit_code = 0;
+
+    u64 start = cpu_clock();
+    uint kb = set_intersect_s64_scalar(a, na, b, nb, out_base);
+    u64 base = cpu_clock() - start;
+    start = cpu_clock();
+    uint kf = set_intersect_s64(make_span_s64(p, na), make_span_s64(p + len, nb), make_span_s64(out_fast, len));
+    u64 fast = cpu_clock() - start;
+    if (kb != kf || !set_bench_equal(out_base, out_fast, kb)) {
+        log_error(&lg, ss("intersection mismatch"));
+        exit_code = 1;
+    }
+    set_bench_log(&lg, ss("intersect"), n, base, fast);
+
+    start = cpu_clock();
+    kb = set_union_s64_scalar(a, na, b, nb, out_base, 0);
+    base = cpu_clock() - start;
+    start = cpu_clock();
+    kf = set_union_s64(make_span_s64(p, na), make_span_s64(p + len, nb), make_span_s64(out_fast, 2 * len));
+    fast = cpu_clock() - start;
+    if (kb != kf || !set_bench_equal(out_base, out_fast, kb)) {
+        log_error(&lg, ss("union mismatch"));
+        exit_code = 1;
+    }
+    set_bench_log(&lg, ss("union"), n, base, fast);
+
+    start = cpu_clock();
+    kb = set_difference_s64_scalar(a, na, b, nb, out_base);
+    base = cpu_clock() - start;
+    start = cpu_clock();
+    kf = set_difference_s64(make_span_s64(p, na), make_span_s64(p + len, nb), make_span_s64(out_fast, len));
+    fast = cpu_clock() - start;
+    if (kb != kf || !set_bench_equal(out_base, out_fast, kb)) {
+        log_error(&lg, ss("difference mismatch"));
+        exit_code = 1;
+    }
+    set_bench_log(&lg, ss("difference"), n, base, fast);
+
+    // duplicates for unique come from concatenation of two sets
+    s64* c = out_base;
+    s64* d = out_fast;
+    for (uint i = 0; i < na; i += 1) {
+        c[i] = a[i];
+    }
+    for (uint i = 0; i < nb; i += 1) {
+        c[na + i] = b[i];
+    }
+    intro_sort_s64(make_span_s64(c, n));
+    for (uint i = 0; i < n; i += 1) {
+        d[i] = c[i];
+    }
+    start = cpu_clock();
+    kb = set_unique_s64_scalar(c, n, 1, 1);
+    base = cpu_clock() - start;
+    start = cpu_clock();
+    kf = set_unique_s64(make_span_s64(d, n));
+    fast = cpu_clock() - start;
+    if (kb != kf || !set_bench_equal(c, d, kb)) {
+        log_error(&lg, ss("unique mismatch"));
+        exit_code = 1;
+    }
+    set_bench_log(&lg, ss("unique"), n, base, fast);
+
+    // skewed inputs: small span is 1/1024 of large one
+    const uint ns = max_uint(na >> 10, 1);
+    for (uint i = 0; i < ns; i += 1) {
+        p[i] = p[i << 10];
+    }
+    start = cpu_clock();
+    kb = set_intersect_s64_scalar(a, ns, b, nb, out_base);
+    base = cpu_clock() - start;
+    start = cpu_clock();
+    kf = set_intersect_gallop_s64(make_span_s64(p, ns), make_span_s64(p + len, nb), make_span_s64(out_fast, ns));
+    fast = cpu_clock() - start;
+    if (kb != kf || !set_bench_equal(out_base, out_fast, kb)) {
+        log_error(&lg, ss("galloping intersection mismatch"));
+        exit_code = 1;
+    }
+    set_bench_log(&lg, ss("intersect_gallop"), ns + nb, base, fast);
+
+    os_linux_mem_free(block);
+    log_sink_close(&sink);
+    return exit_code;
+}
@@ -0,0 +1,335 @@
+#include "core/include.h"
+
+#include "rand.c"
+#include "sort_network.c"
+#include "sort.c"
+#include "sort_gen.c"
+#include "sort_sample.c"
+#include "select.c"
+#include "strconv.c"
+
+/*
+Benchmark suite for sorting algorithms. Runs every algorithm over a grid of
+input distributions and sizes. Each cell is measured several times, output
+contains median and 95th percentile of cycles spent (measured by {cpu_clock()}).
+
+Usage:
+
+	sortbench [max_log2_len] [max_reps]
+
+Output is CSV printed to stdout, one line per (algorithm, distribution, size).
+Cycles per element are printed with two decimal digits. Pairs of algorithm and
+distribution which hit quadratic behaviour are not measured on longer spans.
+*/
+
+#define SORT_BENCH_DIST_RANDOM     0
+#define SORT_BENCH_DIST_SORTED     1
+#define SORT_BENCH_DIST_REVERSED   2
+#define SORT_BENCH_DIST_ORGAN_PIPE 3
+#define SORT_BENCH_DIST_FEW_UNIQUE 4
+#define SORT_BENCH_DIST_SAWTOOTH   5
+#define SORT_BENCH_DIST_PERTURBED  6
+
+#define SORT_BENCH_NUM_DIST 7
+
+/*/doc
+
+Do not reorder elements in this array. It is tied to distribution constants.
+*/
+static const str
+sort_bench_dist_names[] = {
+    sl("random"),
+    sl("sorted"),
+    sl("reversed"),
+    sl("organ_pipe"),
+    sl("few_unique"),
+    sl("sawtooth"),
+    sl("perturbed"),
+};
+
+// Number of distinct values in few unique distribution.
+#define SORT_BENCH_FEW_UNIQUE 16
+
+// Number of teeth in sawtooth distribution.
+#define SORT_BENCH_SAWTOOTH_TEETH 16
+
+static void
+sort_bench_fill(span_s64 s, uint dist, u64 seed) {
+    Biski64State state;
+    biski64_seed(&state, seed);
+
+    const uint n = s.len;
+    switch (dist) {
+    case SORT_BENCH_DIST_RANDOM:
+        biski64_fill_s64(&state, s);
+        return;
+    case SORT_BENCH_DIST_SORTED:
+        for (uint i = 0; i < n; i += 1) {
+            s.ptr[i] = cast(s64, i);
+        }
+        return;
+    case SORT_BENCH_DIST_REVERSED:
+        for (uint i = 0; i < n; i += 1) {
+            s.ptr[i] = cast(s64, n - i);
+        }
+        return;
+    case SORT_BENCH_DIST_ORGAN_PIPE:
+        for (uint i = 0; i < n; i += 1) {
+            if (i < n / 2) {
+                s.ptr[i] = cast(s64, i);
+            } else {
+                s.ptr[i] = cast(s64, n - i);
+            }
+        }
+        return;
+    case SORT_BENCH_DIST_FEW_UNIQUE:
+        for (uint i = 0; i < n; i += 1) {
+            s.ptr[i] = cast(s64, biski64_next(&state) % SORT_BENCH_FEW_UNIQUE);
+        }
+        return;
+    case SORT_BENCH_DIST_SAWTOOTH: {
+        uint period = max_uint(n / SORT_BENCH_SAWTOOTH_TEETH, 1);
+        for (uint i = 0; i < n; i += 1) {
+            s.ptr[i] = cast(s64, i % period);
+        }
+        return;
+    }
+    case SORT_BENCH_DIST_PERTURBED: {
+        // sorted data with 1% of elements swapped at random positions
+        for (uint i = 0; i < n; i += 1) {
+            s.ptr[i] = cast(s64, i);
+        }
+        uint swaps = max_uint(n / 100, 1);
+        for (uint k = 0; k < swaps; k += 1) {
+            uint i = biski64_next(&state) % n;
+            uint j = biski64_next(&state) % n;
+            s64 c = s.ptr[i];
+            s.ptr[i] = s.ptr[j];
+            s.ptr[j] = c;
+        }
+        return;
+    }
+    default:
+        panic_trap();
+    }
+}
+
+// Number of threads used by parallel algorithms.
+static uint sort_bench_threads;
+
+typedef void (*SortBenchFunc)(span_s64 s, span_s64 scratch);
+
+typedef struct {
+    str name;
+
+    SortBenchFunc fn;
+
+    // Algorithm is skipped for spans longer than this.
+    uint max_len;
+} SortBenchAlgo;
+
+static void
+sort_bench_quick(span_s64 s, span_s64 scratch) {
+    quick_sort_s64(s);
+}
+
+static void
+sort_bench_intro(span_s64 s, span_s64 scratch) {
+    intro_sort_s64(s);
+}
+
+static void
+sort_bench_sample(span_s64 s, span_s64 scratch) {
+    sample_sort_s64(s, scratch, sort_bench_threads);
+}
+
+static void
+sort_bench_network(span_s64 s, span_s64 scratch) {
+    network_sort_s64(s);
+}
+
+static void
+sort_bench_insert(span_s64 s, span_s64 scratch) {
+    insert_sort_s64(s);
+}
+
+static void
+sort_bench_bubble(span_s64 s, span_s64 scratch) {
+    bubble_sort_s64(s);
+}
+
+static const SortBenchAlgo
+sort_bench_algos[] = {
+    { .name = sl("quick"),   .fn = sort_bench_quick,   .max_len = 1 << 30 },
+    { .name = sl("intro"),   .fn = sort_bench_intro,   .max_len = 1 << 30 },
+    { .name = sl("sample"),  .fn = sort_bench_sample,  .max_len = 1 << 30 },
+    { .name = sl("network"), .fn = sort_bench_network, .max_len = SORT_NETWORK_MAX_LEN },
+    { .name = sl("insert"),  .fn = sort_bench_insert,  .max_len = 1 << 12 },
+    { .name = sl("bubble"),  .fn = sort_bench_bubble,  .max_len = 1 << 12 },
+};
+
+// Number of repetitions is reduced for long spans, so that each cell
+// sorts at most this number of elements in total.
+#define SORT_BENCH_ELEMS_PER_CELL (1 << 24)
+
+// Algorithms with quadratic worst case may hit it on some distributions.
+// When median exceeds this number of cycles per element, longer spans with the
+// same algorithm and distribution are skipped.
+#define SORT_BENCH_MAX_CYCLES_PER_ELEM 4096
+
+typedef struct {
+    u64 median;
+    u64 p95;
+} SortBenchStats;
+
+/*/doc
+
+Returns median and 95th percentile of measured values. Reorders given span.
+*/
+static SortBenchStats
+sort_bench_stats(span_u64 samples) {
+    SortBenchStats stats = {};
+    stats.median = percentile_u64(samples, 50);
+    stats.p95 = percentile_u64(samples, 95);
+    return stats;
+}
+
+/*/doc
+
+Puts {x / 100} as decimal number with two fractional digits.
+*/
+static void
+sort_bench_put_centi(FormatBuffer* buf, u64 x) {
+    unsafe_fmt_buffer_put_dec_u64(buf, x / 100);
+    unsafe_fmt_buffer_put_byte(buf, '.');
+    unsafe_fmt_buffer_put_dec_fixed_width_u64(buf, x % 100, 2);
+}
+
+static void
+sort_bench_print_header() {
+    print(ss("algo,dist,len,reps,median_cycles,p95_cycles,median_cycles_per_elem,p95_cycles_per_elem\n"));
+}
+
+static void
+sort_bench_print_row(str algo, str dist, uint len, uint reps, SortBenchStats stats) {
+    u8 buf_array[1 << 8];
+    FormatBuffer buf;
+    init_fmt_buffer(&buf, make_span_u8(buf_array, sizeof(buf_array)));
+
+    unsafe_fmt_buffer_put_str(&buf, algo);
+    unsafe_fmt_buffer_put_byte(&buf, ',');
+    unsafe_fmt_buffer_put_str(&buf, dist);
+    unsafe_fmt_buffer_put_byte(&buf, ',');
+    unsafe_fmt_buffer_put_dec_u64(&buf, len);
+    unsafe_fmt_buffer_put_byte(&buf, ',');
+    unsafe_fmt_buffer_put_dec_u64(&buf, reps);
+    unsafe_fmt_buffer_put_byte(&buf, ',');
+    unsafe_fmt_buffer_put_dec_u64(&buf, stats.median);
+    unsafe_fmt_buffer_put_byte(&buf, ',');
+    unsafe_fmt_buffer_put_dec_u64(&buf, stats.p95);
+    unsafe_fmt_buffer_put_byte(&buf, ',');
+    sort_bench_put_centi(&buf, stats.median * 100 / len);
+    unsafe_fmt_buffer_put_byte(&buf, ',');
+    sort_bench_put_centi(&buf, stats.p95 * 100 / len);
+    unsafe_fmt_buffer_put_newline(&buf);
+
+    print(fmt_buffer_head(&buf));
+}
+
+#define SORT_BENCH_MAX_REPS 101
+
+uint main(uint argc, u8** argv, u8** envp) {
+    init_proc_mem_bump_allocator();
+    ErrorCode code = init_os_proc_input(argc, argv, envp);
+    if (code != 0) {
+        return code;
+    }
+
+    uint max_log2_len = 24;
+    if (os_proc_input.args.len >= 2) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[1]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        max_log2_len = r.n;
+    }
+    if (max_log2_len < 4 || max_log2_len > 28) {
+        print(ss("max length must be in range [4, 28] (log2)\n"));
+        return 2;
+    }
+
+    uint max_reps = 21;
+    if (os_proc_input.args.len >= 3) {
+        RetParseU64 r = parse_dec_u64(os_proc_input.args.ptr[2]);
+        if (r.code != 0) {
+            return r.code;
+        }
+        max_reps = r.n;
+    }
+    if (max_reps == 0 || max_reps > SORT_BENCH_MAX_REPS) {
+        print(ss("number of repetitions must be in range [1, 101]\n"));
+        return 2;
+    }
+
+    sort_bench_threads = os_cpu_count();
+
+    const uint max_len = cast(uint, 1) << max_log2_len;
+    MemBlock block = {};
+    block.span.len = 2 * max_len * sizeof(s64);
+    code = os_linux_mem_alloc(&block);
+    if (code != 0) {
+        print(ss("not enough memory\n"));
+        return code;
+    }
+    s64* data = cast(s64*, block.span.ptr);
+    s64* scratch = data + max_len;
+
+    u64 samples_buf[SORT_BENCH_MAX_REPS];
+
+    // marks (algorithm, distribution) pairs which became too slow
+    bool skip[array_len(sort_bench_algos)][SORT_BENCH_NUM_DIST] = {};
+
+    sort_bench_print_header();
+    for (uint log2_len = 4; log2_len <= max_log2_len; log2_len += 2) {
+        const uint len = cast(uint, 1) << log2_len;
+        uint reps = max_uint(1, min_uint(max_reps, SORT_BENCH_ELEMS_PER_CELL / len));
+
+        for (uint a = 0; a < array_len(sort_bench_algos); a += 1) {
+            const SortBenchAlgo* algo = &sort_bench_algos[a];
+            if (len > algo->max_len) {
+                continue;
+            }
+
+            for (uint d = 0; d < SORT_BENCH_NUM_DIST; d += 1) {
+                if (skip[a][d]) {
+                    continue;
+                }
+
+                span_s64 s = make_span_s64(data, len);
+                for (uint r = 0; r < reps; r += 1) {
+                    sort_bench_fill(s, d, 123 + r);
+
+                    u64 start = cpu_clock();
+                    algo->fn(s, make_span_s64(scratch, len));
+                    samples_buf[r] = cpu_clock() - start;
+
+                    if (!is_sorted_asc_s64(s)) {
+                        print(ss("not sorted: "));
+                        print(algo->name);
+                        print(ss("\n"));
+                        return 1;
+                    }
+                }
+
+                SortBenchStats stats = sort_bench_stats(make_span_u64(samples_buf, reps));
+                sort_bench_print_row(algo->name, sort_bench_dist_names[d], len, reps, stats);
+                if (stats.median / len > SORT_BENCH_MAX_CYCLES_PER_ELEM) {
+                    skip[a][d] = true;
+                }
+            }
+        }
+    }
+
+    os_linux_mem_free(block);
+    return 0;
+}
@@ -38,7 +38,7 @@ png_read_chunk(span_u8 data, PngChunk *chunk) {
 }
 
 static void
-png_print_chunk_ihdr(span_u8 data) {
+png_print_chunk_ihdr(StrBuilder* b, span_u8 data) {
     if (data.len < 13) {
         return;
     }
@@ -51,40 +51,35 @@ png_print_chunk_ihdr(span_u8 data) {
     u8 filter = data.ptr[11];
     u8 interlace = data.ptr[12];
 
-    u8 buf_array[1 << 12];
-    FormatBuffer buf;
-    init_fmt_buffer(&buf, make_span_u8(buf_array, sizeof(buf_array)));
-    
-    unsafe_fmt_buffer_put_str(&buf, ss("width: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, width);
-    unsafe_fmt_buffer_put_newline(&buf);
+    str_builder_put_str(b, ss("width: "));
+    str_builder_put_dec_u64(b, width);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_str(&buf, ss("height: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, height);
-    unsafe_fmt_buffer_put_newline(&buf);
+    str_builder_put_str(b, ss("height: "));
+    str_builder_put_dec_u64(b, height);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_str(&buf, ss("bit depth: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, bit_depth);
-    unsafe_fmt_buffer_put_newline(&buf);
+    str_builder_put_str(b, ss("bit depth: "));
+    str_builder_put_dec_u64(b, bit_depth);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_str(&buf, ss("color type: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, color_type);
-    unsafe_fmt_buffer_put_newline(&buf);
+    str_builder_put_str(b, ss("color type: "));
+    str_builder_put_dec_u64(b, color_type);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_str(&buf, ss("compression: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, compression);
-    unsafe_fmt_buffer_put_newline(&buf);
-    
-    unsafe_fmt_buffer_put_str(&buf, ss("filter: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, filter);
-    unsafe_fmt_buffer_put_newline(&buf);
-    
-    unsafe_fmt_buffer_put_str(&buf, ss("interlace: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, interlace);
-    unsafe_fmt_buffer_put_newline(&buf);
+    str_builder_put_str(b, ss("compression: "));
+    str_builder_put_dec_u64(b, compression);
+    str_builder_put_newline(b);
+
+    str_builder_put_str(b, ss("filter: "));
+    str_builder_put_dec_u64(b, filter);
+    str_builder_put_newline(b);
+
+    str_builder_put_str(b, ss("interlace: "));
+    str_builder_put_dec_u64(b, interlace);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_newline(&buf);
-    print(fmt_buffer_head(&buf));    
+    str_builder_put_newline(b);
 }
 
 typedef struct {
@@ -102,7 +97,7 @@ typedef struct {
 } PngBitStream;
 
 static void
-png_print_chunk_idat(span_u8 data) {
+png_print_chunk_idat(StrBuilder* b, span_u8 data) {
     if (data.len < 4) {
         return;
     }
@@ -110,44 +105,33 @@ png_print_chunk_idat(span_u8 data) {
     u8 method = data.ptr[0];
     u8 flags = data.ptr[1];
 
-    u8 buf_array[1 << 12];
-    FormatBuffer buf;
-    init_fmt_buffer(&buf, make_span_u8(buf_array, sizeof(buf_array)));
+    str_builder_put_str(b, ss("method: "));
+    str_builder_put_bin_byte(b, method);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_str(&buf, ss("method: "));
-    unsafe_fmt_buffer_put_bin_byte(&buf, method);
-    unsafe_fmt_buffer_put_newline(&buf);
-    
-    unsafe_fmt_buffer_put_str(&buf, ss("flags: "));
-    unsafe_fmt_buffer_put_bin_byte(&buf, flags);
-    unsafe_fmt_buffer_put_newline(&buf);
+    str_builder_put_str(b, ss("flags: "));
+    str_builder_put_bin_byte(b, flags);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_newline(&buf);
-    print(fmt_buffer_head(&buf));
+    str_builder_put_newline(b);
 }
 
 static void
-png_print_chunk(PngChunk chunk) {
-    u8 buf_array[1 << 12];
-    FormatBuffer buf;
-    init_fmt_buffer(&buf, make_span_u8(buf_array, sizeof(buf_array)));
-    
-    unsafe_fmt_buffer_put_str(&buf, ss("type: "));
-    unsafe_fmt_buffer_put_hex_prefix_zeroes_u32(&buf, chunk.type);
-    unsafe_fmt_buffer_put_newline(&buf);
+png_print_chunk(StrBuilder* b, PngChunk chunk) {
+    str_builder_put_str(b, ss("type: "));
+    str_builder_put_hex_prefix_zeroes_u32(b, chunk.type);
+    str_builder_put_newline(b);
 
-    unsafe_fmt_buffer_put_str(&buf, ss("len: "));
-    unsafe_fmt_buffer_put_dec_u64(&buf, chunk.data.len);
-    unsafe_fmt_buffer_put_newline(&buf);
-    
-    print(fmt_buffer_head(&buf));
+    str_builder_put_str(b, ss("len: "));
+    str_builder_put_dec_u64(b, chunk.data.len);
+    str_builder_put_newline(b);
 
     switch (chunk.type) {
     case PNG_CHUNK_IHDR:
-        png_print_chunk_ihdr(chunk.data);
+        png_print_chunk_ihdr(b, chunk.data);
         break;
     case PNG_CHUNK_IDAT:
-        png_print_chunk_idat(chunk.data);
+        png_print_chunk_idat(b, chunk.data);
         break;
     case PNG_CHUNK_IEND:
         // always has length 0
@@ -157,8 +141,12 @@ png_print_chunk(PngChunk chunk) {
     }
 }
 
+/*/doc
+
+Puts description of all chunks into string builder.
+*/
 static void
-png_print(span_u8 data) {
+png_print(StrBuilder* b, span_u8 data) {
     if (!str_has_prefix(data, make_span_u8(cast(u8*, png_magic), PNG_MAGIC_LENGTH))) {
         // Error here
         return;
@@ -173,7 +161,7 @@ png_print(span_u8 data) {
             break;
         }
         tail = span_u8_slice_tail(tail, n);
-        png_print_chunk(chunk); // TODO: remove debug print
+        png_print_chunk(b, chunk); // TODO: remove debug print
 
         if (chunk.type == PNG_CHUNK_IEND) {
             return;
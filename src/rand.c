@@ -44,6 +44,34 @@ biski64_seed(Biski64State* state, u64 seed) {
     biski64_warmup(state);
 }
 
+// Distance between streams along Weyl sequence of {fast_loop} field,
+// measured in generator steps.
+#define BISKI64_STREAM_STEPS (cast(u64, 1) << 40)
+
+/*/doc
+
+Initializes generator for one of independent streams derived from a given seed.
+All streams share {mix} and {loop_mix} initial values, while {fast_loop} of
+stream {k} starts {k * 2^40} steps further along its Weyl sequence.
+Two generators can only reach the same state when their {fast_loop}
+values are equal. Thus streams do not overlap as long as each of them produces
+less than 2^40 outputs, for up to 2^24 streams.
+
+Stream 0 starts from the same state as {biski64_seed(...)} with the same seed.
+*/
+static void
+biski64_seed_stream(Biski64State* state, u64 seed, u64 stream) {
+    must(stream < (cast(u64, 1) << 24));
+    u64 seeder_state = seed;
+
+    state->mix       = biski64_splitmix(&seeder_state);
+    state->loop_mix  = biski64_splitmix(&seeder_state);
+    state->fast_loop = biski64_splitmix(&seeder_state);
+    state->fast_loop += stream * BISKI64_STREAM_STEPS * 0x9999999999999999ULL;
+
+    biski64_warmup(state);
+}
+
 /*/doc
 
 Fills span of integers with randomly generated numbers.
@@ -54,3 +82,232 @@ biski64_fill_s64(Biski64State* state, span_s64 s) {
         s.ptr[i] = cast(s64, biski64_next(state));
     }
 }
+
+#define BISKI64X8_LANES 8
+
+/*/doc
+
+Eight independent biski64 generators, advanced together in vector registers.
+State is stored lane by lane (structure of arrays).
+
+Output layout does not depend on instruction set: element {i} of filled
+span is the {i / 8}-th output of lane {i % 8}. AVX-512, AVX2 and baseline
+code paths produce bit-identical results. Each lane can be extracted
+and continued as a scalar generator with {biski64x8_lane(...)}.
+
+Related:
+    +biski64x8_seed(...)
+    .biski64x8_fill_s64(...)
+*/
+typedef struct {
+    u64 fast_loop[BISKI64X8_LANES];
+    u64 mix[BISKI64X8_LANES];
+    u64 loop_mix[BISKI64X8_LANES];
+} Biski64x8State;
+
+/*/doc
+
+Each lane is initialized from its own portion of splitmix sequence started
+from a given seed, lanes do not overlap in practice.
+*/
+static void
+biski64x8_seed(Biski64x8State* state, u64 seed) {
+    u64 seeder_state = seed;
+
+    for (uint l = 0; l < BISKI64X8_LANES; l += 1) {
+        Biski64State lane;
+        lane.mix       = biski64_splitmix(&seeder_state);
+        lane.loop_mix  = biski64_splitmix(&seeder_state);
+        lane.fast_loop = biski64_splitmix(&seeder_state);
+        biski64_warmup(&lane);
+
+        state->fast_loop[l] = lane.fast_loop;
+        state->mix[l] = lane.mix;
+        state->loop_mix[l] = lane.loop_mix;
+    }
+}
+
+/*/doc
+
+Initializes lanes from streams {8 * stream}, ..., {8 * stream + 7}
+of a given seed, see {biski64_seed_stream(...)}.
+*/
+static void
+biski64x8_seed_stream(Biski64x8State* state, u64 seed, u64 stream) {
+    for (uint l = 0; l < BISKI64X8_LANES; l += 1) {
+        Biski64State lane;
+        biski64_seed_stream(&lane, seed, BISKI64X8_LANES * stream + l);
+
+        state->fast_loop[l] = lane.fast_loop;
+        state->mix[l] = lane.mix;
+        state->loop_mix[l] = lane.loop_mix;
+    }
+}
+
+/*/doc
+
+Returns scalar generator which continues sequence of a given lane.
+*/
+static Biski64State
+biski64x8_lane(const Biski64x8State* state, uint l) {
+    must(l < BISKI64X8_LANES);
+
+    Biski64State lane;
+    lane.fast_loop = state->fast_loop[l];
+    lane.mix = state->mix[l];
+    lane.loop_mix = state->loop_mix[l];
+    return lane;
+}
+
+#define BISKI64X8_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/*/doc
+
+Generates function which produces {n} outputs from each lane and stores
+them interleaved into {out} (8 * n integers). Lane step is the same as
+in {biski64_next(...)}.
+
+Lanes are held in 8 / W vectors of type V with W lanes each, so that
+every vector fits into machine register of the target. Baseline variant
+uses plain integers (W = 1).
+*/
+#define BISKI64X8_DEFINE_FILL(NAME, V, W, ATTR) \
+ATTR static void \
+NAME(Biski64x8State* state, u64* out, uint n) { \
+    V fast_loop[BISKI64X8_LANES / W]; \
+    V mix[BISKI64X8_LANES / W]; \
+    V loop_mix[BISKI64X8_LANES / W]; \
+    for (uint j = 0; j < BISKI64X8_LANES / W; j += 1) { \
+        simd_load(fast_loop[j], state->fast_loop + j * W); \
+        simd_load(mix[j], state->mix + j * W); \
+        simd_load(loop_mix[j], state->loop_mix + j * W); \
+    } \
+\
+    for (uint i = 0; i < n; i += 1) { \
+        for (uint j = 0; j < BISKI64X8_LANES / W; j += 1) { \
+            V output = mix[j] + loop_mix[j]; \
+            V old_loop_mix = loop_mix[j]; \
+            loop_mix[j] = fast_loop[j] ^ mix[j]; \
+            mix[j] = BISKI64X8_ROTL(mix[j], 16) + BISKI64X8_ROTL(old_loop_mix, 40); \
+            fast_loop[j] += 0x9999999999999999ULL; \
+            simd_store(out + BISKI64X8_LANES * i + j * W, output); \
+        } \
+    } \
+\
+    for (uint j = 0; j < BISKI64X8_LANES / W; j += 1) { \
+        simd_store(state->fast_loop + j * W, fast_loop[j]); \
+        simd_store(state->mix + j * W, mix[j]); \
+        simd_store(state->loop_mix + j * W, loop_mix[j]); \
+    } \
+}
+
+BISKI64X8_DEFINE_FILL(biski64x8_fill_avx512, vec8_u64, 8, TARGET_AVX512)
+BISKI64X8_DEFINE_FILL(biski64x8_fill_avx2, vec4_u64, 4, TARGET_AVX2)
+BISKI64X8_DEFINE_FILL(biski64x8_fill_base, u64, 1, )
+
+static void
+biski64x8_fill(Biski64x8State* state, u64* out, uint n) {
+    if (cpu_has_feature(CPU_FEATURE_AVX512)) {
+        biski64x8_fill_avx512(state, out, n);
+    } else if (cpu_has_feature(CPU_FEATURE_AVX2)) {
+        biski64x8_fill_avx2(state, out, n);
+    } else {
+        biski64x8_fill_base(state, out, n);
+    }
+}
+
+/*/doc
+
+Fills span of integers with randomly generated numbers. Every lane is advanced
+by ceil(s.len / 8) steps, when span length is not a multiple of 8, outputs of
+the last step which did not fit into span are discarded.
+*/
+static void
+biski64x8_fill_s64(Biski64x8State* state, span_s64 s) {
+    const uint full = s.len / BISKI64X8_LANES;
+    biski64x8_fill(state, cast(u64*, s.ptr), full);
+
+    const uint tail = s.len % BISKI64X8_LANES;
+    if (tail == 0) {
+        return;
+    }
+    u64 buf[BISKI64X8_LANES];
+    biski64x8_fill(state, buf, 1);
+    for (uint i = 0; i < tail; i += 1) {
+        s.ptr[full * BISKI64X8_LANES + i] = cast(s64, buf[i]);
+    }
+}
+
+// Parallel fill splits span into blocks of this length,
+// each block is generated by its own stream.
+#define BISKI64_FILL_BLOCK_LEN (1 << 16)
+
+#define BISKI64_FILL_MAX_THREADS 64
+
+typedef struct {
+    span_s64 s;
+    u64 seed;
+
+    // Range of blocks filled by this task.
+    uint block_start;
+    uint block_end;
+} Biski64FillTask;
+
+static void
+biski64_fill_block_range(void* arg) {
+    Biski64FillTask* t = arg;
+
+    for (uint b = t->block_start; b < t->block_end; b += 1) {
+        uint start = b * BISKI64_FILL_BLOCK_LEN;
+        uint len = min_uint(BISKI64_FILL_BLOCK_LEN, t->s.len - start);
+
+        Biski64x8State state;
+        biski64x8_seed_stream(&state, t->seed, b);
+        biski64x8_fill_s64(&state, make_span_s64(t->s.ptr + start, len));
+    }
+}
+
+/*/doc
+
+Fills span of integers with randomly generated numbers using {num_threads}
+threads. Span is split into fixed blocks of BISKI64_FILL_BLOCK_LEN integers,
+block {b} is filled by {Biski64x8State} seeded from stream {b}.
+Output depends only on seed and span length, it is bit-identical
+for any number of threads.
+
+Number of threads is clamped to range [1, BISKI64_FILL_MAX_THREADS].
+*/
+static void
+biski64_fill_s64_parallel(u64 seed, span_s64 s, uint num_threads) {
+    const uint num_blocks = (s.len + BISKI64_FILL_BLOCK_LEN - 1) / BISKI64_FILL_BLOCK_LEN;
+    num_threads = max_uint(1, min_uint(num_threads, BISKI64_FILL_MAX_THREADS));
+    num_threads = min_uint(num_threads, max_uint(num_blocks, 1));
+
+    Biski64FillTask tasks[BISKI64_FILL_MAX_THREADS];
+    OsThread threads[BISKI64_FILL_MAX_THREADS];
+    bool started[BISKI64_FILL_MAX_THREADS];
+
+    for (uint i = 0; i < num_threads; i += 1) {
+        tasks[i].s = s;
+        tasks[i].seed = seed;
+        tasks[i].block_start = num_blocks * i / num_threads;
+        tasks[i].block_end = num_blocks * (i + 1) / num_threads;
+    }
+
+    for (uint i = 1; i < num_threads; i += 1) {
+        ErrorCode code = os_thread_start(&threads[i], biski64_fill_block_range, &tasks[i]);
+        started[i] = code == 0;
+        if (!started[i]) {
+            // not enough resources for a thread, do its work here
+            biski64_fill_block_range(&tasks[i]);
+        }
+    }
+
+    biski64_fill_block_range(&tasks[0]);
+
+    for (uint i = 1; i < num_threads; i += 1) {
+        if (started[i]) {
+            os_thread_join(&threads[i]);
+        }
+    }
+}
@@ -0,0 +1,573 @@
+/*/doc
+
+Samplers of common distributions on top of {Biski64State}: bounded integers,
+uniform floats, normal and exponential distributions, and shuffle of spans.
+Depends on rand.c.
+
+Span fill functions draw raw integers from generator in chunks and convert
+them in a separate loop. Generator step depends on previous one and thus
+cannot be vectorized, while conversion of uniform floats has no dependencies
+between iterations and is written with vector types.
+
+There is no math library, functions exp, log and sqrt used by samplers
+are implemented below. They are accurate to a few units in the last place,
+which is enough for sampling.
+*/
+
+// Number of raw integers drawn from generator at once by span fill functions.
+#define DIST_CHUNK_LEN 256
+
+#define DIST_LN2_HI 6.93147180369123816490e-01
+#define DIST_LN2_LO 1.90821492927058770002e-10
+#define DIST_LOG2E  1.44269504088896338700e+00
+#define DIST_SQRT2  1.41421356237309504880e+00
+
+static f64
+dist_f64_from_bits(u64 x) {
+    f64 f;
+    __builtin_memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static u64
+dist_f64_to_bits(f64 f) {
+    u64 x;
+    __builtin_memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+static f64
+dist_abs(f64 x) {
+    return dist_f64_from_bits(dist_f64_to_bits(x) & 0x7fffffffffffffffULL);
+}
+
+static f32
+dist_f32_from_bits(u32 x) {
+    f32 f;
+    __builtin_memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+/*/doc
+
+Returns e^x. Argument is split as x = k * ln(2) + r, where |r| <= ln(2) / 2,
+then e^r is computed by Taylor series and scaled by 2^k.
+Returns 0 for x < -708, argument must not be greater than 709.
+*/
+static f64
+dist_exp(f64 x) {
+    if (x < -708.0) {
+        return 0.0;
+    }
+    must(x <= 709.0);
+
+    const f64 kf = x * DIST_LOG2E + (x < 0.0 ? -0.5 : 0.5);
+    const sint k = cast(sint, kf);
+    const f64 r = (x - cast(f64, k) * DIST_LN2_HI) - cast(f64, k) * DIST_LN2_LO;
+
+    // error term r^14 / 14! is below 2^-53 for |r| <= 0.35
+    f64 p = 1.0 / 6227020800.0;
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    return p * dist_f64_from_bits(cast(u64, k + 1023) << 52);
+}
+
+/*/doc
+
+Returns natural logarithm of x. Argument is split as x = m * 2^e, where
+m is in range [sqrt(2) / 2, sqrt(2)), then ln(m) is computed by series
+
+	ln(m) = 2 * (s + s^3 / 3 + s^5 / 5 + ...), where s = (m - 1) / (m + 1)
+
+Argument must be positive normal number.
+*/
+static f64
+dist_log(f64 x) {
+    must(x > 0.0);
+
+    const u64 bits = dist_f64_to_bits(x);
+    sint e = cast(sint, bits >> 52) - 1023;
+    f64 m = dist_f64_from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    if (m > DIST_SQRT2) {
+        m *= 0.5;
+        e += 1;
+    }
+
+    // |s| < 0.172, error term s^23 / 23 is below 2^-60
+    const f64 s = (m - 1.0) / (m + 1.0);
+    const f64 z = s * s;
+    f64 p = 1.0 / 21.0;
+    p = p * z + 1.0 / 19.0;
+    p = p * z + 1.0 / 17.0;
+    p = p * z + 1.0 / 15.0;
+    p = p * z + 1.0 / 13.0;
+    p = p * z + 1.0 / 11.0;
+    p = p * z + 1.0 / 9.0;
+    p = p * z + 1.0 / 7.0;
+    p = p * z + 1.0 / 5.0;
+    p = p * z + 1.0 / 3.0;
+    p = p * z + 1.0;
+
+    const f64 ef = cast(f64, e);
+    return ef * DIST_LN2_HI + (2.0 * s * p + ef * DIST_LN2_LO);
+}
+
+/*/doc
+
+Returns square root of x by Newton iteration. Only used to compute tables,
+not on sampling path. Argument must be positive normal number.
+*/
+static f64
+dist_sqrt(f64 x) {
+    must(x > 0.0);
+
+    // halving biased exponent and adding half of bias back
+    // gives initial guess within factor of 2
+    f64 g = dist_f64_from_bits((dist_f64_to_bits(x) >> 1) + (cast(u64, 1023) << 51));
+    for (uint i = 0; i < 8; i += 1) {
+        g = 0.5 * (g + x / g);
+    }
+    return g;
+}
+
+/*/doc
+
+Converts random integer into uniform number in range [0, 1). Top 52 bits
+become mantissa of number in range [1, 2), which is then shifted down.
+*/
+static f64
+dist_unit_f64(u64 x) {
+    return dist_f64_from_bits((x >> 12) | 0x3ff0000000000000ULL) - 1.0;
+}
+
+/*/doc
+
+Same as {dist_unit_f64(...)}, but result is in range [-1, 1).
+*/
+static f64
+dist_signed_unit_f64(u64 x) {
+    return dist_f64_from_bits((x >> 12) | 0x4000000000000000ULL) - 3.0;
+}
+
+static f32
+dist_unit_f32(u32 x) {
+    return dist_f32_from_bits((x >> 9) | 0x3f800000) - 1.0f;
+}
+
+/*/doc
+
+Returns uniformly distributed integer in range [0, bound).
+Uses Lemire's multiply-shift method: high half of 128-bit product
+x * bound is the result, low half decides whether x falls into
+biased part of range and must be redrawn. Division happens only
+when low half is less than bound, which is rare for small bounds.
+*/
+static u64
+biski64_bounded(Biski64State* state, u64 bound) {
+    must(bound != 0);
+
+    u128 m = cast(u128, biski64_next(state)) * bound;
+    u64 l = cast(u64, m);
+    if (l < bound) {
+        const u64 t = (0 - bound) % bound;
+        while (l < t) {
+            m = cast(u128, biski64_next(state)) * bound;
+            l = cast(u64, m);
+        }
+    }
+    return cast(u64, m >> 64);
+}
+
+/*/doc
+
+Fills span with uniformly distributed integers in range [0, bound).
+Same as calling {biski64_bounded(...)} for each element, rejection
+threshold is computed once for the whole span.
+*/
+static void
+biski64_fill_bounded_u64(Biski64State* state, span_u64 s, u64 bound) {
+    must(bound != 0);
+
+    const u64 t = (0 - bound) % bound;
+    for (uint i = 0; i < s.len; i += 1) {
+        u128 m = cast(u128, biski64_next(state)) * bound;
+        while (cast(u64, m) < t) {
+            m = cast(u128, biski64_next(state)) * bound;
+        }
+        s.ptr[i] = cast(u64, m >> 64);
+    }
+}
+
+/*/doc
+
+Returns uniformly distributed number in range [0, 1) with 52 bits of precision.
+*/
+static f64
+biski64_f64(Biski64State* state) {
+    return dist_unit_f64(biski64_next(state));
+}
+
+static void
+biski64_fill_f64(Biski64State* state, span_f64 s) {
+    u64 buf[DIST_CHUNK_LEN];
+    for (uint i = 0; i < s.len; i += DIST_CHUNK_LEN) {
+        const uint n = min_uint(DIST_CHUNK_LEN, s.len - i);
+        for (uint j = 0; j < n; j += 1) {
+            buf[j] = biski64_next(state);
+        }
+
+        f64* out = s.ptr + i;
+        uint j = 0;
+        for (; j + 4 <= n; j += 4) {
+            vec4_u64 x;
+            simd_load(x, buf + j);
+            vec4_f64 f = cast(vec4_f64, (x >> 12) | 0x3ff0000000000000ULL) - 1.0;
+            simd_store(out + j, f);
+        }
+        for (; j < n; j += 1) {
+            out[j] = dist_unit_f64(buf[j]);
+        }
+    }
+}
+
+/*/doc
+
+Fills span with uniformly distributed numbers in range [0, 1) with 23 bits
+of precision. Each generator output yields two numbers.
+*/
+static void
+biski64_fill_f32(Biski64State* state, span_f32 s) {
+    u32 buf[2 * DIST_CHUNK_LEN];
+    for (uint i = 0; i < s.len; i += 2 * DIST_CHUNK_LEN) {
+        const uint n = min_uint(2 * DIST_CHUNK_LEN, s.len - i);
+        for (uint j = 0; j < n; j += 2) {
+            const u64 x = biski64_next(state);
+            buf[j] = cast(u32, x);
+            buf[j + 1] = cast(u32, x >> 32);
+        }
+
+        f32* out = s.ptr + i;
+        uint j = 0;
+        for (; j + 8 <= n; j += 8) {
+            vec8_u32 x;
+            simd_load(x, buf + j);
+            vec8_f32 f = cast(vec8_f32, (x >> 9) | 0x3f800000) - 1.0f;
+            simd_store(out + j, f);
+        }
+        for (; j < n; j += 1) {
+            out[j] = dist_unit_f32(buf[j]);
+        }
+    }
+}
+
+/*/doc
+
+Tables for ziggurat method of Marsaglia and Tsang. Area under density
+function is covered by C layers of equal area V: top C - 1 layers are
+rectangles, bottom layer is a rectangle of width R together with
+the tail beyond R. Layer i spans x in range [0, x[i]] and density
+values between f[i] and f[i + 1], with x[1] = R and x[C] = 0.
+Bottom layer uses x[0] = V / f(R), width of rectangle with the same
+area as bottom layer.
+
+Sample picks layer i and point u * x[i]. If it lies inside part of layer
+covered by layer above (ratio q[i]), it is accepted immediately, which
+happens most of the time.
+*/
+typedef struct {
+    f64 x[257];
+    f64 f[257];
+    f64 q[256];
+} DistZiggurat;
+
+// Normal distribution, 128 layers.
+#define DIST_NORMAL_LAYERS 128
+#define DIST_NORMAL_R 3.442619855899
+#define DIST_NORMAL_V 9.91256303526217e-3
+
+// Exponential distribution, 256 layers.
+#define DIST_EXP_LAYERS 256
+#define DIST_EXP_R 7.697117470131487
+#define DIST_EXP_V 3.949659822581572e-3
+
+static DistZiggurat dist_normal_table;
+static DistZiggurat dist_exp_table;
+
+// Set when ziggurat tables are computed.
+static u32 dist_tables_ready;
+
+static f64
+dist_normal_density(f64 x) {
+    return dist_exp(-0.5 * x * x);
+}
+
+static void
+dist_init_ziggurat(DistZiggurat* t, uint c, f64 r, f64 v, bool normal) {
+    const f64 fr = normal ? dist_normal_density(r) : dist_exp(-r);
+    t->x[0] = v / fr;
+    t->x[1] = r;
+    t->f[0] = 0.0;
+    t->f[1] = fr;
+    for (uint i = 2; i < c; i += 1) {
+        // layer i - 1 has area v, its top edge is at density f[i]
+        const f64 y = v / t->x[i - 1] + t->f[i - 1];
+        t->x[i] = normal ? dist_sqrt(-2.0 * dist_log(y)) : -dist_log(y);
+        t->f[i] = y;
+    }
+    t->x[c] = 0.0;
+    t->f[c] = 1.0;
+    for (uint i = 0; i < c; i += 1) {
+        t->q[i] = t->x[i + 1] / t->x[i];
+    }
+}
+
+/*/doc
+
+Computes ziggurat tables on first call. Concurrent first calls compute
+identical tables, so no locking is needed.
+*/
+static void
+dist_init_tables(void) {
+    if (__atomic_load_n(&dist_tables_ready, __ATOMIC_ACQUIRE) != 0) {
+        return;
+    }
+
+    dist_init_ziggurat(&dist_normal_table, DIST_NORMAL_LAYERS, DIST_NORMAL_R, DIST_NORMAL_V, true);
+    dist_init_ziggurat(&dist_exp_table, DIST_EXP_LAYERS, DIST_EXP_R, DIST_EXP_V, false);
+    __atomic_store_n(&dist_tables_ready, 1, __ATOMIC_RELEASE);
+}
+
+/*/doc
+
+Returns uniform number in range (0, 1], suitable as logarithm argument.
+*/
+static f64
+dist_open_unit_f64(Biski64State* state) {
+    return 1.0 - biski64_f64(state);
+}
+
+/*/doc
+
+Handles rare case of normal sample which falls outside of inner rectangle.
+Draws again if point is rejected.
+*/
+static __attribute__((noinline)) f64
+dist_normal_slow(Biski64State* state, u64 x) {
+    const DistZiggurat* t = &dist_normal_table;
+    while (true) {
+        const uint i = cast(uint, x & (DIST_NORMAL_LAYERS - 1));
+        const f64 u = dist_signed_unit_f64(x);
+        if (dist_abs(u) < t->q[i]) {
+            return u * t->x[i];
+        }
+
+        if (i == 0) {
+            // tail beyond R, method by Marsaglia
+            f64 a;
+            f64 b;
+            do {
+                a = -dist_log(dist_open_unit_f64(state)) / DIST_NORMAL_R;
+                b = -dist_log(dist_open_unit_f64(state));
+            } while (b + b < a * a);
+            return u < 0.0 ? -(DIST_NORMAL_R + a) : DIST_NORMAL_R + a;
+        }
+
+        const f64 p = u * t->x[i];
+        const f64 y = t->f[i] + biski64_f64(state) * (t->f[i + 1] - t->f[i]);
+        if (y < dist_normal_density(p)) {
+            return p;
+        }
+        x = biski64_next(state);
+    }
+}
+
+/*/doc
+
+Converts random integer into standard normal sample. Low 7 bits select layer,
+top 52 bits give point within it.
+*/
+static f64
+dist_normal(Biski64State* state, u64 x) {
+    const DistZiggurat* t = &dist_normal_table;
+    const uint i = cast(uint, x & (DIST_NORMAL_LAYERS - 1));
+    const f64 u = dist_signed_unit_f64(x);
+    if (__builtin_expect(dist_abs(u) < t->q[i], 1)) {
+        return u * t->x[i];
+    }
+    return dist_normal_slow(state, x);
+}
+
+/*/doc
+
+Returns sample of standard normal distribution (mean 0, variance 1).
+*/
+static f64
+biski64_normal(Biski64State* state) {
+    dist_init_tables();
+    return dist_normal(state, biski64_next(state));
+}
+
+static void
+biski64_fill_normal_f64(Biski64State* state, span_f64 s) {
+    dist_init_tables();
+
+    u64 buf[DIST_CHUNK_LEN];
+    for (uint i = 0; i < s.len; i += DIST_CHUNK_LEN) {
+        const uint n = min_uint(DIST_CHUNK_LEN, s.len - i);
+        for (uint j = 0; j < n; j += 1) {
+            buf[j] = biski64_next(state);
+        }
+
+        f64* out = s.ptr + i;
+        for (uint j = 0; j < n; j += 1) {
+            out[j] = dist_normal(state, buf[j]);
+        }
+    }
+}
+
+static __attribute__((noinline)) f64
+dist_exponential_slow(Biski64State* state, u64 x) {
+    const DistZiggurat* t = &dist_exp_table;
+    while (true) {
+        const uint i = cast(uint, x & (DIST_EXP_LAYERS - 1));
+        const f64 u = dist_unit_f64(x);
+        if (u < t->q[i]) {
+            return u * t->x[i];
+        }
+
+        if (i == 0) {
+            // distribution is memoryless, tail is shifted exponential
+            return DIST_EXP_R - dist_log(dist_open_unit_f64(state));
+        }
+
+        const f64 p = u * t->x[i];
+        const f64 y = t->f[i] + biski64_f64(state) * (t->f[i + 1] - t->f[i]);
+        if (y < dist_exp(-p)) {
+            return p;
+        }
+        x = biski64_next(state);
+    }
+}
+
+/*/doc
+
+Converts random integer into exponential sample. Low 8 bits select layer,
+top 52 bits give point within it.
+*/
+static f64
+dist_exponential(Biski64State* state, u64 x) {
+    const DistZiggurat* t = &dist_exp_table;
+    const uint i = cast(uint, x & (DIST_EXP_LAYERS - 1));
+    const f64 u = dist_unit_f64(x);
+    if (__builtin_expect(u < t->q[i], 1)) {
+        return u * t->x[i];
+    }
+    return dist_exponential_slow(state, x);
+}
+
+/*/doc
+
+Returns sample of exponential distribution with rate 1 (mean 1).
+*/
+static f64
+biski64_exponential(Biski64State* state) {
+    dist_init_tables();
+    return dist_exponential(state, biski64_next(state));
+}
+
+static void
+biski64_fill_exponential_f64(Biski64State* state, span_f64 s) {
+    dist_init_tables();
+
+    u64 buf[DIST_CHUNK_LEN];
+    for (uint i = 0; i < s.len; i += DIST_CHUNK_LEN) {
+        const uint n = min_uint(DIST_CHUNK_LEN, s.len - i);
+        for (uint j = 0; j < n; j += 1) {
+            buf[j] = biski64_next(state);
+        }
+
+        f64* out = s.ptr + i;
+        for (uint j = 0; j < n; j += 1) {
+            out[j] = dist_exponential(state, buf[j]);
+        }
+    }
+}
+
+/*/doc
+
+Generates Fisher-Yates shuffle for span type span_T:
+
+	static void biski64_shuffle_T(Biski64State* state, span_T s)
+
+While span is shorter than 2^32, two swap indices are taken from one
+generator output (batched ranged generation by Brackett-Rozinsky and Lemire):
+output is multiplied by i + 1, high half gives the first index, low half
+is multiplied by i and gives the second one. Remaining low half serves
+the same rejection test as in {biski64_bounded(...)} with bound (i + 1) * i.
+*/
+#define DIST_SHUFFLE_DEFINE(T) \
+static void \
+biski64_shuffle_##T(Biski64State* state, span_##T s) { \
+    T* a = s.ptr; \
+    uint i = s.len; \
+    if (i < 2) { \
+        return; \
+    } \
+    i -= 1; \
+\
+    /* index i is swapped with random index in range [0, i] */ \
+    for (; i > 0xffffffff; i -= 1) { \
+        const uint j = biski64_bounded(state, i + 1); \
+        T c = a[i]; \
+        a[i] = a[j]; \
+        a[j] = c; \
+    } \
+\
+    for (; i >= 2; i -= 2) { \
+        const u64 b1 = i + 1; \
+        const u64 b2 = i; \
+        const u64 bound = b1 * b2; \
+\
+        u128 m1 = cast(u128, biski64_next(state)) * b1; \
+        u128 m2 = cast(u128, cast(u64, m1)) * b2; \
+        if (cast(u64, m2) < bound) { \
+            const u64 t = (0 - bound) % bound; \
+            while (cast(u64, m2) < t) { \
+                m1 = cast(u128, biski64_next(state)) * b1; \
+                m2 = cast(u128, cast(u64, m1)) * b2; \
+            } \
+        } \
+\
+        const uint j1 = cast(uint, m1 >> 64); \
+        const uint j2 = cast(uint, m2 >> 64); \
+        T c = a[i]; \
+        a[i] = a[j1]; \
+        a[j1] = c; \
+        c = a[i - 1]; \
+        a[i - 1] = a[j2]; \
+        a[j2] = c; \
+    } \
+\
+    if (i == 1) { \
+        const uint j = cast(uint, biski64_next(state) >> 63); \
+        T c = a[1]; \
+        a[1] = a[j]; \
+        a[j] = c; \
+    } \
+}
+
+DIST_SHUFFLE_DEFINE(s64)
+DIST_SHUFFLE_DEFINE(u64)
+DIST_SHUFFLE_DEFINE(u32)
@@ -0,0 +1,195 @@
+/*/doc
+
+Search routines over sorted integer spans.
+
+Binary search is branchless: each step is a conditional move instead of
+a jump, thus there are no mispredictions. On large spans each step still
+waits for a cache miss, batched variants hide this latency by interleaving
+many independent queries.
+
+Eytzinger layout stores sorted span in breadth-first order of implicit
+binary search tree: children of node k are at 2k and 2k + 1. Top levels
+of the tree are packed into a few cache lines, and descendants of a node
+several levels below are adjacent in memory, so they can be prefetched
+ahead of time.
+
+Layout is 1-based: element at index 0 is not used, span for n elements
+must have length n + 1.
+*/
+
+// Number of queries processed together by batched search.
+#define SEARCH_BATCH_LEN 16
+
+// Eytzinger search prefetches descendants this many levels below
+// current node. Those are 2^4 = 16 consecutive elements.
+#define SEARCH_EYTZINGER_PREFETCH_LEVELS 4
+
+/*/doc
+
+Generates search functions for span type span_T:
+
+	static uint lower_bound_T(span_T s, T x)
+	static uint upper_bound_T(span_T s, T x)
+	static void lower_bound_batch_T(span_T s, span_T queries, span_uint out)
+	static void eytzinger_build_T(span_T sorted, span_T out)
+	static uint eytzinger_lower_bound_T(span_T e, T x)
+	static void eytzinger_lower_bound_batch_T(span_T e, span_T queries, span_uint out)
+*/
+#define SEARCH_DEFINE(T) \
+/* Returns index of the first element not less than x, or s.len if */ \
+/* there is no such element. */ \
+static uint \
+lower_bound_##T(span_##T s, T x) { \
+    if (s.len == 0) { \
+        return 0; \
+    } \
+\
+    const T* base = s.ptr; \
+    uint n = s.len; \
+    while (n > 1) { \
+        uint half = n >> 1; \
+        base += cast(uint, base[half] < x) * half; \
+        n -= half; \
+    } \
+    return cast(uint, base - s.ptr) + cast(uint, *base < x); \
+} \
+\
+/* Returns index of the first element greater than x, or s.len if */ \
+/* there is no such element. */ \
+static uint \
+upper_bound_##T(span_##T s, T x) { \
+    if (s.len == 0) { \
+        return 0; \
+    } \
+\
+    const T* base = s.ptr; \
+    uint n = s.len; \
+    while (n > 1) { \
+        uint half = n >> 1; \
+        base += cast(uint, base[half] <= x) * half; \
+        n -= half; \
+    } \
+    return cast(uint, base - s.ptr) + cast(uint, *base <= x); \
+} \
+\
+/* Same as lower_bound_T for each query, result for query i */ \
+/* is stored in out.ptr[i]. Queries go in groups through the same */ \
+/* sequence of steps, loads of different queries overlap. */ \
+static void \
+lower_bound_batch_##T(span_##T s, span_##T queries, span_uint out) { \
+    must(out.len >= queries.len); \
+\
+    const T* bases[SEARCH_BATCH_LEN]; \
+    for (uint g = 0; g < queries.len; g += SEARCH_BATCH_LEN) { \
+        const uint m = min_uint(SEARCH_BATCH_LEN, queries.len - g); \
+        const T* q = queries.ptr + g; \
+        if (s.len == 0) { \
+            for (uint j = 0; j < m; j += 1) { \
+                out.ptr[g + j] = 0; \
+            } \
+            continue; \
+        } \
+\
+        for (uint j = 0; j < m; j += 1) { \
+            bases[j] = s.ptr; \
+        } \
+        uint n = s.len; \
+        while (n > 1) { \
+            const uint half = n >> 1; \
+            const uint next_half = (n - half) >> 1; \
+            for (uint j = 0; j < m; j += 1) { \
+                bases[j] += cast(uint, bases[j][half] < q[j]) * half; \
+                /* next step of this query loads exactly this element */ \
+                __builtin_prefetch(bases[j] + next_half); \
+            } \
+            n -= half; \
+        } \
+        for (uint j = 0; j < m; j += 1) { \
+            out.ptr[g + j] = cast(uint, bases[j] - s.ptr) + cast(uint, *bases[j] < q[j]); \
+        } \
+    } \
+} \
+\
+static uint \
+eytzinger_fill_##T(const T* src, T* dst, uint i, uint k, uint n) { \
+    if (k > n) { \
+        return i; \
+    } \
+    i = eytzinger_fill_##T(src, dst, i, 2 * k, n); \
+    dst[k] = src[i]; \
+    i += 1; \
+    return eytzinger_fill_##T(src, dst, i, 2 * k + 1, n); \
+} \
+\
+/* Places elements of sorted span into out in Eytzinger order. */ \
+/* Output span must have at least sorted.len + 1 elements. */ \
+static void \
+eytzinger_build_##T(span_##T sorted, span_##T out) { \
+    must(out.len > sorted.len); \
+    eytzinger_fill_##T(sorted.ptr, out.ptr, 0, 1, sorted.len); \
+} \
+\
+/* Returns Eytzinger index of the first element not less than x, */ \
+/* or 0 if there is no such element. Span e holds n + 1 elements */ \
+/* with layout produced by eytzinger_build_T. */ \
+static uint \
+eytzinger_lower_bound_##T(span_##T e, T x) { \
+    if (e.len < 2) { \
+        return 0; \
+    } \
+\
+    const T* a = e.ptr; \
+    const uint n = e.len - 1; \
+    uint k = 1; \
+    while (k <= n) { \
+        __builtin_prefetch(a + (k << SEARCH_EYTZINGER_PREFETCH_LEVELS)); \
+        k = 2 * k + cast(uint, a[k] < x); \
+    } \
+    /* path went right after the answer node until the leaf, */ \
+    /* drop those steps along with the final left step */ \
+    return k >> cast(uint, __builtin_ffsl(cast(sint, ~k))); \
+} \
+\
+/* Same as eytzinger_lower_bound_T for each query, result for query i */ \
+/* is stored in out.ptr[i]. */ \
+static void \
+eytzinger_lower_bound_batch_##T(span_##T e, span_##T queries, span_uint out) { \
+    must(out.len >= queries.len); \
+\
+    const T* a = e.ptr; \
+    const uint n = e.len < 2 ? 0 : e.len - 1; \
+\
+    /* number of complete tree levels, all queries go through them */ \
+    uint levels = 0; \
+    if (n != 0) { \
+        levels = 63 - cast(uint, __builtin_clzl(n + 1)); \
+    } \
+\
+    uint ks[SEARCH_BATCH_LEN]; \
+    for (uint g = 0; g < queries.len; g += SEARCH_BATCH_LEN) { \
+        const uint m = min_uint(SEARCH_BATCH_LEN, queries.len - g); \
+        const T* q = queries.ptr + g; \
+\
+        for (uint j = 0; j < m; j += 1) { \
+            ks[j] = 1; \
+        } \
+        for (uint l = 0; l < levels; l += 1) { \
+            for (uint j = 0; j < m; j += 1) { \
+                uint k = ks[j]; \
+                __builtin_prefetch(a + (k << SEARCH_EYTZINGER_PREFETCH_LEVELS)); \
+                ks[j] = 2 * k + cast(uint, a[k] < q[j]); \
+            } \
+        } \
+        for (uint j = 0; j < m; j += 1) { \
+            uint k = ks[j]; \
+            /* last incomplete level */ \
+            if (k <= n) { \
+                k = 2 * k + cast(uint, a[k] < q[j]); \
+            } \
+            out.ptr[g + j] = k >> cast(uint, __builtin_ffsl(cast(sint, ~k))); \
+        } \
+    } \
+}
+
+SEARCH_DEFINE(s64)
+SEARCH_DEFINE(u64)
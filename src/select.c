@@ -0,0 +1,341 @@
+/*/doc
+
+Selection algorithms for integer spans: k-th element, partial sort,
+percentiles and streaming top-k. Depends on sorts from sort_gen.c.
+
+Selection runs in O(n) expected time, compared to O(n log n) for full sort.
+Functions reorder elements of given span.
+*/
+
+// Ranges longer than this are narrowed with Floyd-Rivest sampling step
+// before partitioning.
+#define SELECT_SAMPLE_LEN 600
+
+/*/doc
+
+Returns floor(sqrt(n)).
+*/
+static uint
+select_isqrt(uint n) {
+    if (n < 2) {
+        return n;
+    }
+
+    // Newton iteration starting from power of two not less than result
+    uint x = cast(uint, 1) << ((64 - cast(uint, __builtin_clzl(n)) + 1) / 2);
+    while (true) {
+        uint y = (x + n / x) / 2;
+        if (y >= x) {
+            return x;
+        }
+        x = y;
+    }
+}
+
+/*/doc
+
+Returns floor(cbrt(n)).
+*/
+static uint
+select_icbrt(uint n) {
+    uint x = 0;
+    for (sint s = 63; s >= 0; s -= 3) {
+        x <<= 1;
+        uint b = 3 * x * (x + 1) + 1;
+        if ((n >> s) >= b) {
+            n -= b << s;
+            x += 1;
+        }
+    }
+    return x;
+}
+
+/*/doc
+
+Computes range [*left, *right] of Floyd-Rivest sample which contains
+k-th element with high probability. Range length n must be greater
+than SELECT_SAMPLE_LEN.
+
+Original algorithm uses floating point:
+
+	z  = ln(n)
+	s  = 0.5 * exp(2 * z / 3) = 0.5 * n^(2/3)
+	sd = 0.5 * sqrt(z * s * (n - s) / n) * sign(i - n / 2)
+
+Integer approximations are used instead, since only rough bounds are needed.
+*/
+static void
+select_floyd_rivest_range(sint* left, sint* right, sint k) {
+    const sint l = *left;
+    const sint r = *right;
+    const uint n = cast(uint, r - l + 1);
+    const uint i = cast(uint, k - l + 1);
+
+    // ln(n) is approximated with log2(n) * ln(2)
+    uint z = (63 - cast(uint, __builtin_clzl(n))) * 693 / 1000;
+    uint c = select_icbrt(n);
+    uint s = c * c / 2;
+    uint sd = select_isqrt(cast(uint, cast(u128, z) * s * (n - s) / n)) / 2;
+
+    sint lo = k - cast(sint, cast(u128, i) * s / n);
+    sint hi = k + cast(sint, cast(u128, n - i) * s / n);
+    if (2 * i < n) {
+        lo -= cast(sint, sd);
+        hi -= cast(sint, sd);
+    } else {
+        lo += cast(sint, sd);
+        hi += cast(sint, sd);
+    }
+
+    *left = lo > l ? lo : l;
+    *right = hi < r ? hi : r;
+}
+
+/*/doc
+
+Generates selection functions for span type span_T:
+
+	static void nth_element_T(span_T s, uint k)
+	static void partial_sort_T(span_T s, uint k)
+	static T    percentile_T(span_T s, uint p)
+
+Requires intro_sort_T(...) to be defined.
+*/
+#define SELECT_DEFINE(T) \
+static void \
+select_swap_##T(T* a, sint i, sint j) { \
+    T c = a[i]; \
+    a[i] = a[j]; \
+    a[j] = c; \
+} \
+\
+static void \
+select_##T(T* a, sint left, sint right, sint k, uint depth) { \
+    while (right > left) { \
+        if (depth == 0) { \
+            /* selection fails to converge, fall back to sort */ \
+            intro_sort_##T(make_span_##T(a + left, cast(uint, right - left + 1))); \
+            return; \
+        } \
+        depth -= 1; \
+\
+        if (right - left > SELECT_SAMPLE_LEN) { \
+            /* recursively select k-th element from sample range, */ \
+            /* it becomes pivot and lands close to k-th position */ \
+            sint sl = left; \
+            sint sr = right; \
+            select_floyd_rivest_range(&sl, &sr, k); \
+            select_##T(a, sl, sr, k, depth); \
+        } else { \
+            /* median of three goes to position k */ \
+            sint m = left + (right - left) / 2; \
+            if (a[m] < a[left]) { \
+                select_swap_##T(a, left, m); \
+            } \
+            if (a[right] < a[m]) { \
+                select_swap_##T(a, m, right); \
+                if (a[m] < a[left]) { \
+                    select_swap_##T(a, left, m); \
+                } \
+            } \
+            select_swap_##T(a, m, k); \
+        } \
+\
+        /* partition range around t = a[k], both ends serve as sentinels */ \
+        const T t = a[k]; \
+        sint i = left; \
+        sint j = right; \
+        select_swap_##T(a, left, k); \
+        if (a[right] > t) { \
+            select_swap_##T(a, right, left); \
+        } \
+        while (i < j) { \
+            select_swap_##T(a, i, j); \
+            i += 1; \
+            j -= 1; \
+            while (a[i] < t) { \
+                i += 1; \
+            } \
+            while (a[j] > t) { \
+                j -= 1; \
+            } \
+        } \
+        if (a[left] == t) { \
+            select_swap_##T(a, left, j); \
+        } else { \
+            j += 1; \
+            select_swap_##T(a, j, right); \
+        } \
+\
+        if (j <= k) { \
+            left = j + 1; \
+        } \
+        if (k <= j) { \
+            right = j - 1; \
+        } \
+    } \
+} \
+\
+/* Reorders span such that element at index k is the one which would be */ \
+/* there after sorting. Elements before it are not greater, elements after */ \
+/* it are not less. */ \
+static void \
+nth_element_##T(span_##T s, uint k) { \
+    must(k < s.len); \
+    select_##T(s.ptr, 0, cast(sint, s.len - 1), cast(sint, k), 2 * sort_gen_depth_limit(s.len) + 8); \
+} \
+\
+/* Places k smallest elements in sorted order at the start of span. */ \
+/* Order of remaining elements is unspecified. */ \
+static void \
+partial_sort_##T(span_##T s, uint k) { \
+    must(k <= s.len); \
+    if (k == 0) { \
+        return; \
+    } \
+    if (k < s.len) { \
+        nth_element_##T(s, k - 1); \
+    } \
+    intro_sort_##T(make_span_##T(s.ptr, k)); \
+} \
+\
+/* Returns p-th percentile (nearest rank method) of span elements, */ \
+/* p must be in range [0, 100]. Span must not be empty. */ \
+static T \
+percentile_##T(span_##T s, uint p) { \
+    must(s.len != 0); \
+    must(p <= 100); \
+\
+    /* nearest rank: ceil(p / 100 * n) - 1, but not less than 0 */ \
+    uint k = (p * s.len + 99) / 100; \
+    if (k != 0) { \
+        k -= 1; \
+    } \
+    nth_element_##T(s, k); \
+    return s.ptr[k]; \
+}
+
+SELECT_DEFINE(s64)
+SELECT_DEFINE(u64)
+
+/*/doc
+
+Streaming selection of k largest integers. Consumes input in chunks
+of arbitrary size and keeps k largest elements seen so far in a min-heap.
+Each element costs O(log k) only when it enters top, otherwise
+it is a single comparison with heap root.
+
+Related:
+    +init_top_k_s64(...)
+    .top_k_s64_push(...)
+    .top_k_s64_finish(...)
+*/
+typedef struct {
+    // Min-heap of the largest elements seen so far.
+    s64* heap;
+
+    // Number of elements in heap.
+    uint len;
+
+    // Number of elements to select (k).
+    uint cap;
+} TopKS64;
+
+/*/doc
+
+Number of selected elements equals buffer length.
+*/
+static void
+init_top_k_s64(TopKS64* t, span_s64 buf) {
+    must(buf.len != 0);
+
+    t->heap = buf.ptr;
+    t->len = 0;
+    t->cap = buf.len;
+}
+
+static void
+top_k_s64_sift_down(s64* h, uint n, uint i) {
+    s64 x = h[i];
+    while (true) {
+        uint c = 2 * i + 1;
+        if (c >= n) {
+            break;
+        }
+        if (c + 1 < n && h[c + 1] < h[c]) {
+            c += 1;
+        }
+        if (h[c] >= x) {
+            break;
+        }
+        h[i] = h[c];
+        i = c;
+    }
+    h[i] = x;
+}
+
+static void
+top_k_s64_push(TopKS64* t, span_s64 chunk) {
+    s64* h = t->heap;
+    uint i = 0;
+
+    // fill heap up to capacity, then restore heap order once
+    if (t->len < t->cap) {
+        while (i < chunk.len && t->len < t->cap) {
+            h[t->len] = chunk.ptr[i];
+            t->len += 1;
+            i += 1;
+        }
+        if (t->len < t->cap) {
+            return;
+        }
+        uint j = t->cap >> 1;
+        while (j != 0) {
+            j -= 1;
+            top_k_s64_sift_down(h, t->cap, j);
+        }
+    }
+
+    for (; i < chunk.len; i += 1) {
+        s64 x = chunk.ptr[i];
+        if (x <= h[0]) {
+            continue;
+        }
+        h[0] = x;
+        top_k_s64_sift_down(h, t->cap, 0);
+    }
+}
+
+/*/doc
+
+Returns selected elements sorted in descending order. Heap is consumed
+in the process, no more elements can be pushed afterwards.
+If fewer than k elements were pushed, all of them are returned.
+*/
+static span_s64
+top_k_s64_finish(TopKS64* t) {
+    s64* h = t->heap;
+    uint n = t->len;
+
+    if (n < t->cap) {
+        // heap order was not established yet
+        uint j = n >> 1;
+        while (j != 0) {
+            j -= 1;
+            top_k_s64_sift_down(h, n, j);
+        }
+    }
+
+    // repeatedly move minimum to the end
+    while (n > 1) {
+        n -= 1;
+        s64 c = h[0];
+        h[0] = h[n];
+        h[n] = c;
+        top_k_s64_sift_down(h, n, 0);
+    }
+
+    span_s64 s = make_span_s64(h, t->len);
+    t->len = 0;
+    return s;
+}
@@ -0,0 +1,447 @@
+/*/doc
+
+Set operations over sorted integer spans: unique, intersection, union
+and difference. Depends on search.c for galloping intersection.
+
+Inputs of intersection, union and difference must be strictly increasing
+(sorted, without duplicates). Apply {set_unique_T(...)} to sorted span
+first if it may contain duplicates.
+
+Vector kernels process four elements per step. Intersection and difference
+compare a block of one input against all rotations of a block of the
+other input. Union merges blocks with in-register bitonic network.
+Selected elements are packed together with lane permutation taken from
+a table indexed by comparison mask. Implementation is selected at runtime.
+Baseline variants are branchless scalar merges.
+
+Union kernel requires AVX-512: without 64-bit min/max instructions
+the merge network is not faster than scalar merge.
+*/
+
+// Intersection switches to galloping search when one input is longer
+// than the other by at least this factor.
+#define SETOPS_GALLOP_RATIO 32
+
+/*/doc
+
+Lane permutations which move selected 64-bit lanes to the front of vector.
+Table is indexed by 4-bit mask of selected lanes. Permutations operate on
+32-bit lanes, since AVX2 has no variable permutation of 64-bit lanes.
+*/
+static const vec8_s32
+setops_compress_table[16] = {
+    { 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 1, 0, 0, 0, 0, 0, 0 },
+    { 2, 3, 0, 0, 0, 0, 0, 0 },
+    { 0, 1, 2, 3, 0, 0, 0, 0 },
+    { 4, 5, 0, 0, 0, 0, 0, 0 },
+    { 0, 1, 4, 5, 0, 0, 0, 0 },
+    { 2, 3, 4, 5, 0, 0, 0, 0 },
+    { 0, 1, 2, 3, 4, 5, 0, 0 },
+    { 6, 7, 0, 0, 0, 0, 0, 0 },
+    { 0, 1, 6, 7, 0, 0, 0, 0 },
+    { 2, 3, 6, 7, 0, 0, 0, 0 },
+    { 0, 1, 2, 3, 6, 7, 0, 0 },
+    { 4, 5, 6, 7, 0, 0, 0, 0 },
+    { 0, 1, 4, 5, 6, 7, 0, 0 },
+    { 2, 3, 4, 5, 6, 7, 0, 0 },
+    { 0, 1, 2, 3, 4, 5, 6, 7 },
+};
+
+// Moves lanes of vector {v} selected by mask {m} to the front.
+#define SETOPS_COMPRESS(V, v, m) cast(V, __builtin_shuffle(cast(vec8_u32, (v)), setops_compress_table[m]))
+
+// Selects lanes from {a} where mask {m} is set and from {b} otherwise.
+#define SETOPS_BLEND(V, m, a, b) cast(V, (cast(vec4_s64, (a)) & (m)) | (cast(vec4_s64, (b)) & ~(m)))
+
+// Sorts vector which holds bitonic sequence in ascending order.
+#define SETOPS_BITONIC4(V, x) do { \
+    V bp_ = __builtin_shuffle((x), (vec4_s64){ 2, 3, 0, 1 }); \
+    vec4_s64 blt_ = bp_ < (x); \
+    V blo_ = SETOPS_BLEND(V, blt_, bp_, (x)); \
+    V bhi_ = SETOPS_BLEND(V, blt_, (x), bp_); \
+    (x) = SETOPS_BLEND(V, ((vec4_s64){ -1, -1, 0, 0 }), blo_, bhi_); \
+    bp_ = __builtin_shuffle((x), (vec4_s64){ 1, 0, 3, 2 }); \
+    blt_ = bp_ < (x); \
+    blo_ = SETOPS_BLEND(V, blt_, bp_, (x)); \
+    bhi_ = SETOPS_BLEND(V, blt_, (x), bp_); \
+    (x) = SETOPS_BLEND(V, ((vec4_s64){ -1, 0, -1, 0 }), blo_, bhi_); \
+} while (false)
+
+// Merges two sorted vectors. Four smallest elements go to {lo},
+// four largest to {hi}, both sorted.
+#define SETOPS_MERGE4(V, a, b, lo, hi) do { \
+    V rb_ = __builtin_shuffle((b), (vec4_s64){ 3, 2, 1, 0 }); \
+    vec4_s64 lt_ = rb_ < (a); \
+    (lo) = SETOPS_BLEND(V, lt_, rb_, (a)); \
+    (hi) = SETOPS_BLEND(V, lt_, (a), rb_); \
+    SETOPS_BITONIC4(V, lo); \
+    SETOPS_BITONIC4(V, hi); \
+} while (false)
+
+// Mask of lanes in {va} which are equal to any lane of {vb}.
+#define SETOPS_MATCH4(va, vb, m) do { \
+    vec4_u64 r_ = (vb); \
+    vec4_s64 eq_ = (va) == r_; \
+    r_ = __builtin_shuffle(r_, (vec4_s64){ 1, 2, 3, 0 }); \
+    eq_ |= (va) == r_; \
+    r_ = __builtin_shuffle(r_, (vec4_s64){ 1, 2, 3, 0 }); \
+    eq_ |= (va) == r_; \
+    r_ = __builtin_shuffle(r_, (vec4_s64){ 1, 2, 3, 0 }); \
+    eq_ |= (va) == r_; \
+    (m) = simd_movemask_vec4(eq_); \
+} while (false)
+
+/*/doc
+
+Generates set operations for span type span_T:
+
+	static uint set_unique_T(span_T s)
+	static uint set_intersect_T(span_T a, span_T b, span_T out)
+	static uint set_intersect_gallop_T(span_T small, span_T large, span_T out)
+	static uint set_union_T(span_T a, span_T b, span_T out)
+	static uint set_difference_T(span_T a, span_T b, span_T out)
+
+V is a vector type with four lanes of type T. Requires lower_bound_T(...)
+from search.c.
+*/
+#define SETOPS_DEFINE(T, V) \
+static uint \
+set_unique_##T##_scalar(T* a, uint n, uint i, uint k) { \
+    T prev = a[k - 1]; \
+    for (; i < n; i += 1) { \
+        T x = a[i]; \
+        a[k] = x; \
+        k += cast(uint, x != prev); \
+        prev = x; \
+    } \
+    return k; \
+} \
+\
+TARGET_AVX2 static uint \
+set_unique_##T##_avx2(T* a, uint n) { \
+    uint k = 1; \
+    uint i = 1; \
+    T prev = a[0]; \
+    while (i + 4 <= n) { \
+        vec4_u64 v; \
+        simd_load(v, a + i); \
+        vec4_u64 pv = (vec4_u64){} + cast(u64, prev); \
+        vec4_u64 sh = __builtin_shuffle(v, pv, (vec4_s64){ 4, 0, 1, 2 }); \
+        uint m = ~simd_movemask_vec4(v == sh) & 0xF; \
+        prev = cast(T, v[3]); \
+\
+        /* store never reaches elements which are not loaded yet */ \
+        vec4_u64 packed = SETOPS_COMPRESS(vec4_u64, v, m); \
+        simd_store(a + k, packed); \
+        k += cast(uint, __builtin_popcountl(m)); \
+        i += 4; \
+    } \
+    return set_unique_##T##_scalar(a, n, i, k); \
+} \
+\
+/* Removes duplicates from sorted span. Unique elements are moved to */ \
+/* the start of span, returns their number. */ \
+static uint \
+set_unique_##T(span_##T s) { \
+    if (s.len < 2) { \
+        return s.len; \
+    } \
+    if (cpu_has_feature(CPU_FEATURE_AVX2)) { \
+        return set_unique_##T##_avx2(s.ptr, s.len); \
+    } \
+    return set_unique_##T##_scalar(s.ptr, s.len, 1, 1); \
+} \
+\
+static uint \
+set_intersect_##T##_scalar(const T* a, uint na, const T* b, uint nb, T* out) { \
+    uint i = 0; \
+    uint j = 0; \
+    uint k = 0; \
+    while (i < na && j < nb) { \
+        T x = a[i]; \
+        T y = b[j]; \
+        out[k] = x; \
+        k += cast(uint, x == y); \
+        i += cast(uint, x <= y); \
+        j += cast(uint, y <= x); \
+    } \
+    return k; \
+} \
+\
+TARGET_AVX2 static uint \
+set_intersect_##T##_avx2(const T* a, uint na, const T* b, uint nb, T* out) { \
+    uint i = 0; \
+    uint j = 0; \
+    uint k = 0; \
+    /* k + 4 <= min(i, j) + 4, thus full vector store fits into output */ \
+    while (i + 4 <= na && j + 4 <= nb) { \
+        vec4_u64 va; \
+        vec4_u64 vb; \
+        simd_load(va, a + i); \
+        simd_load(vb, b + j); \
+        uint m; \
+        SETOPS_MATCH4(va, vb, m); \
+        vec4_u64 packed = SETOPS_COMPRESS(vec4_u64, va, m); \
+        simd_store(out + k, packed); \
+        k += cast(uint, __builtin_popcountl(m)); \
+\
+        T amax = a[i + 3]; \
+        T bmax = b[j + 3]; \
+        i += cast(uint, amax <= bmax) * 4; \
+        j += cast(uint, bmax <= amax) * 4; \
+    } \
+    return k + set_intersect_##T##_scalar(a + i, na - i, b + j, nb - j, out + k); \
+} \
+\
+/* Intersection for inputs of very different length. Each element of */ \
+/* small span is searched in large span with exponential step from */ \
+/* position of previous match. Output span must be at least as long as */ \
+/* small span. Returns number of elements in intersection. */ \
+static uint \
+set_intersect_gallop_##T(span_##T small, span_##T large, span_##T out) { \
+    must(out.len >= small.len); \
+\
+    uint k = 0; \
+    uint lo = 0; \
+    for (uint i = 0; i < small.len; i += 1) { \
+        T x = small.ptr[i]; \
+        uint bound = 1; \
+        while (lo + bound < large.len && large.ptr[lo + bound] < x) { \
+            bound <<= 1; \
+        } \
+        /* element at lo + bound / 2 is less than x (unless bound is 1) */ \
+        uint start = lo + (bound >> 1); \
+        uint end = min_uint(lo + bound + 1, large.len); \
+        lo = start + lower_bound_##T(make_span_##T(large.ptr + start, end - start), x); \
+        if (lo == large.len) { \
+            break; \
+        } \
+        out.ptr[k] = x; \
+        k += cast(uint, large.ptr[lo] == x); \
+    } \
+    return k; \
+} \
+\
+/* Stores elements present in both spans into output. Output span must */ \
+/* be at least as long as the shorter input. Returns number of stored elements. */ \
+static uint \
+set_intersect_##T(span_##T a, span_##T b, span_##T out) { \
+    must(out.len >= min_uint(a.len, b.len)); \
+    if (a.len == 0 || b.len == 0) { \
+        return 0; \
+    } \
+\
+    if (a.len * SETOPS_GALLOP_RATIO <= b.len) { \
+        return set_intersect_gallop_##T(a, b, out); \
+    } \
+    if (b.len * SETOPS_GALLOP_RATIO <= a.len) { \
+        return set_intersect_gallop_##T(b, a, out); \
+    } \
+    if (cpu_has_feature(CPU_FEATURE_AVX2)) { \
+        return set_intersect_##T##_avx2(a.ptr, a.len, b.ptr, b.len, out.ptr); \
+    } \
+    return set_intersect_##T##_scalar(a.ptr, a.len, b.ptr, b.len, out.ptr); \
+} \
+\
+/* Merges inputs into output starting at position k. Elements equal */ \
+/* to previously stored one are skipped. Returns new output length. */ \
+static uint \
+set_union_##T##_scalar(const T* a, uint na, const T* b, uint nb, T* out, uint k) { \
+    uint i = 0; \
+    uint j = 0; \
+    uint first = cast(uint, k == 0); \
+    T prev = first != 0 ? 0 : out[k - 1]; \
+    while (i < na && j < nb) { \
+        T x = a[i]; \
+        T y = b[j]; \
+        T v = x < y ? x : y; \
+        out[k] = v; \
+        k += first | cast(uint, v != prev); \
+        first = 0; \
+        prev = v; \
+        i += cast(uint, x <= y); \
+        j += cast(uint, y <= x); \
+    } \
+    for (; i < na; i += 1) { \
+        out[k] = a[i]; \
+        k += first | cast(uint, a[i] != prev); \
+        first = 0; \
+        prev = a[i]; \
+    } \
+    for (; j < nb; j += 1) { \
+        out[k] = b[j]; \
+        k += first | cast(uint, b[j] != prev); \
+        first = 0; \
+        prev = b[j]; \
+    } \
+    return k; \
+} \
+\
+TARGET_AVX512 static uint \
+set_union_##T##_avx512(const T* a, uint na, const T* b, uint nb, T* out) { \
+    if (na < 4 || nb < 4) { \
+        return set_union_##T##_scalar(a, na, b, nb, out, 0); \
+    } \
+\
+    V va; \
+    V vb; \
+    simd_load(va, a); \
+    simd_load(vb, b); \
+    uint i = 4; \
+    uint j = 4; \
+    V lo; \
+    V carry; \
+    SETOPS_MERGE4(V, va, vb, lo, carry); \
+\
+    /* equal elements of two inputs are adjacent in merged stream, */ \
+    /* lanes equal to preceding lane are dropped */ \
+    uint k = 0; \
+    V prev_lo = lo; \
+    uint first = 1; \
+    while (true) { \
+        V sh = __builtin_shuffle(lo, prev_lo, (vec4_s64){ 7, 0, 1, 2 }); \
+        uint m = (~simd_movemask_vec4(lo == sh) & 0xF) | first; \
+        first = 0; \
+        prev_lo = lo; \
+        V packed = SETOPS_COMPRESS(V, lo, m); \
+        simd_store(out + k, packed); \
+        k += cast(uint, __builtin_popcountl(m)); \
+\
+        if (i + 4 > na || j + 4 > nb) { \
+            break; \
+        } \
+        /* next block comes from input with smaller head */ \
+        uint take_a = cast(uint, a[i] <= b[j]); \
+        const T* p = take_a != 0 ? a + i : b + j; \
+        i += take_a * 4; \
+        j += (take_a ^ 1) * 4; \
+        V v; \
+        simd_load(v, p); \
+        SETOPS_MERGE4(V, carry, v, lo, carry); \
+    } \
+\
+    /* merge carried elements with the rest of inputs */ \
+    T prev = prev_lo[3]; \
+    T c[4]; \
+    simd_store(c, carry); \
+    uint ci = 0; \
+    while (ci < 4) { \
+        T x = c[ci]; \
+        uint src = 0; \
+        if (i < na && a[i] < x) { \
+            x = a[i]; \
+            src = 1; \
+        } \
+        if (j < nb && b[j] < x) { \
+            x = b[j]; \
+            src = 2; \
+        } \
+        out[k] = x; \
+        k += cast(uint, x != prev); \
+        prev = x; \
+        ci += cast(uint, src == 0); \
+        i += cast(uint, src == 1); \
+        j += cast(uint, src == 2); \
+    } \
+    return set_union_##T##_scalar(a + i, na - i, b + j, nb - j, out, k); \
+} \
+\
+/* Stores elements present in any of two spans into output. Output span */ \
+/* must be at least as long as both inputs together. Returns number */ \
+/* of stored elements. */ \
+static uint \
+set_union_##T(span_##T a, span_##T b, span_##T out) { \
+    must(out.len >= a.len + b.len); \
+    if (cpu_has_feature(CPU_FEATURE_AVX512)) { \
+        return set_union_##T##_avx512(a.ptr, a.len, b.ptr, b.len, out.ptr); \
+    } \
+    return set_union_##T##_scalar(a.ptr, a.len, b.ptr, b.len, out.ptr, 0); \
+} \
+\
+static uint \
+set_difference_##T##_scalar(const T* a, uint na, const T* b, uint nb, T* out) { \
+    uint i = 0; \
+    uint j = 0; \
+    uint k = 0; \
+    while (i < na && j < nb) { \
+        T x = a[i]; \
+        T y = b[j]; \
+        out[k] = x; \
+        k += cast(uint, x < y); \
+        i += cast(uint, x <= y); \
+        j += cast(uint, y <= x); \
+    } \
+    for (; i < na; i += 1) { \
+        out[k] = a[i]; \
+        k += 1; \
+    } \
+    return k; \
+} \
+\
+TARGET_AVX2 static uint \
+set_difference_##T##_avx2(const T* a, uint na, const T* b, uint nb, T* out) { \
+    uint i = 0; \
+    uint j = 0; \
+    uint k = 0; \
+\
+    /* lanes of current block of a, which matched any of previous blocks of b */ \
+    uint matched = 0; \
+    while (i + 4 <= na && j + 4 <= nb) { \
+        vec4_u64 va; \
+        vec4_u64 vb; \
+        simd_load(va, a + i); \
+        simd_load(vb, b + j); \
+        uint m; \
+        SETOPS_MATCH4(va, vb, m); \
+        matched |= m; \
+\
+        T amax = a[i + 3]; \
+        T bmax = b[j + 3]; \
+        uint next_a = cast(uint, amax <= bmax); \
+\
+        /* block of a is emitted only when it is done, store is harmless otherwise */ \
+        uint keep = ~matched & 0xF & (0 - next_a); \
+        vec4_u64 packed = SETOPS_COMPRESS(vec4_u64, va, keep); \
+        simd_store(out + k, packed); \
+        k += cast(uint, __builtin_popcountl(keep)); \
+        matched &= next_a - 1; \
+\
+        i += next_a * 4; \
+        j += cast(uint, bmax <= amax) * 4; \
+    } \
+\
+    if (matched != 0) { \
+        /* finish partially matched block */ \
+        for (uint c = 0; c < 4; c += 1) { \
+            T x = a[i + c]; \
+            if (((matched >> c) & 1) != 0) { \
+                continue; \
+            } \
+            while (j < nb && b[j] < x) { \
+                j += 1; \
+            } \
+            if (j < nb && b[j] == x) { \
+                continue; \
+            } \
+            out[k] = x; \
+            k += 1; \
+        } \
+        i += 4; \
+    } \
+    return k + set_difference_##T##_scalar(a + i, na - i, b + j, nb - j, out + k); \
+} \
+\
+/* Stores elements of span a which are not present in span b into output. */ \
+/* Output span must be at least as long as a. Returns number of stored elements. */ \
+static uint \
+set_difference_##T(span_##T a, span_##T b, span_##T out) { \
+    must(out.len >= a.len); \
+    if (cpu_has_feature(CPU_FEATURE_AVX2)) { \
+        return set_difference_##T##_avx2(a.ptr, a.len, b.ptr, b.len, out.ptr); \
+    } \
+    return set_difference_##T##_scalar(a.ptr, a.len, b.ptr, b.len, out.ptr); \
+}
+
+SETOPS_DEFINE(s64, vec4_s64)
+SETOPS_DEFINE(u64, vec4_u64)
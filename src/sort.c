@@ -1,3 +1,10 @@
+/*
+Comparison sorts for spans of s64 integers.
+
+Requires "sort_network.c" to be included before, short spans are sorted
+with {network_sort_s64(...)}.
+*/
+
 /*/doc
 
 Returns true if span of integers is sorted in ascending order.
@@ -68,10 +75,14 @@ bubble_sort_s64(span_s64 s) {
     }
 }
 
+/*/doc
+
+Short spans are handled by sorting network, see sort_network.c.
+*/
 static void
 quick_sort_s64(span_s64 s) {
     if (s.len <= 16) {
-        insert_sort_s64(s);
+        network_sort_s64(s);
         return;
     }
 
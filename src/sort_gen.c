@@ -0,0 +1,344 @@
+/*/doc
+
+Macro templates for generating type-specialized sort functions.
+Integer instances depend on networks from sort_network.c.
+
+Each template is instantiated with:
+
+	NAME - name of generated sort function, helpers get it as prefix
+	SPAN - span type with {ptr} and {len} fields
+	T    - element type
+	LESS - comparator, function or function-like macro with signature
+	       bool LESS(const T* a, const T* b), returns true if {a} must go before {b}
+
+Comparator is expanded directly inside generated code, so there are no
+calls through function pointers.
+
+Variants with BY_KEY suffix take key extractor KEY(const T* x) instead of
+comparator. Keys are compared with "<" operator.
+
+Example:
+
+	#define POINT_KEY(p) ((p)->depth)
+	SORT_GEN_DEFINE_BY_KEY(intro_sort_point, span_point, Point, POINT_KEY)
+*/
+
+// Spans shorter than this are sorted with insertion sort.
+#define SORT_GEN_SMALL_LEN 16
+
+/*/doc
+
+Returns 2 * floor(log2(n)). Used as recursion depth limit for introsort.
+*/
+static uint
+sort_gen_depth_limit(uint n) {
+	if (n < 2) {
+		return 0;
+	}
+	return 2 * (63 - cast(uint, __builtin_clzl(n)));
+}
+
+/*/doc
+
+Generates unstable introsort: quicksort with median of three pivot and
+Hoare partition, heapsort when recursion becomes too deep and insertion sort
+for short spans.
+
+Generated function:
+
+	static void NAME(SPAN s)
+*/
+#define SORT_GEN_DEFINE(NAME, SPAN, T, LESS) \
+SORT_GEN_DEFINE_SMALL(NAME, SPAN, T, LESS, SORT_GEN_SMALL_LEN, NAME##_insert)
+
+/*/doc
+
+Same as SORT_GEN_DEFINE, but spans not longer than SMALL_LEN are sorted
+with custom function SMALL_SORT(T* a, uint n) instead of insertion sort.
+*/
+#define SORT_GEN_DEFINE_SMALL(NAME, SPAN, T, LESS, SMALL_LEN, SMALL_SORT) \
+static void \
+NAME##_insert(T* a, uint n) { \
+	for (uint i = 1; i < n; i += 1) { \
+		T x = a[i]; \
+		uint j = i; \
+		while (j != 0 && LESS(&x, &a[j - 1])) { \
+			a[j] = a[j - 1]; \
+			j -= 1; \
+		} \
+		a[j] = x; \
+	} \
+} \
+\
+static void \
+NAME##_sift_down(T* a, uint i, uint n) { \
+	T x = a[i]; \
+	while (true) { \
+		uint c = 2 * i + 1; \
+		if (c >= n) { \
+			break; \
+		} \
+		if (c + 1 < n && LESS(&a[c], &a[c + 1])) { \
+			c += 1; \
+		} \
+		if (!LESS(&x, &a[c])) { \
+			break; \
+		} \
+		a[i] = a[c]; \
+		i = c; \
+	} \
+	a[i] = x; \
+} \
+\
+static void \
+NAME##_heap(T* a, uint n) { \
+	uint i = n >> 1; \
+	while (i != 0) { \
+		i -= 1; \
+		NAME##_sift_down(a, i, n); \
+	} \
+	while (n > 1) { \
+		n -= 1; \
+		T c = a[0]; \
+		a[0] = a[n]; \
+		a[n] = c; \
+		NAME##_sift_down(a, 0, n); \
+	} \
+} \
+\
+static void \
+NAME##_swap(T* a, uint i, uint j) { \
+	T c = a[i]; \
+	a[i] = a[j]; \
+	a[j] = c; \
+} \
+\
+static void \
+NAME##_intro(T* a, uint n, uint depth) { \
+	while (n > SMALL_LEN) { \
+		if (depth == 0) { \
+			NAME##_heap(a, n); \
+			return; \
+		} \
+		depth -= 1; \
+\
+		/* order first, middle and last elements, median goes to a[0] */ \
+		uint m = n >> 1; \
+		if (LESS(&a[m], &a[0])) { \
+			NAME##_swap(a, 0, m); \
+		} \
+		if (LESS(&a[n - 1], &a[m])) { \
+			NAME##_swap(a, m, n - 1); \
+			if (LESS(&a[m], &a[0])) { \
+				NAME##_swap(a, 0, m); \
+			} \
+		} \
+		NAME##_swap(a, 0, m); \
+		T p = a[0]; \
+\
+		/* a[n - 1] is not less than pivot and a[0] equals pivot, */ \
+		/* both scans below stop without bounds checks */ \
+		uint i = 0; \
+		uint j = n; \
+		while (true) { \
+			do { \
+				i += 1; \
+			} while (LESS(&a[i], &p)); \
+			do { \
+				j -= 1; \
+			} while (LESS(&p, &a[j])); \
+			if (i >= j) { \
+				break; \
+			} \
+			NAME##_swap(a, i, j); \
+		} \
+		NAME##_swap(a, 0, j); \
+\
+		/* recurse into smaller part, loop over larger one */ \
+		uint left = j; \
+		uint right = n - j - 1; \
+		if (left < right) { \
+			NAME##_intro(a, left, depth); \
+			a += j + 1; \
+			n = right; \
+		} else { \
+			NAME##_intro(a + j + 1, right, depth); \
+			n = left; \
+		} \
+	} \
+	SMALL_SORT(a, n); \
+} \
+\
+static void \
+NAME(SPAN s) { \
+	if (s.len < 2) { \
+		return; \
+	} \
+	NAME##_intro(s.ptr, s.len, sort_gen_depth_limit(s.len)); \
+}
+
+/*/doc
+
+Generates stable bottom-up merge sort. Elements which compare equal keep
+their original relative order.
+
+Generated function:
+
+	static void NAME(SPAN s, SPAN scratch)
+
+Scratch span must be at least as long as sorted span.
+*/
+#define SORT_GEN_DEFINE_STABLE(NAME, SPAN, T, LESS) \
+static void \
+NAME##_insert(T* a, uint n) { \
+	for (uint i = 1; i < n; i += 1) { \
+		T x = a[i]; \
+		uint j = i; \
+		while (j != 0 && LESS(&x, &a[j - 1])) { \
+			a[j] = a[j - 1]; \
+			j -= 1; \
+		} \
+		a[j] = x; \
+	} \
+} \
+\
+static void \
+NAME##_merge(T* dst, const T* a, uint na, const T* b, uint nb) { \
+	uint i = 0; \
+	uint j = 0; \
+	uint k = 0; \
+	while (i < na && j < nb) { \
+		/* take from right run only if strictly less, this keeps sort stable */ \
+		if (LESS(&b[j], &a[i])) { \
+			dst[k] = b[j]; \
+			j += 1; \
+		} else { \
+			dst[k] = a[i]; \
+			i += 1; \
+		} \
+		k += 1; \
+	} \
+	while (i < na) { \
+		dst[k] = a[i]; \
+		i += 1; \
+		k += 1; \
+	} \
+	while (j < nb) { \
+		dst[k] = b[j]; \
+		j += 1; \
+		k += 1; \
+	} \
+} \
+\
+static void \
+NAME(SPAN s, SPAN scratch) { \
+	if (s.len < 2) { \
+		return; \
+	} \
+	must(scratch.len >= s.len); \
+\
+	const uint n = s.len; \
+	for (uint i = 0; i < n; i += SORT_GEN_SMALL_LEN) { \
+		NAME##_insert(s.ptr + i, min_uint(SORT_GEN_SMALL_LEN, n - i)); \
+	} \
+\
+	T* src = s.ptr; \
+	T* dst = scratch.ptr; \
+	for (uint w = SORT_GEN_SMALL_LEN; w < n; w *= 2) { \
+		for (uint i = 0; i < n; i += 2 * w) { \
+			uint na = min_uint(w, n - i); \
+			uint nb = min_uint(w, n - i - na); \
+			if (nb == 0 || !LESS(&src[i + na], &src[i + na - 1])) { \
+				/* runs are already in order */ \
+				for (uint k = 0; k < na + nb; k += 1) { \
+					dst[i + k] = src[i + k]; \
+				} \
+				continue; \
+			} \
+			NAME##_merge(dst + i, src + i, na, src + i + na, nb); \
+		} \
+		T* c = src; \
+		src = dst; \
+		dst = c; \
+	} \
+\
+	if (src != s.ptr) { \
+		for (uint k = 0; k < n; k += 1) { \
+			s.ptr[k] = src[k]; \
+		} \
+	} \
+}
+
+#define SORT_GEN_DEFINE_BY_KEY(NAME, SPAN, T, KEY) \
+static bool \
+NAME##_key_less(const T* a, const T* b) { \
+	return KEY(a) < KEY(b); \
+} \
+SORT_GEN_DEFINE(NAME, SPAN, T, NAME##_key_less)
+
+#define SORT_GEN_DEFINE_STABLE_BY_KEY(NAME, SPAN, T, KEY) \
+static bool \
+NAME##_key_less(const T* a, const T* b) { \
+	return KEY(a) < KEY(b); \
+} \
+SORT_GEN_DEFINE_STABLE(NAME, SPAN, T, NAME##_key_less)
+
+/* Instances for common types */
+
+// Integer spans use sorting networks for short spans.
+#define SORT_GEN_NETWORK_LEN 32
+
+#define SORT_GEN_VALUE_LESS(a, b) (*(a) < *(b))
+
+static void
+sort_gen_network_s64(s64* a, uint n) {
+	network_sort_s64(make_span_s64(a, n));
+}
+
+static void
+sort_gen_network_u64(u64* a, uint n) {
+	network_sort_u64(make_span_u64(a, n));
+}
+
+SORT_GEN_DEFINE_SMALL(intro_sort_s64, span_s64, s64, SORT_GEN_VALUE_LESS, SORT_GEN_NETWORK_LEN, sort_gen_network_s64)
+SORT_GEN_DEFINE_SMALL(intro_sort_u64, span_u64, u64, SORT_GEN_VALUE_LESS, SORT_GEN_NETWORK_LEN, sort_gen_network_u64)
+
+static bool
+sort_gen_str_less(const str* a, const str* b) {
+	return str_compare(*a, *b) < 0;
+}
+
+SORT_GEN_DEFINE(intro_sort_str, span_str, str, sort_gen_str_less)
+SORT_GEN_DEFINE_STABLE(merge_sort_str, span_str, str, sort_gen_str_less)
+
+/*/doc
+
+Record with integer key and attached payload. Intended for sorting
+arbitrary data by key via indices or pointers stored in {val}.
+*/
+typedef struct {
+	u64 key;
+	u64 val;
+} KeyValU64;
+
+typedef struct {
+	KeyValU64* ptr;
+	uint len;
+} span_key_val_u64;
+
+static span_key_val_u64
+make_span_key_val_u64(KeyValU64* ptr, uint len) {
+	span_key_val_u64 s = {};
+	if (len == 0) {
+		return s;
+	}
+
+	s.ptr = ptr;
+	s.len = len;
+	return s;
+}
+
+#define SORT_GEN_KEY_VAL_U64_KEY(x) ((x)->key)
+
+SORT_GEN_DEFINE_BY_KEY(intro_sort_key_val_u64, span_key_val_u64, KeyValU64, SORT_GEN_KEY_VAL_U64_KEY)
+SORT_GEN_DEFINE_STABLE_BY_KEY(merge_sort_key_val_u64, span_key_val_u64, KeyValU64, SORT_GEN_KEY_VAL_U64_KEY)
@@ -0,0 +1,190 @@
+/*/doc
+
+Bitonic sorting networks for short spans (up to SORT_NETWORK_MAX_LEN elements).
+
+Network performs fixed sequence of compare-exchange operations which does not
+depend on data, so there are no mispredicted branches. Span is padded up to
+power of two with maximum value of element type, loaded into vector registers
+and sorted with lane-wise min/max operations. Compare-exchange between elements
+in different vectors is a plain min/max pair. Between elements inside the same
+vector it is a lane permutation followed by min/max and blend.
+
+Each network is compiled twice: with AVX2 enabled and for baseline target.
+Implementation is selected at runtime.
+
+Ordering of NaN values in f32 spans is unspecified.
+*/
+
+#define SORT_NETWORK_MAX_LEN 64
+
+#define SORT_NETWORK_IOTA4 ((vec4_s64){ 0, 1, 2, 3 })
+#define SORT_NETWORK_IOTA8 ((vec8_s32){ 0, 1, 2, 3, 4, 5, 6, 7 })
+
+// Selects lanes from {a} where mask {m} is set and from {b} otherwise.
+#define SORT_NETWORK_BLEND(V, VI, m, a, b) ((V)(((VI)(a) & (m)) | ((VI)(b) & ~(m))))
+
+/*/doc
+
+Generates function which sorts array of at most SORT_NETWORK_MAX_LEN elements.
+
+	NAME - name of generated function: static void NAME(T* a, uint n)
+	T    - element type
+	V    - vector type which holds W elements of type T
+	VI   - signed integer vector type with the same lane width as V
+	TI   - lane type of VI
+	W    - number of lanes in V
+	IOTA - VI vector with lane indices { 0, 1, ..., W - 1 }
+	PAD  - maximum value of type T, used for padding
+	ATTR - function attributes (target instruction set)
+*/
+#define SORT_NETWORK_DEFINE(NAME, T, V, VI, TI, W, IOTA, PAD, ATTR) \
+ATTR static void \
+NAME(T* a, uint n) { \
+	union { \
+		V v[SORT_NETWORK_MAX_LEN / W]; \
+		T e[SORT_NETWORK_MAX_LEN]; \
+	} b; \
+\
+	uint m = W; \
+	while (m < n) { \
+		m <<= 1; \
+	} \
+	for (uint i = 0; i < n; i += 1) { \
+		b.e[i] = a[i]; \
+	} \
+	for (uint i = n; i < m; i += 1) { \
+		b.e[i] = PAD; \
+	} \
+\
+	const uint nv = m / W; \
+	for (uint k = 2; k <= m; k <<= 1) { \
+		for (uint j = k >> 1; j != 0; j >>= 1) { \
+			if (j >= W) { \
+				/* partners are in different vectors */ \
+				const uint jv = j / W; \
+				for (uint r = 0; r < nv; r += 1) { \
+					if ((r & jv) != 0) { \
+						continue; \
+					} \
+					V x = b.v[r]; \
+					V y = b.v[r + jv]; \
+					VI lt = y < x; \
+					V lo = SORT_NETWORK_BLEND(V, VI, lt, y, x); \
+					V hi = SORT_NETWORK_BLEND(V, VI, lt, x, y); \
+					if (((r * W) & k) == 0) { \
+						b.v[r] = lo; \
+						b.v[r + jv] = hi; \
+					} else { \
+						b.v[r] = hi; \
+						b.v[r + jv] = lo; \
+					} \
+				} \
+			} else { \
+				/* partners are in the same vector */ \
+				const VI partner = IOTA ^ cast(TI, j); \
+				for (uint r = 0; r < nv; r += 1) { \
+					V x = b.v[r]; \
+					V p = __builtin_shuffle(x, partner); \
+					VI lt = p < x; \
+					V lo = SORT_NETWORK_BLEND(V, VI, lt, p, x); \
+					V hi = SORT_NETWORK_BLEND(V, VI, lt, x, p); \
+\
+					/* lower element of ascending pair or upper element */ \
+					/* of descending pair takes minimum */ \
+					VI idx = IOTA + cast(TI, r * W); \
+					VI take_min = ((idx & cast(TI, j)) == 0) == ((idx & cast(TI, k)) == 0); \
+					b.v[r] = SORT_NETWORK_BLEND(V, VI, take_min, lo, hi); \
+				} \
+			} \
+		} \
+	} \
+\
+	for (uint i = 0; i < n; i += 1) { \
+		a[i] = b.e[i]; \
+	} \
+}
+
+SORT_NETWORK_DEFINE(network_sort_s64_avx2, s64, vec4_s64, vec4_s64, s64, 4, SORT_NETWORK_IOTA4, max_integer_s64, TARGET_AVX2)
+SORT_NETWORK_DEFINE(network_sort_s64_base, s64, vec4_s64, vec4_s64, s64, 4, SORT_NETWORK_IOTA4, max_integer_s64, )
+
+SORT_NETWORK_DEFINE(network_sort_u64_avx2, u64, vec4_u64, vec4_s64, s64, 4, SORT_NETWORK_IOTA4, max_integer_u64, TARGET_AVX2)
+SORT_NETWORK_DEFINE(network_sort_u64_base, u64, vec4_u64, vec4_s64, s64, 4, SORT_NETWORK_IOTA4, max_integer_u64, )
+
+SORT_NETWORK_DEFINE(network_sort_u32_avx2, u32, vec8_u32, vec8_s32, s32, 8, SORT_NETWORK_IOTA8, max_integer_u32, TARGET_AVX2)
+SORT_NETWORK_DEFINE(network_sort_u32_base, u32, vec8_u32, vec8_s32, s32, 8, SORT_NETWORK_IOTA8, max_integer_u32, )
+
+SORT_NETWORK_DEFINE(network_sort_f32_avx2, f32, vec8_f32, vec8_s32, s32, 8, SORT_NETWORK_IOTA8, __builtin_inff(), TARGET_AVX2)
+SORT_NETWORK_DEFINE(network_sort_f32_base, f32, vec8_f32, vec8_s32, s32, 8, SORT_NETWORK_IOTA8, __builtin_inff(), )
+
+/*/doc
+
+Sorts span of at most SORT_NETWORK_MAX_LEN (=64) integers in ascending order.
+*/
+static void
+network_sort_s64(span_s64 s) {
+	must(s.len <= SORT_NETWORK_MAX_LEN);
+	if (s.len < 2) {
+		return;
+	}
+
+	if (cpu_has_feature(CPU_FEATURE_AVX2)) {
+		network_sort_s64_avx2(s.ptr, s.len);
+	} else {
+		network_sort_s64_base(s.ptr, s.len);
+	}
+}
+
+/*/doc
+
+Sorts span of at most SORT_NETWORK_MAX_LEN (=64) integers in ascending order.
+*/
+static void
+network_sort_u64(span_u64 s) {
+	must(s.len <= SORT_NETWORK_MAX_LEN);
+	if (s.len < 2) {
+		return;
+	}
+
+	if (cpu_has_feature(CPU_FEATURE_AVX2)) {
+		network_sort_u64_avx2(s.ptr, s.len);
+	} else {
+		network_sort_u64_base(s.ptr, s.len);
+	}
+}
+
+/*/doc
+
+Sorts span of at most SORT_NETWORK_MAX_LEN (=64) integers in ascending order.
+*/
+static void
+network_sort_u32(span_u32 s) {
+	must(s.len <= SORT_NETWORK_MAX_LEN);
+	if (s.len < 2) {
+		return;
+	}
+
+	if (cpu_has_feature(CPU_FEATURE_AVX2)) {
+		network_sort_u32_avx2(s.ptr, s.len);
+	} else {
+		network_sort_u32_base(s.ptr, s.len);
+	}
+}
+
+/*/doc
+
+Sorts span of at most SORT_NETWORK_MAX_LEN (=64) floats in ascending order.
+Intended for things like sorting per-tile depth values.
+*/
+static void
+network_sort_f32(span_f32 s) {
+	must(s.len <= SORT_NETWORK_MAX_LEN);
+	if (s.len < 2) {
+		return;
+	}
+
+	if (cpu_has_feature(CPU_FEATURE_AVX2)) {
+		network_sort_f32_avx2(s.ptr, s.len);
+	} else {
+		network_sort_f32_base(s.ptr, s.len);
+	}
+}
@@ -0,0 +1,317 @@
+/*/doc
+
+Parallel sample sort for integer spans. Uses raw threads from core
+and {intro_sort_s64(...)} for sorting individual buckets.
+
+Algorithm has four phases:
+
+	1. pick sample from input and choose bucket splitters from it
+	2. each thread classifies its contiguous block of input and counts bucket sizes
+	3. each thread moves elements of its block into their buckets inside scratch buffer
+	4. each thread copies back its range of buckets and sorts them
+
+All work partitioning depends only on input data and number of threads, thus
+the whole process is deterministic.
+*/
+
+// Maximum number of splitters. Number of buckets is at most 2 * SAMPLE_SORT_MAX_SPLITTERS + 1,
+// because each unique splitter gets its own equality bucket.
+#define SAMPLE_SORT_MAX_SPLITTERS 255
+
+// How many sample elements are taken for each splitter.
+#define SAMPLE_SORT_OVERSAMPLE 16
+
+#define SAMPLE_SORT_MAX_BUCKETS (2 * SAMPLE_SORT_MAX_SPLITTERS + 1)
+
+#define SAMPLE_SORT_MAX_THREADS 64
+
+// Spans shorter than this are sorted on a single thread.
+#define SAMPLE_SORT_MIN_PARALLEL_LEN (1 << 16)
+
+typedef struct {
+	// Sorted unique splitters.
+	s64 splitters[SAMPLE_SORT_MAX_SPLITTERS];
+
+	// Splitters shifted by one position: {shifted[i] == splitters[i - 1]}.
+	// Element at index 0 is never used in comparisons. Allows branchless
+	// equality bucket check.
+	s64 shifted[SAMPLE_SORT_MAX_SPLITTERS + 1];
+
+	// Number of stored splitters.
+	uint num_splitters;
+
+	// Number of buckets. Equals 2 * {num_splitters} + 1.
+	uint num_buckets;
+} SampleSortClassifier;
+
+/*/doc
+
+Returns bucket index for a given integer. Even buckets hold elements strictly
+between two adjacent splitters. Odd buckets hold elements equal to splitter.
+*/
+static uint
+sample_sort_classify(const SampleSortClassifier* c, s64 x) {
+	// branchless search for number of splitters <= x
+	const s64* base = c->splitters;
+	uint n = c->num_splitters;
+	while (n > 1) {
+		uint half = n >> 1;
+		base = (base[half] <= x) ? base + half : base;
+		n -= half;
+	}
+	uint i = cast(uint, base - c->splitters) + cast(uint, *base <= x);
+
+	uint eq = cast(uint, i != 0) & cast(uint, c->shifted[i] == x);
+	return 2 * i - eq;
+}
+
+/*/doc
+
+Deterministic pseudo-random index generator for picking sample positions.
+*/
+static u64
+sample_sort_mix(u64 x) {
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+static void
+init_sample_sort_classifier(SampleSortClassifier* c, span_s64 s, uint num_buckets) {
+	must(num_buckets >= 2);
+	uint want = min_uint(num_buckets - 1, SAMPLE_SORT_MAX_SPLITTERS);
+
+	s64 sample_buf[SAMPLE_SORT_MAX_SPLITTERS * SAMPLE_SORT_OVERSAMPLE];
+	uint sample_len = want * SAMPLE_SORT_OVERSAMPLE;
+	for (uint i = 0; i < sample_len; i += 1) {
+		u64 k = sample_sort_mix(i + 1) % s.len;
+		sample_buf[i] = s.ptr[k];
+	}
+	span_s64 sample = make_span_s64(sample_buf, sample_len);
+	intro_sort_s64(sample);
+
+	uint n = 0;
+	for (uint i = 1; i <= want; i += 1) {
+		s64 x = sample.ptr[i * SAMPLE_SORT_OVERSAMPLE - 1];
+		if (n != 0 && c->splitters[n - 1] == x) {
+			continue;
+		}
+		c->splitters[n] = x;
+		n += 1;
+	}
+
+	c->num_splitters = n;
+	c->num_buckets = 2 * n + 1;
+	c->shifted[0] = 0;
+	for (uint i = 0; i < n; i += 1) {
+		c->shifted[i + 1] = c->splitters[i];
+	}
+}
+
+/*/doc
+
+Per-thread state for all phases of sample sort.
+*/
+typedef struct {
+	// Element counts for each bucket in this thread block.
+	// After prefix sum contains write positions inside scratch buffer.
+	uint counts[SAMPLE_SORT_MAX_BUCKETS];
+
+	// Input block classified by this thread.
+	span_s64 block;
+
+	// Range of buckets sorted by this thread in the last phase.
+	uint bucket_start;
+	uint bucket_end;
+
+	struct SampleSortContext* ctx;
+} SampleSortTask;
+
+typedef struct SampleSortContext {
+	SampleSortTask tasks[SAMPLE_SORT_MAX_THREADS];
+
+	SampleSortClassifier classifier;
+
+	// Start offsets of each bucket inside scratch buffer.
+	// Holds one extra element equal to total length.
+	uint bucket_offsets[SAMPLE_SORT_MAX_BUCKETS + 1];
+
+	span_s64 s;
+	span_s64 scratch;
+
+	uint num_threads;
+} SampleSortContext;
+
+static void
+sample_sort_count(void* arg) {
+	SampleSortTask* t = arg;
+	const SampleSortClassifier* c = &t->ctx->classifier;
+
+	for (uint i = 0; i < c->num_buckets; i += 1) {
+		t->counts[i] = 0;
+	}
+	for (uint i = 0; i < t->block.len; i += 1) {
+		t->counts[sample_sort_classify(c, t->block.ptr[i])] += 1;
+	}
+}
+
+static void
+sample_sort_distribute(void* arg) {
+	SampleSortTask* t = arg;
+	const SampleSortClassifier* c = &t->ctx->classifier;
+	s64* out = t->ctx->scratch.ptr;
+
+	for (uint i = 0; i < t->block.len; i += 1) {
+		s64 x = t->block.ptr[i];
+		uint b = sample_sort_classify(c, x);
+		out[t->counts[b]] = x;
+		t->counts[b] += 1;
+	}
+}
+
+static void
+sample_sort_local(void* arg) {
+	SampleSortTask* t = arg;
+	SampleSortContext* ctx = t->ctx;
+
+	for (uint b = t->bucket_start; b < t->bucket_end; b += 1) {
+		uint start = ctx->bucket_offsets[b];
+		uint end = ctx->bucket_offsets[b + 1];
+		if (start == end) {
+			continue;
+		}
+
+		span_s64 src = make_span_s64(ctx->scratch.ptr + start, end - start);
+		span_s64 dst = make_span_s64(ctx->s.ptr + start, end - start);
+		for (uint i = 0; i < src.len; i += 1) {
+			dst.ptr[i] = src.ptr[i];
+		}
+
+		if ((b & 1) == 0) {
+			// equality buckets (odd) are already sorted
+			intro_sort_s64(dst);
+		}
+	}
+}
+
+/*/doc
+
+Runs {fn} for each task: one task on calling thread and the rest on spawned threads.
+Waits until all of them are finished.
+*/
+static void
+sample_sort_run_phase(SampleSortContext* ctx, OsThreadFunc fn) {
+	OsThread threads[SAMPLE_SORT_MAX_THREADS];
+	bool started[SAMPLE_SORT_MAX_THREADS];
+
+	for (uint i = 1; i < ctx->num_threads; i += 1) {
+		ErrorCode code = os_thread_start(&threads[i], fn, &ctx->tasks[i]);
+		started[i] = code == 0;
+		if (!started[i]) {
+			// not enough resources for a thread, do its work here
+			fn(&ctx->tasks[i]);
+		}
+	}
+
+	fn(&ctx->tasks[0]);
+
+	for (uint i = 1; i < ctx->num_threads; i += 1) {
+		if (started[i]) {
+			os_thread_join(&threads[i]);
+		}
+	}
+}
+
+/*/doc
+
+Assigns contiguous ranges of buckets to tasks such that each task
+gets roughly equal number of elements to sort.
+*/
+static void
+sample_sort_assign_buckets(SampleSortContext* ctx) {
+	const uint num_buckets = ctx->classifier.num_buckets;
+	const uint p = ctx->num_threads;
+	const uint n = ctx->s.len;
+
+	uint b = 0;
+	for (uint t = 0; t < p; t += 1) {
+		ctx->tasks[t].bucket_start = b;
+
+		// boundary (in elements) at which this task range ends
+		uint limit = cast(uint, (cast(u128, n) * (t + 1)) / p);
+		if (t + 1 == p) {
+			b = num_buckets;
+		}
+		while (b < num_buckets && ctx->bucket_offsets[b + 1] <= limit) {
+			b += 1;
+		}
+		ctx->tasks[t].bucket_end = b;
+	}
+}
+
+/*/doc
+
+Sorts span of integers in ascending order using {num_threads} threads.
+
+Scratch buffer must be at least as long as sorted span. Its contents after
+the call are unspecified.
+
+Number of threads is clamped to range [1, SAMPLE_SORT_MAX_THREADS].
+*/
+static void
+sample_sort_s64(span_s64 s, span_s64 scratch, uint num_threads) {
+	must(scratch.len >= s.len);
+
+	if (num_threads > SAMPLE_SORT_MAX_THREADS) {
+		num_threads = SAMPLE_SORT_MAX_THREADS;
+	}
+	if (num_threads <= 1 || s.len < SAMPLE_SORT_MIN_PARALLEL_LEN) {
+		intro_sort_s64(s);
+		return;
+	}
+
+	MemBlock block = {};
+	block.span.len = sizeof(SampleSortContext);
+	ErrorCode code = os_linux_mem_alloc(&block);
+	if (code != 0) {
+		intro_sort_s64(s);
+		return;
+	}
+
+	SampleSortContext* ctx = cast(SampleSortContext*, block.span.ptr);
+	ctx->s = s;
+	ctx->scratch = scratch;
+	ctx->num_threads = num_threads;
+
+	init_sample_sort_classifier(&ctx->classifier, s, min_uint(8 * num_threads, SAMPLE_SORT_MAX_SPLITTERS + 1));
+	const uint num_buckets = ctx->classifier.num_buckets;
+
+	for (uint t = 0; t < num_threads; t += 1) {
+		uint start = cast(uint, (cast(u128, s.len) * t) / num_threads);
+		uint end = cast(uint, (cast(u128, s.len) * (t + 1)) / num_threads);
+		ctx->tasks[t].block = make_span_s64(s.ptr + start, end - start);
+		ctx->tasks[t].ctx = ctx;
+	}
+
+	sample_sort_run_phase(ctx, sample_sort_count);
+
+	// exclusive prefix sum over (bucket, thread) pairs turns counts into write positions
+	uint pos = 0;
+	for (uint b = 0; b < num_buckets; b += 1) {
+		ctx->bucket_offsets[b] = pos;
+		for (uint t = 0; t < num_threads; t += 1) {
+			uint c = ctx->tasks[t].counts[b];
+			ctx->tasks[t].counts[b] = pos;
+			pos += c;
+		}
+	}
+	ctx->bucket_offsets[num_buckets] = pos;
+	must(pos == s.len);
+
+	sample_sort_run_phase(ctx, sample_sort_distribute);
+
+	sample_sort_assign_buckets(ctx);
+	sample_sort_run_phase(ctx, sample_sort_local);
+
+	os_linux_mem_free(block);
+}
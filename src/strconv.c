@@ -2,9 +2,22 @@ typedef struct {
     // Contains parsed integer if {code} equals 0.
     u64 n;
 
+    // Number of bytes consumed from input string if {code} equals 0.
+    uint len;
+
     ErrorCode code;
 } RetParseU64;
 
+typedef struct {
+    // Contains parsed integer if {code} equals 0.
+    s64 n;
+
+    // Number of bytes consumed from input string if {code} equals 0.
+    uint len;
+
+    ErrorCode code;
+} RetParseS64;
+
 static bool
 is_dec_digit(u8 x) {
     return ('0' <= x) && (x <= '9');
@@ -18,6 +31,285 @@ dec_digit_num(u8 x) {
 #define ERROR_EMPTY_STRING       2
 #define ERROR_BAD_INTEGER_FORMAT 3
 #define ERROR_INTEGER_OVERFLOW   4
+#define ERROR_BAD_FLOAT_FORMAT   5
+
+// Number of decimal digits which always fit into u64 without overflow.
+#define STRCONV_SAFE_DEC_DIGITS 19
+
+// Maximum number of significant hex digits in u64.
+#define STRCONV_MAX_HEX_DIGITS 16
+
+#define STRCONV_SWAR_ONES 0x0101010101010101ULL
+#define STRCONV_SWAR_HIGH 0x8080808080808080ULL
+
+static const u64 strconv_pow10[9] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+};
+
+/*/doc
+
+Loads 8 bytes of a string starting at a given index into integer, first byte
+goes into the lowest one. Bytes past the end of string are set to zero,
+which is not a digit in any base. String must be at least 8 bytes long,
+then bytes near the end are loaded from the last 8 bytes without
+reading outside of string.
+*/
+static u64
+strconv_load_8(str s, uint i) {
+    u64 x;
+    if (s.len - i >= 8) {
+        __builtin_memcpy(&x, s.ptr + i, 8);
+        return x;
+    }
+
+    __builtin_memcpy(&x, s.ptr + s.len - 8, 8);
+    // two shifts, since shift by 64 bits is undefined
+    return (x >> (8 * (7 - (s.len - i)))) >> 8;
+}
+
+/*/doc
+
+Sets high bit of each byte which is not less than c, clears other bits.
+Bytes must have high bit cleared, thus additions never carry into
+neighbour byte.
+*/
+static u64
+strconv_swar_ge(u64 x, u8 c) {
+    return (x + (0x80 - c) * STRCONV_SWAR_ONES) & STRCONV_SWAR_HIGH;
+}
+
+/*/doc
+
+Sets high bit of each byte which is decimal digit, clears other bits.
+*/
+static u64
+strconv_swar_dec_mask(u64 x) {
+    const u64 low = x & ~STRCONV_SWAR_HIGH;
+    const u64 digits = strconv_swar_ge(low, '0') & ~strconv_swar_ge(low, '9' + 1);
+    return digits & ~(x & STRCONV_SWAR_HIGH);
+}
+
+/*/doc
+
+Sets high bit of each byte which is hex digit (either case), clears other bits.
+*/
+static u64
+strconv_swar_hex_mask(u64 x) {
+    const u64 low = x & ~STRCONV_SWAR_HIGH;
+    const u64 digits = strconv_swar_ge(low, '0') & ~strconv_swar_ge(low, '9' + 1);
+    const u64 lower = low | (0x20 * STRCONV_SWAR_ONES);
+    const u64 letters = strconv_swar_ge(lower, 'a') & ~strconv_swar_ge(lower, 'f' + 1);
+    return (digits | letters) & ~(x & STRCONV_SWAR_HIGH);
+}
+
+/*/doc
+
+Returns number of leading bytes which have high bit set in a given mask.
+*/
+static uint
+strconv_swar_leading(u64 mask) {
+    const u64 rest = ~mask & STRCONV_SWAR_HIGH;
+    if (rest == 0) {
+        return 8;
+    }
+    return cast(uint, __builtin_ctzl(rest)) >> 3;
+}
+
+/*/doc
+
+Moves k leading bytes (k in range [1, 8]) to the end of integer and
+fills vacated bytes with a given value. After that bytes can be
+processed as fixed-width number of 8 digits.
+*/
+static u64
+strconv_swar_align(u64 x, uint k, u64 fill) {
+    if (k == 8) {
+        return x;
+    }
+    const uint shift = 8 * (8 - k);
+    return (x << shift) | (fill >> (8 * k));
+}
+
+/*/doc
+
+Converts 8 decimal digit characters into number. Multiplications combine
+adjacent digits pairwise: 8 digits become 4 numbers of 2 digits,
+then 2 numbers of 4 digits and finally one number.
+*/
+static u64
+strconv_swar_parse_8_dec(u64 x) {
+    x -= '0' * STRCONV_SWAR_ONES;
+    x = (x * 10) + (x >> 8);
+    x = (((x & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))) +
+        (((x >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32;
+    return x;
+}
+
+/*/doc
+
+Converts 8 hex digit characters into number.
+*/
+static u64
+strconv_swar_parse_8_hex(u64 x) {
+    // digits have value in low nibble, letters have it offset by 9
+    x = (x & (0x0f * STRCONV_SWAR_ONES)) + 9 * ((x >> 6) & STRCONV_SWAR_ONES);
+
+    x = ((x << 4) | (x >> 8)) & 0x00ff00ff00ff00ffULL;
+    x = ((x << 8) | (x >> 16)) & 0x0000ffff0000ffffULL;
+    x = ((x << 16) | (x >> 32)) & 0x00000000ffffffffULL;
+    return x;
+}
+
+/*/doc
+
+Returns number of leading decimal digits among 16 bytes.
+*/
+TARGET_AVX2 static uint
+strconv_sse_leading_dec_16(const u8* p) {
+    vec16_u8 v;
+    simd_load(v, p);
+
+    // digit bytes become values in range [0, 9], unsigned comparison
+    // rejects everything else including bytes below '0'
+    const vec16_u8 d = v - '0';
+    const vec16_u8 is_digit = cast(vec16_u8, d <= 9);
+    const uint mask = cast(uint, __builtin_ia32_pmovmskb128(cast(vec16_char, is_digit)));
+    return cast(uint, __builtin_ctzl(~mask));
+}
+
+/*/doc
+
+Converts 16 decimal digit characters into number. Same pairwise scheme
+as in {strconv_swar_parse_8_dec(...)}, but with SSE multiply-add
+instructions on all 16 digits at once.
+*/
+TARGET_AVX2 static u64
+strconv_sse_parse_16_dec(const u8* p) {
+    vec16_u8 v;
+    simd_load(v, p);
+    v -= '0';
+
+    const vec16_u8 m1 = {10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1};
+    const vec8_s16 m2 = {100, 1, 100, 1, 100, 1, 100, 1};
+    const vec8_s16 m4 = {10000, 1, 10000, 1, 10000, 1, 10000, 1};
+
+    const vec8_s16 t2 = __builtin_ia32_pmaddubsw128(cast(vec16_char, v), cast(vec16_char, m1));
+    const vec4_s32 t4 = __builtin_ia32_pmaddwd128(t2, m2);
+    const vec8_s16 t4p = __builtin_ia32_packusdw128(t4, t4);
+    const vec4_s32 t8 = __builtin_ia32_pmaddwd128(t4p, m4);
+
+    return cast(u64, cast(u32, t8[0])) * 100000000 + cast(u32, t8[1]);
+}
+
+/*/doc
+
+Continues {parse_dec_u64_prefix(...)} for numbers which have at least 16 digits.
+
+Leading zeros do not count towards overflow. First 19 significant digits
+are converted 16 or 8 at a time without checks, since they always fit
+into u64, further digits are checked one by one.
+*/
+static __attribute__((noinline)) RetParseU64
+parse_dec_u64_prefix_long(str s) {
+    RetParseU64 ret = {};
+
+    const u8* p = s.ptr;
+    uint i = 0;
+    while (i < s.len && p[i] == '0') {
+        i += 1;
+    }
+    const uint start = i;
+
+    u64 n = 0;
+    if (s.len - i >= 16 && cpu_has_feature(CPU_FEATURE_AVX2) && strconv_sse_leading_dec_16(p + i) == 16) {
+        n = strconv_sse_parse_16_dec(p + i);
+        i += 16;
+    }
+
+    while (true) {
+        const u64 x = strconv_load_8(s, i);
+        const uint k = strconv_swar_leading(strconv_swar_dec_mask(x));
+        if (k == 0 || i - start + k > STRCONV_SAFE_DEC_DIGITS) {
+            break;
+        }
+
+        n = n * strconv_pow10[k] + strconv_swar_parse_8_dec(strconv_swar_align(x, k, '0' * STRCONV_SWAR_ONES));
+        i += k;
+        if (k < 8) {
+            break;
+        }
+    }
+
+    while (i < s.len && is_dec_digit(p[i])) {
+        if (__builtin_mul_overflow(n, 10, &n) || __builtin_add_overflow(n, dec_digit_num(p[i]), &n)) {
+            ret.code = ERROR_INTEGER_OVERFLOW;
+            return ret;
+        }
+        i += 1;
+    }
+
+    ret.n = n;
+    ret.len = i;
+    return ret;
+}
+
+/*/doc
+
+Parse u64 integer from the start of a given string. Parsing stops at
+the first non-decimal digit character, number of consumed bytes is
+returned in {len} field. At least one digit is required.
+
+When at least 8 bytes are available, numbers shorter than 16 digits are
+converted without loop over digits: digits are located and converted
+with a few operations on 8 bytes loaded as one integer.
+*/
+static RetParseU64
+parse_dec_u64_prefix(str s) {
+    RetParseU64 ret = {};
+    if (s.len < 8) {
+        // too few digits to overflow
+        u64 n = 0;
+        uint i = 0;
+        while (i < s.len && is_dec_digit(s.ptr[i])) {
+            n = n * 10 + dec_digit_num(s.ptr[i]);
+            i += 1;
+        }
+        if (i == 0) {
+            ret.code = s.len == 0 ? ERROR_EMPTY_STRING : ERROR_BAD_INTEGER_FORMAT;
+            return ret;
+        }
+        ret.n = n;
+        ret.len = i;
+        return ret;
+    }
+
+    const u64 fill = '0' * STRCONV_SWAR_ONES;
+    const u64 x = strconv_load_8(s, 0);
+    const uint k = strconv_swar_leading(strconv_swar_dec_mask(x));
+    if (k == 0) {
+        ret.code = ERROR_BAD_INTEGER_FORMAT;
+        return ret;
+    }
+    if (k < 8) {
+        ret.n = strconv_swar_parse_8_dec(strconv_swar_align(x, k, fill));
+        ret.len = k;
+        return ret;
+    }
+
+    // numbers shorter than 16 digits always fit into u64
+    const u64 y = strconv_load_8(s, 8);
+    const uint m = strconv_swar_leading(strconv_swar_dec_mask(y));
+    if (m == 8) {
+        return parse_dec_u64_prefix_long(s);
+    }
+    u64 n = strconv_swar_parse_8_dec(x);
+    if (m != 0) {
+        n = n * strconv_pow10[m] + strconv_swar_parse_8_dec(strconv_swar_align(y, m, fill));
+    }
+    ret.n = n;
+    ret.len = 8 + m;
+    return ret;
+}
 
 /*/doc
 
@@ -26,30 +318,140 @@ trailing spaces or any other non-decimal digit characters.
 */
 static RetParseU64
 parse_dec_u64(str s) {
-    RetParseU64 ret = {};
+    RetParseU64 ret = parse_dec_u64_prefix(s);
+    if (ret.code == 0 && ret.len != s.len) {
+        ret.n = 0;
+        ret.code = ERROR_BAD_INTEGER_FORMAT;
+    }
+    return ret;
+}
+
+/*/doc
+
+Parse s64 integer from the start of a given string. Integer may have
+leading sign character ('-' or '+'). Otherwise same as
+{parse_dec_u64_prefix(...)}.
+*/
+static RetParseS64
+parse_dec_s64_prefix(str s) {
+    RetParseS64 ret = {};
     if (s.len == 0) {
         ret.code = ERROR_EMPTY_STRING;
         return ret;
     }
-    if (s.len > max_u64_dec_length) {
+
+    const bool neg = s.ptr[0] == '-';
+    const uint sign_len = (neg || s.ptr[0] == '+') ? 1 : 0;
+    RetParseU64 r = parse_dec_u64_prefix(span_u8_slice_tail(s, sign_len));
+    if (r.code == ERROR_EMPTY_STRING) {
+        // sign without digits
+        ret.code = ERROR_BAD_INTEGER_FORMAT;
+        return ret;
+    }
+    if (r.code != 0) {
+        ret.code = r.code;
+        return ret;
+    }
+
+    // magnitude of negative number may be one greater than maximum positive
+    const u64 limit = (cast(u64, 1) << 63) - (neg ? 0 : 1);
+    if (r.n > limit) {
         ret.code = ERROR_INTEGER_OVERFLOW;
         return ret;
     }
 
-    u64 n = 0;
+    ret.n = neg ? cast(s64, 0 - r.n) : cast(s64, r.n);
+    ret.len = sign_len + r.len;
+    return ret;
+}
+
+/*/doc
+
+Parse s64 integer from a given string. Same as {parse_dec_u64(...)},
+but accepts leading sign character.
+*/
+static RetParseS64
+parse_dec_s64(str s) {
+    RetParseS64 ret = parse_dec_s64_prefix(s);
+    if (ret.code == 0 && ret.len != s.len) {
+        ret.n = 0;
+        ret.code = ERROR_BAD_INTEGER_FORMAT;
+    }
+    return ret;
+}
+
+/*/doc
+
+Parse u64 integer in hex format from the start of a given string.
+Digits may be in either case, no prefix ("0x") is expected. Parsing
+stops at the first non-hex digit character, number of consumed bytes
+is returned in {len} field. At least one digit is required.
+*/
+static RetParseU64
+parse_hex_u64_prefix(str s) {
+    RetParseU64 ret = {};
+    if (s.len == 0) {
+        ret.code = ERROR_EMPTY_STRING;
+        return ret;
+    }
+
+    // short string is copied into zero padded buffer, so that
+    // it can be loaded as one integer
+    u8 buf[8] = {};
+    if (s.len < 8) {
+        for (uint j = 0; j < s.len; j += 1) {
+            buf[j] = s.ptr[j];
+        }
+        s = make_str(buf, 8);
+    }
+
+    const u8* p = s.ptr;
     uint i = 0;
-    while (i < s.len) {
-        u8 c = s.ptr[i];
-        if (!is_dec_digit(c)) {
-            ret.code = ERROR_BAD_INTEGER_FORMAT;
+    while (i < s.len && p[i] == '0') {
+        i += 1;
+    }
+    const uint start = i;
+
+    u64 n = 0;
+    while (true) {
+        const u64 x = strconv_load_8(s, i);
+        const uint k = strconv_swar_leading(strconv_swar_hex_mask(x));
+        if (k == 0) {
+            break;
+        }
+        if (i - start + k > STRCONV_MAX_HEX_DIGITS) {
+            ret.code = ERROR_INTEGER_OVERFLOW;
             return ret;
         }
-        
-        n = n * 10; // TODO: check for overflow in case when {s.len} is exactly  20
-        n += dec_digit_num(c);
-        i += 1;
+
+        n = (n << (4 * k)) | strconv_swar_parse_8_hex(strconv_swar_align(x, k, '0' * STRCONV_SWAR_ONES));
+        i += k;
+        if (k < 8) {
+            break;
+        }
+    }
+
+    if (i == 0) {
+        ret.code = ERROR_BAD_INTEGER_FORMAT;
+        return ret;
     }
 
     ret.n = n;
+    ret.len = i;
+    return ret;
+}
+
+/*/doc
+
+Parse u64 integer in hex format from a given string. It must not contain
+prefix, leading or trailing spaces or any other non-hex digit characters.
+*/
+static RetParseU64
+parse_hex_u64(str s) {
+    RetParseU64 ret = parse_hex_u64_prefix(s);
+    if (ret.code == 0 && ret.len != s.len) {
+        ret.n = 0;
+        ret.code = ERROR_BAD_INTEGER_FORMAT;
+    }
     return ret;
 }
@@ -0,0 +1,792 @@
+/*/doc
+
+Parsing of floating point numbers from decimal text. Depends on strconv.c.
+
+Accepted format is optional sign, digits with optional decimal point and
+optional exponent (1, -1.5, .5, 2., 1e10, 6.02E+23), or one of special
+values inf, infinity and nan (case insensitive). Result is correctly
+rounded (round half to even) for any number of digits. Numbers too large
+for the type become infinity, too small ones become zero.
+
+Conversion goes through three stages, each next one is slower and rarely
+needed:
+
+    1. Significand and power of ten are small enough for exact float
+       arithmetic: one multiplication or division gives correct result.
+
+    2. Eisel-Lemire algorithm: significand (up to 19 digits) is multiplied
+       by 128-bit approximation of power of ten. Result is exact unless
+       product is too close to a halfway point between two floats.
+
+    3. Digits are converted with exact decimal arithmetic
+       (multiplications and divisions by powers of two).
+*/
+
+typedef struct {
+    // Contains parsed number if {code} equals 0.
+    f64 n;
+
+    // Number of bytes consumed from input string if {code} equals 0.
+    uint len;
+
+    ErrorCode code;
+} RetParseF64;
+
+typedef struct {
+    // Contains parsed number if {code} equals 0.
+    f32 n;
+
+    // Number of bytes consumed from input string if {code} equals 0.
+    uint len;
+
+    ErrorCode code;
+} RetParseF32;
+
+/*/doc
+
+Describes binary floating point format.
+*/
+typedef struct {
+    // Number of explicitly stored significand bits.
+    u32 mant_bits;
+
+    // Number of exponent bits.
+    u32 exp_bits;
+
+    // Exponent of the smallest normal number minus 1.
+    s32 bias;
+
+    // Decimal exponents outside of this range always give zero or infinity
+    // for significand of at most 19 digits.
+    s32 min_pow10;
+    s32 max_pow10;
+
+    // Range of decimal exponents where Eisel-Lemire algorithm may
+    // encounter exact halfway point between two floats.
+    s32 min_round_even;
+    s32 max_round_even;
+} StrconvFloatInfo;
+
+static const StrconvFloatInfo strconv_float_info_f64 = {
+    .mant_bits = 52,
+    .exp_bits = 11,
+    .bias = -1023,
+    .min_pow10 = -342,
+    .max_pow10 = 308,
+    .min_round_even = -4,
+    .max_round_even = 23,
+};
+
+static const StrconvFloatInfo strconv_float_info_f32 = {
+    .mant_bits = 23,
+    .exp_bits = 8,
+    .bias = -127,
+    .min_pow10 = -65,
+    .max_pow10 = 38,
+    .min_round_even = -17,
+    .max_round_even = 10,
+};
+
+#define STRCONV_FLOAT_KIND_NUMBER 0
+#define STRCONV_FLOAT_KIND_INF    1
+#define STRCONV_FLOAT_KIND_NAN    2
+
+/*/doc
+
+Result of scanning float text. Value is {w * 10^q}.
+*/
+typedef struct {
+    // First (up to 19) significant digits.
+    u64 w;
+
+    s64 q;
+
+    // Position and length of integer and fractional digits.
+    // Used by exact conversion.
+    uint int_start;
+    uint int_len;
+    uint frac_start;
+    uint frac_len;
+
+    // Decimal exponent written in text.
+    s64 exp;
+
+    // Number of bytes which form number.
+    uint len;
+
+    ErrorCode code;
+
+    // Set if nonzero digits did not fit into {w}.
+    bool truncated;
+
+    bool neg;
+
+    u8 kind;
+} StrconvFloatScan;
+
+// Larger exponents in text are clamped to this value, result is zero or
+// infinity anyway.
+#define STRCONV_FLOAT_MAX_EXP 100000
+
+static bool
+strconv_is_prefix_fold(str s, uint i, str word) {
+    if (s.len - i < word.len) {
+        return false;
+    }
+    for (uint j = 0; j < word.len; j += 1) {
+        // ASCII letters differ in case by single bit
+        if ((s.ptr[i + j] | 0x20) != word.ptr[j]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    u64 w;
+
+    // Number of significant digits accumulated so far.
+    uint taken;
+
+    // Number of digits which did not fit into significand.
+    uint dropped;
+
+    // Set if any of dropped digits is not zero.
+    bool truncated;
+} StrconvFloatDigits;
+
+/*/doc
+
+Appends decimal digits starting at index i to significand. Digits after
+the first 19 significant ones are not accumulated, their count is stored
+in {dropped}. Returns index after the last digit.
+*/
+static uint
+strconv_float_scan_digits(str s, uint i, StrconvFloatDigits* d) {
+    // 8 digits at a time while they are guaranteed to fit
+    while (s.len - i >= 8 && d->taken + 8 <= STRCONV_SAFE_DEC_DIGITS) {
+        u64 x;
+        __builtin_memcpy(&x, s.ptr + i, 8);
+        if (strconv_swar_leading(strconv_swar_dec_mask(x)) != 8) {
+            break;
+        }
+        if (d->taken == 0 && x == '0' * STRCONV_SWAR_ONES) {
+            // leading zeroes are not significant
+            i += 8;
+            continue;
+        }
+        d->w = d->w * 100000000 + strconv_swar_parse_8_dec(x);
+        d->taken += 8;
+        i += 8;
+    }
+
+    while (i < s.len && is_dec_digit(s.ptr[i])) {
+        const u8 c = dec_digit_num(s.ptr[i]);
+        if (d->taken == 0 && c == 0) {
+            i += 1;
+            continue;
+        }
+        if (d->taken < STRCONV_SAFE_DEC_DIGITS) {
+            d->w = d->w * 10 + c;
+            d->taken += 1;
+        } else {
+            d->dropped += 1;
+            if (c != 0) {
+                d->truncated = true;
+            }
+        }
+        i += 1;
+    }
+    return i;
+}
+
+static StrconvFloatScan
+strconv_float_scan(str s) {
+    StrconvFloatScan r = {};
+    if (s.len == 0) {
+        r.code = ERROR_EMPTY_STRING;
+        return r;
+    }
+
+    uint i = 0;
+    if (s.ptr[0] == '-' || s.ptr[0] == '+') {
+        r.neg = s.ptr[0] == '-';
+        i = 1;
+    }
+
+    if (strconv_is_prefix_fold(s, i, ss("inf"))) {
+        r.kind = STRCONV_FLOAT_KIND_INF;
+        r.len = i + (strconv_is_prefix_fold(s, i, ss("infinity")) ? 8 : 3);
+        return r;
+    }
+    if (strconv_is_prefix_fold(s, i, ss("nan"))) {
+        r.kind = STRCONV_FLOAT_KIND_NAN;
+        r.len = i + 3;
+        return r;
+    }
+
+    StrconvFloatDigits d = {};
+    r.int_start = i;
+    i = strconv_float_scan_digits(s, i, &d);
+    r.int_len = i - r.int_start;
+
+    if (i < s.len && s.ptr[i] == '.') {
+        i += 1;
+        r.frac_start = i;
+        i = strconv_float_scan_digits(s, i, &d);
+        r.frac_len = i - r.frac_start;
+    }
+    if (r.int_len == 0 && r.frac_len == 0) {
+        r.code = ERROR_BAD_FLOAT_FORMAT;
+        return r;
+    }
+
+    if (i < s.len && (s.ptr[i] == 'e' || s.ptr[i] == 'E')) {
+        uint j = i + 1;
+        bool exp_neg = false;
+        if (j < s.len && (s.ptr[j] == '-' || s.ptr[j] == '+')) {
+            exp_neg = s.ptr[j] == '-';
+            j += 1;
+        }
+
+        // without digits letter is not a part of number
+        if (j < s.len && is_dec_digit(s.ptr[j])) {
+            s64 e = 0;
+            while (j < s.len && is_dec_digit(s.ptr[j])) {
+                if (e < STRCONV_FLOAT_MAX_EXP) {
+                    e = e * 10 + dec_digit_num(s.ptr[j]);
+                }
+                j += 1;
+            }
+            r.exp = exp_neg ? -e : e;
+            i = j;
+        }
+    }
+
+    // all digits form one integer, dropped ones still count
+    // towards its magnitude
+    r.w = d.w;
+    r.q = cast(s64, d.dropped) - cast(s64, r.frac_len) + r.exp;
+    r.truncated = d.truncated;
+    r.len = i;
+    return r;
+}
+
+typedef struct {
+    u64 bits;
+
+    // False if result cannot be determined.
+    bool ok;
+} RetStrconvFloatBits;
+
+/*/doc
+
+Eisel-Lemire algorithm (D. Lemire, "Number Parsing at a Gigabyte per
+Second"). Converts {w * 10^q} into float bits (without sign).
+
+Significand is normalized and multiplied by 128-bit approximation of
+power of ten. Top bits of product are correct unless lower bits are all
+ones, in which case result is reported as undetermined.
+*/
+static RetStrconvFloatBits
+strconv_eisel_lemire(u64 w, s64 q, const StrconvFloatInfo* info) {
+    RetStrconvFloatBits ret = {};
+    ret.ok = true;
+
+    const u64 inf_power = (cast(u64, 1) << info->exp_bits) - 1;
+    if (w == 0 || q < info->min_pow10) {
+        return ret;
+    }
+    if (q > info->max_pow10) {
+        ret.bits = inf_power << info->mant_bits;
+        return ret;
+    }
+
+    const uint lz = cast(uint, __builtin_clzl(w));
+    w <<= lz;
+
+    // negative powers are taken rounded up, thus product of exactly
+    // halfway input has zero low bits and round to even check works
+    FloatPow10 p = float_pow10_floor(cast(s32, q));
+    if (q < 0) {
+        p.lo += 1;
+        p.hi += p.lo == 0;
+    }
+    const u128 first = cast(u128, w) * p.hi;
+    u64 hi = cast(u64, first >> 64);
+    u64 lo = cast(u64, first);
+
+    // bits below significand (plus rounding bits) are all ones,
+    // lower half of power may affect them
+    const u64 precision_mask = ~cast(u64, 0) >> (info->mant_bits + 3);
+    if ((hi & precision_mask) == precision_mask) {
+        const u64 second_hi = cast(u64, (cast(u128, w) * p.lo) >> 64);
+        lo += second_hi;
+        if (lo < second_hi) {
+            hi += 1;
+        }
+        if (lo == ~cast(u64, 0) && (q < -27 || q > 55)) {
+            ret.ok = false;
+            return ret;
+        }
+    }
+
+    const uint upper_bit = cast(uint, hi >> 63);
+    const uint shift = upper_bit + 64 - info->mant_bits - 3;
+    u64 mant = hi >> shift;
+    s64 power2 = float_floor_log2_pow10(cast(s32, q)) + 63 + cast(s64, upper_bit) - cast(s64, lz) - info->bias;
+
+    if (power2 <= 0) {
+        // subnormal result
+        if (-power2 + 1 >= 64) {
+            return ret;
+        }
+        mant >>= -power2 + 1;
+        mant += mant & 1;
+        mant >>= 1;
+
+        // rounding may produce the smallest normal number, its hidden
+        // bit lands exactly into exponent field
+        ret.bits = mant;
+        return ret;
+    }
+
+    // product is exactly halfway between two floats, round to even
+    if (lo <= 1 && q >= info->min_round_even && q <= info->max_round_even && (mant & 3) == 1) {
+        if ((mant << shift) == hi) {
+            mant &= ~cast(u64, 1);
+        }
+    }
+
+    mant += mant & 1;
+    mant >>= 1;
+    if (mant >= (cast(u64, 2) << info->mant_bits)) {
+        mant = cast(u64, 1) << info->mant_bits;
+        power2 += 1;
+    }
+    mant &= ~(cast(u64, 1) << info->mant_bits);
+
+    if (cast(u64, power2) >= inf_power) {
+        ret.bits = inf_power << info->mant_bits;
+        return ret;
+    }
+    ret.bits = mant | (cast(u64, power2) << info->mant_bits);
+    return ret;
+}
+
+// Maximum number of digits stored for exact conversion. Any float
+// is uniquely determined by 800 significant digits and a flag telling
+// whether there were more nonzero ones.
+#define STRCONV_DECIMAL_MAX_DIGITS 800
+
+// Maximum shift of decimal by a power of two in one step.
+#define STRCONV_DECIMAL_MAX_SHIFT 60
+
+/*/doc
+
+Decimal number with arbitrary precision, value is 0.d[0]d[1]... * 10^dp.
+Used for exact conversion when faster methods fail.
+*/
+typedef struct {
+    // Digit values (not characters), no trailing zeroes.
+    u8 d[STRCONV_DECIMAL_MAX_DIGITS];
+
+    // Number of stored digits.
+    uint nd;
+
+    // Position of decimal point.
+    s64 dp;
+
+    // Set if nonzero digits were dropped.
+    bool trunc;
+} StrconvDecimal;
+
+static void
+strconv_decimal_trim(StrconvDecimal* a) {
+    while (a->nd != 0 && a->d[a->nd - 1] == 0) {
+        a->nd -= 1;
+    }
+    if (a->nd == 0) {
+        a->dp = 0;
+    }
+}
+
+static void
+strconv_decimal_put_digits(StrconvDecimal* a, str s) {
+    for (uint i = 0; i < s.len; i += 1) {
+        const u8 c = dec_digit_num(s.ptr[i]);
+        if (a->nd == 0 && c == 0) {
+            // leading zero after decimal point, before the first significant digit
+            a->dp -= 1;
+            continue;
+        }
+        if (a->nd < STRCONV_DECIMAL_MAX_DIGITS) {
+            a->d[a->nd] = c;
+            a->nd += 1;
+        } else if (c != 0) {
+            a->trunc = true;
+        }
+    }
+}
+
+static void
+strconv_decimal_init(StrconvDecimal* a, str s, const StrconvFloatScan* scan) {
+    a->nd = 0;
+    a->dp = 0;
+    a->trunc = false;
+
+    strconv_decimal_put_digits(a, str_slice(s, scan->int_start, scan->int_start + scan->int_len));
+    a->dp = cast(s64, a->nd);
+    strconv_decimal_put_digits(a, str_slice(s, scan->frac_start, scan->frac_start + scan->frac_len));
+    a->dp += scan->exp;
+    strconv_decimal_trim(a);
+}
+
+/*/doc
+
+Divides decimal by 2^k, k must not be greater than {STRCONV_DECIMAL_MAX_SHIFT}.
+*/
+static void
+strconv_decimal_right_shift(StrconvDecimal* a, uint k) {
+    uint r = 0;
+    uint w = 0;
+
+    // pick up enough leading digits to cover first shift
+    u64 n = 0;
+    while ((n >> k) == 0) {
+        if (r >= a->nd) {
+            if (n == 0) {
+                a->nd = 0;
+                return;
+            }
+            while ((n >> k) == 0) {
+                n *= 10;
+                r += 1;
+            }
+            break;
+        }
+        n = n * 10 + a->d[r];
+        r += 1;
+    }
+    a->dp -= cast(s64, r) - 1;
+
+    const u64 mask = (cast(u64, 1) << k) - 1;
+    while (r < a->nd) {
+        const u8 c = a->d[r];
+        a->d[w] = cast(u8, n >> k);
+        w += 1;
+        n = (n & mask) * 10 + c;
+        r += 1;
+    }
+
+    while (n != 0) {
+        const u8 dig = cast(u8, n >> k);
+        n &= mask;
+        if (w < STRCONV_DECIMAL_MAX_DIGITS) {
+            a->d[w] = dig;
+            w += 1;
+        } else if (dig != 0) {
+            a->trunc = true;
+        }
+        n *= 10;
+    }
+
+    a->nd = w;
+    strconv_decimal_trim(a);
+}
+
+/*/doc
+
+Multiplies decimal by 2^k, k must not be greater than {STRCONV_DECIMAL_MAX_SHIFT}.
+Digits of product are produced from the last one and stored in reverse
+order into temporary array first, since their count is not known
+in advance.
+*/
+static void
+strconv_decimal_left_shift(StrconvDecimal* a, uint k) {
+    // product of shift has at most 19 more digits
+    u8 tmp[STRCONV_DECIMAL_MAX_DIGITS + 20];
+    uint t = 0;
+
+    u64 n = 0;
+    for (uint r = a->nd; r != 0; r -= 1) {
+        n += cast(u64, a->d[r - 1]) << k;
+        const u64 quo = n / 10;
+        tmp[t] = cast(u8, n - 10 * quo);
+        t += 1;
+        n = quo;
+    }
+    while (n != 0) {
+        const u64 quo = n / 10;
+        tmp[t] = cast(u8, n - 10 * quo);
+        t += 1;
+        n = quo;
+    }
+
+    a->dp += cast(s64, t) - cast(s64, a->nd);
+    const uint nd = min_uint(t, STRCONV_DECIMAL_MAX_DIGITS);
+    for (uint j = 0; j < t; j += 1) {
+        const u8 c = tmp[t - 1 - j];
+        if (j < nd) {
+            a->d[j] = c;
+        } else if (c != 0) {
+            a->trunc = true;
+        }
+    }
+    a->nd = nd;
+    strconv_decimal_trim(a);
+}
+
+static void
+strconv_decimal_shift(StrconvDecimal* a, s64 k) {
+    if (a->nd == 0) {
+        return;
+    }
+    while (k > STRCONV_DECIMAL_MAX_SHIFT) {
+        strconv_decimal_left_shift(a, STRCONV_DECIMAL_MAX_SHIFT);
+        k -= STRCONV_DECIMAL_MAX_SHIFT;
+    }
+    if (k > 0) {
+        strconv_decimal_left_shift(a, cast(uint, k));
+    }
+    while (k < -STRCONV_DECIMAL_MAX_SHIFT) {
+        strconv_decimal_right_shift(a, STRCONV_DECIMAL_MAX_SHIFT);
+        k += STRCONV_DECIMAL_MAX_SHIFT;
+    }
+    if (k < 0) {
+        strconv_decimal_right_shift(a, cast(uint, -k));
+    }
+}
+
+/*/doc
+
+Returns integer part of decimal rounded to nearest, ties to even.
+Decimal must be less than 2^64.
+*/
+static u64
+strconv_decimal_rounded_integer(const StrconvDecimal* a) {
+    u64 n = 0;
+    sint i = 0;
+    for (; i < a->dp && cast(uint, i) < a->nd; i += 1) {
+        n = n * 10 + a->d[i];
+    }
+    for (; i < a->dp; i += 1) {
+        n *= 10;
+    }
+
+    if (a->dp < 0 || cast(uint, a->dp) >= a->nd) {
+        return n;
+    }
+    const uint dp = cast(uint, a->dp);
+    bool round_up = a->d[dp] >= 5;
+    if (a->d[dp] == 5 && dp + 1 == a->nd && !a->trunc) {
+        // exactly halfway
+        round_up = dp > 0 && (a->d[dp - 1] & 1) != 0;
+    }
+    return n + (round_up ? 1 : 0);
+}
+
+// Binary exponents to shift by in order to move decimal point by
+// given number of digits, without overshooting.
+static const u8 strconv_decimal_pow2_steps[9] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+
+/*/doc
+
+Converts decimal into float bits (without sign) with exact arithmetic.
+Decimal is modified in process.
+*/
+static u64
+strconv_decimal_to_float_bits(StrconvDecimal* a, const StrconvFloatInfo* info) {
+    const s64 max_biased = (cast(s64, 1) << info->exp_bits) - 1;
+    const u64 inf_bits = cast(u64, max_biased) << info->mant_bits;
+    if (a->nd == 0 || a->dp < -330) {
+        return 0;
+    }
+    if (a->dp > 310) {
+        return inf_bits;
+    }
+
+    // scale into range [0.5, 1), value is a * 2^exp
+    s64 exp = 0;
+    while (a->dp > 0) {
+        const uint n = a->dp >= 9 ? 27 : strconv_decimal_pow2_steps[a->dp];
+        strconv_decimal_shift(a, -cast(s64, n));
+        exp += cast(s64, n);
+    }
+    while (a->dp < 0 || (a->dp == 0 && a->d[0] < 5)) {
+        const uint n = -a->dp >= 9 ? 27 : strconv_decimal_pow2_steps[-a->dp];
+        strconv_decimal_shift(a, cast(s64, n));
+        exp -= cast(s64, n);
+    }
+
+    // now in range [1, 2)
+    exp -= 1;
+
+    // subnormal numbers have fixed exponent
+    if (exp < info->bias + 1) {
+        const s64 n = info->bias + 1 - exp;
+        strconv_decimal_shift(a, -n);
+        exp += cast(s64, n);
+    }
+    if (exp - info->bias >= max_biased) {
+        return inf_bits;
+    }
+
+    strconv_decimal_shift(a, 1 + info->mant_bits);
+    u64 mant = strconv_decimal_rounded_integer(a);
+
+    // rounding up may carry into the next power of two
+    if (mant == (cast(u64, 2) << info->mant_bits)) {
+        mant >>= 1;
+        exp += 1;
+        if (exp - info->bias >= max_biased) {
+            return inf_bits;
+        }
+    }
+    if ((mant & (cast(u64, 1) << info->mant_bits)) == 0) {
+        exp = info->bias;
+    }
+
+    const u64 mant_mask = (cast(u64, 1) << info->mant_bits) - 1;
+    return (mant & mant_mask) | (cast(u64, exp - info->bias) << info->mant_bits);
+}
+
+/*/doc
+
+Converts scanned number (not special value) into float bits without sign,
+using Eisel-Lemire algorithm or exact arithmetic if it fails.
+*/
+static u64
+strconv_float_bits(str s, const StrconvFloatScan* scan, const StrconvFloatInfo* info) {
+    RetStrconvFloatBits r = strconv_eisel_lemire(scan->w, scan->q, info);
+    if (r.ok && scan->truncated) {
+        // true value lies between w and w + 1 (times power of ten),
+        // result is determined only if both give the same float
+        RetStrconvFloatBits r1 = strconv_eisel_lemire(scan->w + 1, scan->q, info);
+        r.ok = r1.ok && r1.bits == r.bits;
+    }
+    if (r.ok) {
+        return r.bits;
+    }
+
+    StrconvDecimal a;
+    strconv_decimal_init(&a, s, scan);
+    return strconv_decimal_to_float_bits(&a, info);
+}
+
+// Powers of ten which are exactly representable in f64.
+static const f64 strconv_pow10_f64[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Powers of ten which are exactly representable in f32.
+static const f32 strconv_pow10_f32[11] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+};
+
+/*/doc
+
+Parse f64 number from the start of a given string. Returns number
+of bytes consumed.
+*/
+static RetParseF64
+parse_f64_prefix(str s) {
+    RetParseF64 ret = {};
+    const StrconvFloatScan scan = strconv_float_scan(s);
+    if (scan.code != 0) {
+        ret.code = scan.code;
+        return ret;
+    }
+    ret.len = scan.len;
+
+    const u64 sign = cast(u64, scan.neg) << 63;
+    if (scan.kind == STRCONV_FLOAT_KIND_NAN) {
+        ret.n = f64_from_bits(0x7FF8000000000000ULL);
+        return ret;
+    }
+    if (scan.kind == STRCONV_FLOAT_KIND_INF) {
+        ret.n = f64_from_bits(sign | 0x7FF0000000000000ULL);
+        return ret;
+    }
+
+    // both significand and power of ten are exact, single rounding
+    if (!scan.truncated && scan.w <= (cast(u64, 1) << 53) && scan.q >= -22 && scan.q <= 22) {
+        f64 x = cast(f64, scan.w);
+        if (scan.q >= 0) {
+            x *= strconv_pow10_f64[scan.q];
+        } else {
+            x /= strconv_pow10_f64[-scan.q];
+        }
+        ret.n = scan.neg ? -x : x;
+        return ret;
+    }
+
+    ret.n = f64_from_bits(sign | strconv_float_bits(s, &scan, &strconv_float_info_f64));
+    return ret;
+}
+
+/*/doc
+
+Same as {parse_f64_prefix(...)}, but result is rounded to f32 directly
+(not through f64, which could round twice).
+*/
+static RetParseF32
+parse_f32_prefix(str s) {
+    RetParseF32 ret = {};
+    const StrconvFloatScan scan = strconv_float_scan(s);
+    if (scan.code != 0) {
+        ret.code = scan.code;
+        return ret;
+    }
+    ret.len = scan.len;
+
+    const u32 sign = cast(u32, scan.neg) << 31;
+    if (scan.kind == STRCONV_FLOAT_KIND_NAN) {
+        ret.n = f32_from_bits(0x7FC00000);
+        return ret;
+    }
+    if (scan.kind == STRCONV_FLOAT_KIND_INF) {
+        ret.n = f32_from_bits(sign | 0x7F800000);
+        return ret;
+    }
+
+    if (!scan.truncated && scan.w <= (cast(u64, 1) << 24) && scan.q >= -10 && scan.q <= 10) {
+        f32 x = cast(f32, scan.w);
+        if (scan.q >= 0) {
+            x *= strconv_pow10_f32[scan.q];
+        } else {
+            x /= strconv_pow10_f32[-scan.q];
+        }
+        ret.n = scan.neg ? -x : x;
+        return ret;
+    }
+
+    ret.n = f32_from_bits(sign | cast(u32, strconv_float_bits(s, &scan, &strconv_float_info_f32)));
+    return ret;
+}
+
+/*/doc
+
+Parse f64 number from a given string. It must not contain leading or
+trailing spaces or any other characters which are not part of number.
+*/
+static RetParseF64
+parse_f64(str s) {
+    RetParseF64 ret = parse_f64_prefix(s);
+    if (ret.code == 0 && ret.len != s.len) {
+        ret.n = 0;
+        ret.code = ERROR_BAD_FLOAT_FORMAT;
+    }
+    return ret;
+}
+
+static RetParseF32
+parse_f32(str s) {
+    RetParseF32 ret = parse_f32_prefix(s);
+    if (ret.code == 0 && ret.len != s.len) {
+        ret.n = 0;
+        ret.code = ERROR_BAD_FLOAT_FORMAT;
+    }
+    return ret;
+}
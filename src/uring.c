@@ -0,0 +1,998 @@
+/*
+Asynchronous file I/O on top of Linux io_uring interface. Rings are set
+up and driven with raw system calls, no liburing.
+
+Reader, writer and copy implementations keep several fixed size buffers
+in flight at once. Buffers are registered with kernel once, so that
+operations do not pin pages each time. Operations use explicit file
+offsets, thus they may complete in any order.
+
+When io_uring is not available (old kernel or disabled by sysctl) or file
+is not seekable (pipe, terminal, socket) they fall back to plain
+synchronous system calls.
+*/
+
+/*/doc
+
+Mapped submission and completion rings of io_uring instance.
+
+Related:
+    +init_uring(...)
+    .uring_get_sqe(...)
+    .uring_submit_and_wait(...)
+    .uring_peek_cqe(...)
+    .uring_close(...)
+*/
+typedef struct {
+    // Ring file descriptor.
+    uint fd;
+
+    u32* sq_head;
+    u32* sq_tail;
+    u32  sq_mask;
+    u32  sq_entries;
+    LinuxUringSqe* sqes;
+
+    // Local tail of submission ring. Entries before it are prepared,
+    // shared tail is updated on submit.
+    u32 sqe_tail;
+
+    // Number of prepared entries not yet consumed by kernel.
+    u32 sqe_pending;
+
+    u32* cq_head;
+    u32* cq_tail;
+    u32  cq_mask;
+    LinuxUringCqe* cqes;
+
+    MemBlock sq_ring;
+
+    // Has zero length when both rings share single mapping.
+    MemBlock cq_ring;
+
+    MemBlock sqe_array;
+} Uring;
+
+static ErrorCode
+uring_map(MemBlock* block, uint fd, uint len, uint offset) {
+    const uint prot = OS_LINUX_MEMORY_MAP_PROT_READ | OS_LINUX_MEMORY_MAP_PROT_WRITE;
+    const uint flags = OS_LINUX_MEMORY_MAP_SHARED | OS_LINUX_MEMORY_MAP_POPULATE;
+    sint n = os_linux_amd64_syscall_mmap(nil, len, prot, flags, fd, offset);
+    if (n < 0) {
+        return os_linux_convert_syscall_mmap_error(cast(uint, -n));
+    }
+
+    block->span.ptr = cast(u8*, n);
+    block->span.len = len;
+    block->id = 0;
+    return 0;
+}
+
+static void
+uring_unmap(MemBlock* block) {
+    if (block->span.len == 0) {
+        return;
+    }
+    os_linux_mem_free(*block);
+    clear_mem_block(block);
+}
+
+static void
+uring_close(Uring* u) {
+    uring_unmap(&u->sqe_array);
+    uring_unmap(&u->cq_ring);
+    uring_unmap(&u->sq_ring);
+    os_linux_amd64_syscall_close(u->fd);
+}
+
+/*/doc
+
+Creates io_uring instance with at least given number of submission
+entries and maps its rings into memory. Returns error if kernel does
+not support io_uring.
+*/
+static ErrorCode
+init_uring(Uring* u, uint entries) {
+    *u = (Uring){};
+
+    LinuxUringParams params = {};
+    sint n = os_linux_amd64_syscall_io_uring_setup(entries, &params);
+    if (n < 0) {
+        return cast(ErrorCode, -n);
+    }
+    u->fd = cast(uint, n);
+
+    uint sq_len = params.sq_off.array + params.sq_entries * sizeof(u32);
+    uint cq_len = params.cq_off.cqes + params.cq_entries * sizeof(LinuxUringCqe);
+    const bool single = (params.features & OS_LINUX_URING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        sq_len = max_uint(sq_len, cq_len);
+    }
+
+    ErrorCode code = uring_map(&u->sq_ring, u->fd, sq_len, OS_LINUX_URING_OFF_SQ_RING);
+    if (code != 0) {
+        uring_close(u);
+        return code;
+    }
+    u8* cq_ptr = u->sq_ring.span.ptr;
+    if (!single) {
+        code = uring_map(&u->cq_ring, u->fd, cq_len, OS_LINUX_URING_OFF_CQ_RING);
+        if (code != 0) {
+            uring_close(u);
+            return code;
+        }
+        cq_ptr = u->cq_ring.span.ptr;
+    }
+    code = uring_map(&u->sqe_array, u->fd, params.sq_entries * sizeof(LinuxUringSqe), OS_LINUX_URING_OFF_SQES);
+    if (code != 0) {
+        uring_close(u);
+        return code;
+    }
+
+    u8* sq_ptr = u->sq_ring.span.ptr;
+    u->sq_head = cast(u32*, sq_ptr + params.sq_off.head);
+    u->sq_tail = cast(u32*, sq_ptr + params.sq_off.tail);
+    u->sq_mask = *cast(u32*, sq_ptr + params.sq_off.ring_mask);
+    u->sq_entries = params.sq_entries;
+    u->sqes = cast(LinuxUringSqe*, u->sqe_array.span.ptr);
+    u->sqe_tail = *u->sq_tail;
+
+    u->cq_head = cast(u32*, cq_ptr + params.cq_off.head);
+    u->cq_tail = cast(u32*, cq_ptr + params.cq_off.tail);
+    u->cq_mask = *cast(u32*, cq_ptr + params.cq_off.ring_mask);
+    u->cqes = cast(LinuxUringCqe*, cq_ptr + params.cq_off.cqes);
+
+    // entry at ring position i always lives at index i of entries array
+    u32* array = cast(u32*, sq_ptr + params.sq_off.array);
+    for (u32 i = 0; i < params.sq_entries; i += 1) {
+        array[i] = i;
+    }
+    return 0;
+}
+
+/*/doc
+
+Returns cleared submission entry or nil if submission ring is full.
+Entry is passed to kernel on next submit.
+*/
+static LinuxUringSqe*
+uring_get_sqe(Uring* u) {
+    const u32 head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    if (u->sqe_tail - head >= u->sq_entries) {
+        return nil;
+    }
+
+    LinuxUringSqe* sqe = &u->sqes[u->sqe_tail & u->sq_mask];
+    *sqe = (LinuxUringSqe){};
+    u->sqe_tail += 1;
+    u->sqe_pending += 1;
+    return sqe;
+}
+
+/*/doc
+
+Passes prepared entries to kernel and waits until at least
+{wait_nr} completions are available.
+*/
+static ErrorCode
+uring_submit_and_wait(Uring* u, uint wait_nr) {
+    __atomic_store_n(u->sq_tail, u->sqe_tail, __ATOMIC_RELEASE);
+
+    const uint flags = wait_nr != 0 ? OS_LINUX_URING_ENTER_GETEVENTS : 0;
+    while (true) {
+        sint n = os_linux_amd64_syscall_io_uring_enter(u->fd, u->sqe_pending, wait_nr, flags);
+        if (n == -OS_LINUX_ERROR_CODE_INTERRUPTED) {
+            continue;
+        }
+        if (n < 0) {
+            return cast(ErrorCode, -n);
+        }
+        u->sqe_pending -= cast(u32, n);
+        return 0;
+    }
+}
+
+/*/doc
+
+Takes next completion entry out of completion ring.
+Returns false if there are no completions available.
+*/
+static bool
+uring_peek_cqe(Uring* u, LinuxUringCqe* cqe) {
+    const u32 head = *u->cq_head;
+    const u32 tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return false;
+    }
+
+    *cqe = u->cqes[head & u->cq_mask];
+    __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*/doc
+
+Registers buffers for fixed read and write operations, which refer
+to buffers by their index.
+*/
+static ErrorCode
+uring_register_buffers(Uring* u, span_str bufs) {
+    sint n = os_linux_amd64_syscall_io_uring_register(u->fd, OS_LINUX_URING_REGISTER_BUFFERS, bufs.ptr, bufs.len);
+    if (n < 0) {
+        return cast(ErrorCode, -n);
+    }
+    return 0;
+}
+
+// Upper limit on number of buffers in flight.
+#define URING_MAX_DEPTH 32
+
+#define URING_DEFAULT_DEPTH 8
+
+// Size of each buffer in flight.
+#define URING_DEFAULT_BUFFER_SIZE (1 << 17)
+
+/*/doc
+
+Ring together with memory of registered buffers. Each buffer has at most
+one operation in flight, completion carries buffer index as user data.
+*/
+typedef struct {
+    Uring ring;
+
+    // Memory of all buffers, one after another.
+    MemBlock mem;
+
+    // Number of buffers.
+    uint depth;
+
+    // Size of each buffer.
+    uint buf_size;
+
+    // Number of submitted operations which have not completed yet.
+    uint inflight;
+} UringPool;
+
+static ErrorCode
+init_uring_pool(UringPool* p, uint depth, uint buf_size) {
+    must(depth != 0 && depth <= URING_MAX_DEPTH);
+    must(buf_size != 0);
+
+    ErrorCode code = init_uring(&p->ring, depth);
+    if (code != 0) {
+        return code;
+    }
+
+    p->depth = depth;
+    p->buf_size = buf_size;
+    p->inflight = 0;
+    p->mem = (MemBlock){};
+    p->mem.span.len = depth * buf_size;
+    code = os_linux_mem_alloc(&p->mem);
+    if (code != 0) {
+        uring_close(&p->ring);
+        return code;
+    }
+
+    str iov[URING_MAX_DEPTH];
+    for (uint i = 0; i < depth; i += 1) {
+        iov[i] = make_str(p->mem.span.ptr + i * buf_size, buf_size);
+    }
+    code = uring_register_buffers(&p->ring, make_span_str(iov, depth));
+    if (code != 0) {
+        os_linux_mem_free(p->mem);
+        uring_close(&p->ring);
+        return code;
+    }
+    return 0;
+}
+
+static u8*
+uring_pool_buffer(UringPool* p, uint i) {
+    return p->mem.span.ptr + i * p->buf_size;
+}
+
+/*/doc
+
+Prepares fixed read or write of {len} bytes at {pos} inside buffer {i}.
+*/
+static void
+uring_pool_prep(UringPool* p, u8 op, uint fd, uint i, uint pos, uint len, u64 offset) {
+    LinuxUringSqe* sqe = uring_get_sqe(&p->ring);
+
+    // ring has at least as many entries as there are buffers
+    must(sqe != nil);
+
+    sqe->opcode = op;
+    sqe->fd = cast(s32, fd);
+    sqe->off = offset;
+    sqe->addr = cast(u64, uring_pool_buffer(p, i) + pos);
+    sqe->len = cast(u32, len);
+    sqe->buf_index = cast(u16, i);
+    sqe->user_data = i;
+    p->inflight += 1;
+}
+
+/*/doc
+
+Submits prepared operations and waits for at least one completion.
+*/
+static ErrorCode
+uring_pool_wait(UringPool* p) {
+    return uring_submit_and_wait(&p->ring, 1);
+}
+
+static bool
+uring_pool_next(UringPool* p, LinuxUringCqe* cqe) {
+    if (!uring_peek_cqe(&p->ring, cqe)) {
+        return false;
+    }
+    p->inflight -= 1;
+    return true;
+}
+
+/*/doc
+
+Waits for all operations in flight, since kernel may still access
+buffer memory, then releases ring and buffers.
+*/
+static void
+uring_pool_close(UringPool* p) {
+    LinuxUringCqe cqe;
+    while (p->inflight != 0) {
+        if (uring_pool_wait(p) != 0) {
+            break;
+        }
+        while (uring_pool_next(p, &cqe)) {}
+    }
+    uring_close(&p->ring);
+    os_linux_mem_free(p->mem);
+}
+
+#define URING_SLOT_FREE  0
+#define URING_SLOT_READ  1
+#define URING_SLOT_WRITE 2
+#define URING_SLOT_READY 3
+
+typedef struct {
+    // Offset of buffer data relative to stream start.
+    u64 offset;
+
+    // Number of bytes stored in buffer.
+    uint len;
+
+    // Number of bytes already consumed by reader or written by writer.
+    uint pos;
+
+    uint state;
+
+    // Error of failed read. Reported after data before it is consumed.
+    ErrorCode code;
+} UringSlot;
+
+/*/doc
+
+Returns current position of file descriptor. Result is not ok for
+files which do not support seeking.
+*/
+static RetIndex
+uring_file_position(uint fd) {
+    RetIndex ret = {};
+    sint n = os_linux_amd64_syscall_lseek(fd, 0, OS_LINUX_SEEK_CUR);
+    if (n < 0) {
+        return ret;
+    }
+    ret.index = cast(uint, n);
+    ret.ok = true;
+    return ret;
+}
+
+static void
+uring_set_file_position(uint fd, u64 pos) {
+    os_linux_amd64_syscall_lseek(fd, cast(sint, pos), OS_LINUX_SEEK_SET);
+}
+
+/*/doc
+
+Reader which keeps several reads ahead of consumer in flight. File position
+of descriptor is updated only on close.
+
+Related:
+    +init_uring_reader(...)
+    .uring_reader_read(...)
+    .uring_reader_close(...)
+    .bag_uring_reader(...)
+*/
+typedef struct {
+    UringPool pool;
+
+    UringSlot slots[URING_MAX_DEPTH];
+
+    uint fd;
+
+    // File offset at which reader started.
+    u64 start;
+
+    // Stream offset of next read to submit.
+    u64 next;
+
+    // Stream offset of consumed data.
+    u64 consumed;
+
+    // Stream length. Equals max_integer_u64 until end of file is reached.
+    u64 end;
+
+    // Slot to be consumed next. Slots are consumed in the order of
+    // their stream offsets, which is cyclic.
+    uint head;
+
+    // Read directly with system calls.
+    bool sync;
+} UringReader;
+
+static void
+uring_reader_submit(UringReader* r, uint i) {
+    UringSlot* slot = &r->slots[i];
+    slot->state = URING_SLOT_READ;
+    const uint pos = slot->len;
+    uring_pool_prep(&r->pool, OS_LINUX_URING_OP_READ_FIXED, r->fd, i, pos, r->pool.buf_size - pos, r->start + slot->offset + pos);
+}
+
+/*/doc
+
+Starts read into free slot at next stream offset unless it is known
+to be past the end of file.
+*/
+static void
+uring_reader_refill(UringReader* r, uint i) {
+    UringSlot* slot = &r->slots[i];
+    slot->state = URING_SLOT_FREE;
+    if (r->next >= r->end) {
+        return;
+    }
+
+    slot->offset = r->next;
+    slot->len = 0;
+    slot->pos = 0;
+    slot->code = 0;
+    r->next += r->pool.buf_size;
+    uring_reader_submit(r, i);
+}
+
+/*/doc
+
+Init reader for a given file descriptor. Uses default depth and buffer
+size if corresponding arguments are 0. Never fails: when io_uring can not
+be used reader switches to synchronous reads.
+*/
+static void
+init_uring_reader(UringReader* r, uint fd, uint depth, uint buf_size) {
+    *r = (UringReader){};
+    r->fd = fd;
+    r->end = max_integer_u64;
+
+    RetIndex pos = uring_file_position(fd);
+    r->sync = !pos.ok;
+    if (r->sync) {
+        return;
+    }
+    r->start = pos.index;
+
+    depth = depth == 0 ? URING_DEFAULT_DEPTH : depth;
+    buf_size = buf_size == 0 ? URING_DEFAULT_BUFFER_SIZE : buf_size;
+    if (init_uring_pool(&r->pool, depth, buf_size) != 0) {
+        r->sync = true;
+        return;
+    }
+
+    for (uint i = 0; i < depth; i += 1) {
+        uring_reader_refill(r, i);
+    }
+}
+
+static void
+uring_reader_complete(UringReader* r, LinuxUringCqe cqe) {
+    UringSlot* slot = &r->slots[cqe.user_data];
+    if (cqe.res < 0) {
+        // error at later offset must not hide data read before it
+        slot->code = os_linux_convert_syscall_read_error(cast(uint, -cqe.res));
+        slot->state = URING_SLOT_READY;
+        return;
+    }
+    if (cqe.res == 0) {
+        r->end = min_uint(r->end, slot->offset + slot->len);
+        slot->state = URING_SLOT_READY;
+        return;
+    }
+
+    slot->len += cast(uint, cqe.res);
+    if (slot->len < r->pool.buf_size) {
+        // short read, rest of the buffer is requested again,
+        // at end of file it will complete with 0
+        uring_reader_submit(r, cast(uint, cqe.user_data));
+        return;
+    }
+    slot->state = URING_SLOT_READY;
+}
+
+/*/doc
+
+Borrows ready data of next slot, waiting for its read to complete
+if necessary. Reader must not be in synchronous mode.
+*/
+static RetBorrow
+uring_reader_fill_buf(UringReader* r) {
+    RetBorrow ret = {};
+    while (true) {
+        UringSlot* slot = &r->slots[r->head];
+        if (slot->state == URING_SLOT_READ) {
+            ErrorCode code = uring_pool_wait(&r->pool);
+            if (code != 0) {
+                ret.code = code;
+                return ret;
+            }
+            LinuxUringCqe cqe;
+            while (uring_pool_next(&r->pool, &cqe)) {
+                uring_reader_complete(r, cqe);
+            }
+            continue;
+        }
+        if (slot->state == URING_SLOT_FREE || slot->pos == slot->len) {
+            // slot is consumed only after all its data, thus empty
+            // ready slot has either failed or reached end of file
+            ret.code = slot->code != 0 ? slot->code : ERROR_READER_EOF;
+            return ret;
+        }
+
+        ret.data = make_span_u8(uring_pool_buffer(&r->pool, r->head) + slot->pos, slot->len - slot->pos);
+        return ret;
+    }
+}
+
+/*/doc
+
+Consumes borrowed data. Fully consumed slot is immediately reused
+for next read ahead.
+*/
+static void
+uring_reader_consume(UringReader* r, uint n) {
+    UringSlot* slot = &r->slots[r->head];
+    must(n <= slot->len - slot->pos);
+
+    slot->pos += n;
+    r->consumed += n;
+    if (slot->pos == slot->len && n != 0 && slot->code == 0) {
+        uring_reader_refill(r, r->head);
+        r->head = (r->head + 1) % r->pool.depth;
+    }
+}
+
+static RetRead
+uring_reader_read(UringReader* r, span_u8 buf) {
+    if (r->sync) {
+        return os_linux_read(r->fd, buf);
+    }
+
+    RetRead ret = {};
+    while (ret.count < buf.len) {
+        if (ret.count != 0 && r->slots[r->head].state == URING_SLOT_READ) {
+            // return what is ready instead of waiting
+            return ret;
+        }
+
+        RetBorrow b = uring_reader_fill_buf(r);
+        if (b.data.len == 0) {
+            if (ret.count == 0 || b.code != ERROR_READER_EOF) {
+                ret.code = b.code;
+            }
+            return ret;
+        }
+
+        const uint n = min_uint(b.data.len, buf.len - ret.count);
+        unsafe_copy(buf.ptr + ret.count, b.data.ptr, n);
+        ret.count += n;
+        uring_reader_consume(r, n);
+    }
+    return ret;
+}
+
+/*/doc
+
+Waits for reads in flight and releases resources. File position is
+moved right after consumed data.
+*/
+static void
+uring_reader_close(UringReader* r) {
+    if (r->sync) {
+        return;
+    }
+    uring_pool_close(&r->pool);
+    uring_set_file_position(r->fd, r->start + r->consumed);
+}
+
+const BagReaderTab uring_reader_bag_reader_tab = {
+    .type_id = 6,
+    .read = cast(BagFuncRead, uring_reader_read),
+    .fill_buf = cast(BagFuncFillBuf, uring_reader_fill_buf),
+    .consume = cast(BagFuncConsume, uring_reader_consume),
+};
+
+// Used in synchronous mode, when reader has no buffers to borrow.
+const BagReaderTab uring_reader_sync_bag_reader_tab = {
+    .type_id = 6,
+    .read = cast(BagFuncRead, uring_reader_read),
+};
+
+static Reader
+bag_uring_reader(UringReader* r) {
+    must(r != nil);
+
+    Reader reader = {};
+    reader.obj = cast(uint, r);
+    reader.tab = r->sync ? &uring_reader_sync_bag_reader_tab : &uring_reader_bag_reader_tab;
+    return reader;
+}
+
+/*/doc
+
+Writer which accumulates data in buffers and keeps several writes
+in flight. Data reaches file only after buffer is full, on flush
+or on close.
+
+Related:
+    +init_uring_writer(...)
+    .uring_writer_write(...)
+    .uring_writer_flush(...)
+    .uring_writer_close(...)
+    .bag_uring_writer(...)
+*/
+typedef struct {
+    UringPool pool;
+
+    UringSlot slots[URING_MAX_DEPTH];
+
+    uint fd;
+
+    // File offset at which writer started.
+    u64 start;
+
+    // Stream offset for next buffer submitted to write.
+    u64 next;
+
+    // Slot which receives data.
+    uint fill;
+
+    // First error reported by completion.
+    ErrorCode code;
+
+    // Write directly with system calls.
+    bool sync;
+} UringWriter;
+
+/*/doc
+
+Init writer for a given file descriptor. Uses default depth and buffer
+size if corresponding arguments are 0. Never fails: when io_uring can not
+be used writer switches to synchronous writes.
+*/
+static void
+init_uring_writer(UringWriter* w, uint fd, uint depth, uint buf_size) {
+    *w = (UringWriter){};
+    w->fd = fd;
+
+    RetIndex pos = uring_file_position(fd);
+    w->sync = !pos.ok;
+    if (w->sync) {
+        return;
+    }
+    w->start = pos.index;
+
+    depth = depth == 0 ? URING_DEFAULT_DEPTH : depth;
+    buf_size = buf_size == 0 ? URING_DEFAULT_BUFFER_SIZE : buf_size;
+    if (init_uring_pool(&w->pool, depth, buf_size) != 0) {
+        w->sync = true;
+    }
+}
+
+static void
+uring_writer_submit(UringWriter* w, uint i) {
+    UringSlot* slot = &w->slots[i];
+    slot->state = URING_SLOT_WRITE;
+    uring_pool_prep(&w->pool, OS_LINUX_URING_OP_WRITE_FIXED, w->fd, i, slot->pos, slot->len - slot->pos, w->start + slot->offset + slot->pos);
+}
+
+static void
+uring_writer_release(UringSlot* slot) {
+    slot->state = URING_SLOT_FREE;
+    slot->len = 0;
+    slot->pos = 0;
+}
+
+static void
+uring_writer_complete(UringWriter* w, LinuxUringCqe cqe) {
+    UringSlot* slot = &w->slots[cqe.user_data];
+    if (cqe.res <= 0) {
+        if (w->code == 0) {
+            w->code = cqe.res == 0 ? ERROR_WRITER_EOF : os_linux_convert_syscall_write_error(cast(uint, -cqe.res));
+        }
+        uring_writer_release(slot);
+        return;
+    }
+
+    slot->pos += cast(uint, cqe.res);
+    if (slot->pos < slot->len) {
+        // short write, submit the rest
+        uring_writer_submit(w, cast(uint, cqe.user_data));
+        return;
+    }
+    uring_writer_release(slot);
+}
+
+static ErrorCode
+uring_writer_wait(UringWriter* w) {
+    ErrorCode code = uring_pool_wait(&w->pool);
+    if (code != 0) {
+        return code;
+    }
+    LinuxUringCqe cqe;
+    while (uring_pool_next(&w->pool, &cqe)) {
+        uring_writer_complete(w, cqe);
+    }
+    return w->code;
+}
+
+/*/doc
+
+Submits fill slot for write and moves to the next one.
+*/
+static void
+uring_writer_push(UringWriter* w) {
+    UringSlot* slot = &w->slots[w->fill];
+    slot->offset = w->next;
+    slot->pos = 0;
+    w->next += slot->len;
+    uring_writer_submit(w, w->fill);
+    w->fill = (w->fill + 1) % w->pool.depth;
+}
+
+static RetWrite
+uring_writer_write(UringWriter* w, span_u8 s) {
+    if (w->sync) {
+        return os_linux_write_all(w->fd, s);
+    }
+
+    RetWrite ret = {};
+    while (ret.count < s.len) {
+        if (w->code != 0) {
+            ret.code = w->code;
+            return ret;
+        }
+
+        UringSlot* slot = &w->slots[w->fill];
+        if (slot->state == URING_SLOT_WRITE) {
+            ErrorCode code = uring_writer_wait(w);
+            if (code != 0) {
+                ret.code = code;
+                return ret;
+            }
+            continue;
+        }
+
+        const uint n = min_uint(w->pool.buf_size - slot->len, s.len - ret.count);
+        unsafe_copy(uring_pool_buffer(&w->pool, w->fill) + slot->len, s.ptr + ret.count, n);
+        slot->len += n;
+        ret.count += n;
+        if (slot->len == w->pool.buf_size) {
+            uring_writer_push(w);
+        }
+    }
+    return ret;
+}
+
+/*/doc
+
+Submits partially filled buffer and waits until all writes complete.
+*/
+static ErrorCode
+uring_writer_flush(UringWriter* w) {
+    if (w->sync) {
+        return 0;
+    }
+
+    if (w->slots[w->fill].len != 0 && w->slots[w->fill].state == URING_SLOT_FREE) {
+        uring_writer_push(w);
+    }
+    while (w->pool.inflight != 0) {
+        ErrorCode code = uring_writer_wait(w);
+        if (code != 0) {
+            return code;
+        }
+    }
+    return w->code;
+}
+
+/*/doc
+
+Flushes buffered data and releases resources. File position is
+moved right after written data.
+*/
+static ErrorCode
+uring_writer_close(UringWriter* w) {
+    if (w->sync) {
+        return 0;
+    }
+    ErrorCode code = uring_writer_flush(w);
+    uring_pool_close(&w->pool);
+    uring_set_file_position(w->fd, w->start + w->next);
+    return code;
+}
+
+const BagWriterTab uring_writer_bag_writer_tab = {
+    .type_id = 7,
+    .write = cast(BagFuncWrite, uring_writer_write),
+};
+
+static Writer
+bag_uring_writer(UringWriter* w) {
+    must(w != nil);
+
+    Writer writer = {};
+    writer.obj = cast(uint, w);
+    writer.tab = &uring_writer_bag_writer_tab;
+    return writer;
+}
+
+/*/doc
+
+State of copy between two files with io_uring. Each buffer is first
+read from source and then written to destination at the same offset,
+data is never copied between buffers.
+*/
+typedef struct {
+    UringPool pool;
+
+    UringSlot slots[URING_MAX_DEPTH];
+
+    uint in_fd;
+    uint out_fd;
+
+    // Start offsets of source and destination files.
+    u64 in_start;
+    u64 out_start;
+
+    // Stream offset of next read to submit.
+    u64 next;
+
+    // Stream length. Equals max_integer_u64 until end of file is reached.
+    u64 end;
+
+    RetCopy ret;
+} UringCopy;
+
+static void
+uring_copy_read(UringCopy* c, uint i) {
+    UringSlot* slot = &c->slots[i];
+    slot->state = URING_SLOT_READ;
+    uring_pool_prep(&c->pool, OS_LINUX_URING_OP_READ_FIXED, c->in_fd, i, slot->len, c->pool.buf_size - slot->len, c->in_start + slot->offset + slot->len);
+}
+
+static void
+uring_copy_write(UringCopy* c, uint i) {
+    UringSlot* slot = &c->slots[i];
+    slot->state = URING_SLOT_WRITE;
+    uring_pool_prep(&c->pool, OS_LINUX_URING_OP_WRITE_FIXED, c->out_fd, i, slot->pos, slot->len - slot->pos, c->out_start + slot->offset + slot->pos);
+}
+
+static void
+uring_copy_complete(UringCopy* c, LinuxUringCqe cqe) {
+    const uint i = cast(uint, cqe.user_data);
+    UringSlot* slot = &c->slots[i];
+    if (cqe.res < 0 || (cqe.res == 0 && slot->state == URING_SLOT_WRITE)) {
+        if (c->ret.code == 0) {
+            c->ret.code = cqe.res == 0 ? ERROR_WRITER_EOF : cast(ErrorCode, -cqe.res);
+        }
+        slot->state = URING_SLOT_FREE;
+        return;
+    }
+
+    if (slot->state == URING_SLOT_READ) {
+        if (cqe.res == 0) {
+            c->end = min_uint(c->end, slot->offset + slot->len);
+        } else {
+            slot->len += cast(uint, cqe.res);
+            if (slot->len < c->pool.buf_size) {
+                // short read, at end of file it will complete with 0
+                uring_copy_read(c, i);
+                return;
+            }
+        }
+        if (slot->len == 0) {
+            slot->state = URING_SLOT_FREE;
+            return;
+        }
+        slot->pos = 0;
+        uring_copy_write(c, i);
+        return;
+    }
+
+    slot->pos += cast(uint, cqe.res);
+    c->ret.count += cast(uint, cqe.res);
+    if (slot->pos < slot->len) {
+        uring_copy_write(c, i);
+        return;
+    }
+    slot->state = URING_SLOT_FREE;
+}
+
+/*/doc
+
+Runs copy until end of source file or first error. Both files must be
+seekable. Returns error only if io_uring setup failed, in that case no
+data was copied.
+*/
+static ErrorCode
+uring_copy_run(UringCopy* c, uint depth, uint buf_size) {
+    ErrorCode code = init_uring_pool(&c->pool, depth, buf_size);
+    if (code != 0) {
+        return code;
+    }
+
+    while (true) {
+        if (c->ret.code == 0) {
+            for (uint i = 0; i < depth && c->next < c->end; i += 1) {
+                UringSlot* slot = &c->slots[i];
+                if (slot->state != URING_SLOT_FREE) {
+                    continue;
+                }
+                slot->offset = c->next;
+                slot->len = 0;
+                c->next += buf_size;
+                uring_copy_read(c, i);
+            }
+        }
+        if (c->pool.inflight == 0) {
+            break;
+        }
+
+        code = uring_pool_wait(&c->pool);
+        if (code != 0) {
+            c->ret.code = code;
+            break;
+        }
+        LinuxUringCqe cqe;
+        while (uring_pool_next(&c->pool, &cqe)) {
+            uring_copy_complete(c, cqe);
+        }
+    }
+
+    uring_pool_close(&c->pool);
+    return 0;
+}
+
+/*/doc
+
+Copies source file into destination with several reads and writes
+in flight. Falls back to {bag_copy(...)} when io_uring is not available
+or one of files is not seekable. File positions of both descriptors
+are moved past copied data.
+*/
+static RetCopy
+uring_copy_fd(uint out_fd, uint in_fd) {
+    RetIndex in_pos = uring_file_position(in_fd);
+    RetIndex out_pos = uring_file_position(out_fd);
+    if (in_pos.ok && out_pos.ok) {
+        UringCopy c = {};
+        c.in_fd = in_fd;
+        c.out_fd = out_fd;
+        c.in_start = in_pos.index;
+        c.out_start = out_pos.index;
+        c.end = max_integer_u64;
+        if (uring_copy_run(&c, URING_DEFAULT_DEPTH, URING_DEFAULT_BUFFER_SIZE) == 0) {
+            uring_set_file_position(in_fd, c.in_start + c.ret.count);
+            uring_set_file_position(out_fd, c.out_start + c.ret.count);
+            return c.ret;
+        }
+    }
+
+    return bag_copy(bag_fd_writer(out_fd), bag_fd_reader(in_fd));
+}